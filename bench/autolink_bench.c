@@ -0,0 +1,109 @@
+/*
+ * autolink_bench • render time of link-dense text as it doubles in size
+ *
+ *     cc -O2 -o autolink_bench bench/autolink_bench.c
+ *     ./autolink_bench > bench_output.txt
+ *
+ * Each pattern is repeated to 40k, 80k and 160k bytes and rendered with
+ * MKDEXT_AUTOLINK. Every autolink trigger in the text is a candidate, so a
+ * recognizer that scans past its own match shows up as a time that grows
+ * faster than the input. The bench fails when doubling the input takes
+ * more than three times as long.
+ */
+
+#define SD_IMPLEMENTATION
+#include "../sd_markdown.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BASE_SIZE (40u << 10)
+#define DOUBLINGS 3
+#define MAX_GROWTH 3.0
+#define MIN_SECONDS 0.25
+
+static const char *patterns[] = {
+	"a@",
+	"a.a@",
+	"x a@b.com ",
+	"www.",
+	"www.a.b/",
+	"http://a.b ",
+};
+
+/* bench_seconds • best time of several rounds to render the document */
+static double
+bench_seconds(struct sd_markdown *md, struct sd_buf *ob, const uint8_t *doc, size_t size)
+{
+	double best = 0.0;
+	int round;
+
+	for (round = 0; round < 3; ++round) {
+		clock_t start = clock(), spent;
+		size_t runs = 0;
+
+		do {
+			ob->size = 0;
+			sd_markdown_render(ob, doc, size, md);
+			runs++;
+			spent = clock() - start;
+		} while ((double)spent / CLOCKS_PER_SEC < MIN_SECONDS);
+
+		if (round == 0 || (double)spent / CLOCKS_PER_SEC / runs < best)
+			best = (double)spent / CLOCKS_PER_SEC / runs;
+	}
+
+	return best;
+}
+
+int
+main(void)
+{
+	struct sd_callbacks callbacks;
+	struct html_renderopt options;
+	struct sd_markdown *md;
+	struct sd_buf *ob = sd_bufnew(64);
+	uint8_t *doc = malloc(BASE_SIZE << (DOUBLINGS - 1));
+	int failed = 0;
+	size_t i;
+
+	if (!doc || !ob)
+		return 1;
+
+	sdhtml_renderer(&callbacks, &options, 0);
+	md = sd_markdown_new(MKDEXT_AUTOLINK, 16, &callbacks, &options);
+
+	for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); ++i) {
+		size_t len = strlen(patterns[i]), size = BASE_SIZE, j;
+		double last = 0.0;
+		int k;
+
+		for (j = 0; j < (BASE_SIZE << (DOUBLINGS - 1)); ++j)
+			doc[j] = (uint8_t)patterns[i][j % len];
+
+		printf("%-14s", patterns[i]);
+
+		for (k = 0; k < DOUBLINGS; ++k, size <<= 1) {
+			double seconds = bench_seconds(md, ob, doc, size);
+
+			printf("  %4uk %8.3f ms", (unsigned)(size >> 10), seconds * 1e3);
+
+			if (k > 0 && seconds > last * MAX_GROWTH)
+				failed = 1;
+
+			last = seconds;
+		}
+
+		printf("\n");
+	}
+
+	if (failed)
+		fprintf(stderr, "render time grew faster than the input\n");
+
+	sd_markdown_free(md);
+	sd_bufrelease(ob);
+	free(doc);
+	return failed;
+}
@@ -0,0 +1,177 @@
+/*
+ * escape_bench • throughput of the houdini escapers and unescapers on
+ * clean text, next to memcpy
+ *
+ *     cc -O2 -o escape_bench bench/escape_bench.c
+ *     ./escape_bench > bench_output.txt
+ *
+ * The input is 4MB of letters, digits and "-._", which none of the codecs
+ * escape or decode, so each one copies its input through whole. Add
+ * -DSD_NO_SIMD to time the plain byte loops.
+ *
+ * Text spans are mostly short, so each codec is then timed again on the
+ * same input cut into spans of 3 to 31 bytes, every other one holding a
+ * '<'. A kernel with a high fixed cost per call shows up only here.
+ */
+
+#define SD_IMPLEMENTATION
+#include "../sd_markdown.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define INPUT_SIZE (4u << 20)
+#define MIN_SECONDS 0.25
+#define SPAN_MIN 3
+#define SPAN_MAX 31
+
+static void
+bench_memcpy(struct sd_buf *ob, const uint8_t *src, size_t size)
+{
+	sd_bufput(ob, src, size);
+}
+
+static const struct {
+	const char *name;
+	void (*codec)(struct sd_buf *ob, const uint8_t *src, size_t size);
+} codecs[] = {
+	{ "memcpy", bench_memcpy },
+	{ "escape_html", houdini_escape_html },
+	{ "escape_xml", houdini_escape_xml },
+	{ "escape_href", houdini_escape_href },
+	{ "escape_uri", houdini_escape_uri },
+	{ "escape_url", houdini_escape_url },
+	{ "escape_js", houdini_escape_js },
+	{ "unescape_html", houdini_unescape_html },
+	{ "unescape_uri", houdini_unescape_uri },
+	{ "unescape_url", houdini_unescape_url },
+	{ "unescape_js", houdini_unescape_js },
+};
+
+/* bench_rate • bytes per second of the best of several timed rounds */
+static double
+bench_rate(void (*codec)(struct sd_buf *, const uint8_t *, size_t),
+	struct sd_buf *ob, const uint8_t *src, size_t size)
+{
+	double best = 0.0;
+	int round;
+
+	for (round = 0; round < 5; ++round) {
+		clock_t start = clock(), spent;
+		size_t runs = 0;
+
+		do {
+			ob->size = 0;
+			codec(ob, src, size);
+			runs++;
+			spent = clock() - start;
+		} while ((double)spent / CLOCKS_PER_SEC < MIN_SECONDS);
+
+		if ((double)size * runs * CLOCKS_PER_SEC / spent > best)
+			best = (double)size * runs * CLOCKS_PER_SEC / spent;
+	}
+
+	return best;
+}
+
+/* bench_span_rate • bench_rate for one codec call per short span */
+static double
+bench_span_rate(void (*codec)(struct sd_buf *, const uint8_t *, size_t),
+	struct sd_buf *ob, const uint8_t *src, const size_t *spans, size_t nspans)
+{
+	double best = 0.0;
+	int round;
+
+	for (round = 0; round < 5; ++round) {
+		clock_t start = clock(), spent;
+		size_t runs = 0;
+
+		do {
+			size_t s, at = 0;
+
+			ob->size = 0;
+			for (s = 0; s < nspans; at += spans[s++])
+				codec(ob, src + at, spans[s]);
+			runs++;
+			spent = clock() - start;
+		} while ((double)spent / CLOCKS_PER_SEC < MIN_SECONDS);
+
+		if ((double)INPUT_SIZE * runs * CLOCKS_PER_SEC / spent > best)
+			best = (double)INPUT_SIZE * runs * CLOCKS_PER_SEC / spent;
+	}
+
+	return best;
+}
+
+int
+main(void)
+{
+	static const char clean[] =
+		"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._";
+	uint8_t *src = malloc(INPUT_SIZE), *spanned = malloc(INPUT_SIZE);
+	size_t *spans = malloc(INPUT_SIZE / SPAN_MIN * sizeof(size_t));
+	struct sd_buf *ob = sd_bufnew(64);
+	double base = 0.0;
+	size_t i, nspans = 0, at = 0;
+
+	if (!src || !spanned || !spans || !ob)
+		return 1;
+
+	srand(43);
+	for (i = 0; i < INPUT_SIZE; ++i)
+		src[i] = clean[rand() % (sizeof(clean) - 1)];
+
+	/* the last span takes whatever is left under SPAN_MIN */
+	memcpy(spanned, src, INPUT_SIZE);
+	while (at < INPUT_SIZE) {
+		size_t len = SPAN_MIN + (size_t)rand() % (SPAN_MAX - SPAN_MIN + 1);
+
+		if (len > INPUT_SIZE - at)
+			len = INPUT_SIZE - at;
+		if (nspans % 2)
+			spanned[at + (size_t)rand() % len] = '<';
+		spans[nspans++] = len;
+		at += len;
+	}
+
+	sd_bufgrow(ob, INPUT_SIZE * 4);
+	memset(ob->data, 0x0, ob->asize);
+
+	for (i = 0; i < sizeof(codecs) / sizeof(codecs[0]); ++i) {
+		double rate;
+
+		/* a codec that changed clean text would not be measuring copies */
+		ob->size = 0;
+		codecs[i].codec(ob, src, INPUT_SIZE);
+		if (ob->size != INPUT_SIZE || memcmp(ob->data, src, INPUT_SIZE) != 0) {
+			fprintf(stderr, "%s changed clean input\n", codecs[i].name);
+			return 1;
+		}
+
+		rate = bench_rate(codecs[i].codec, ob, src, INPUT_SIZE);
+		if (i == 0)
+			base = rate;
+
+		printf("%-14s %6.2f GB/s  %3.0f%% of memcpy\n",
+			codecs[i].name, rate / 1e9, 100.0 * rate / base);
+	}
+
+	printf("\nspans of %d to %d bytes:\n", SPAN_MIN, SPAN_MAX);
+	for (i = 0; i < sizeof(codecs) / sizeof(codecs[0]); ++i) {
+		double rate = bench_span_rate(codecs[i].codec, ob, spanned, spans, nspans);
+
+		if (i == 0)
+			base = rate;
+
+		printf("%-14s %6.2f GB/s  %3.0f%% of memcpy\n",
+			codecs[i].name, rate / 1e9, 100.0 * rate / base);
+	}
+
+	sd_bufrelease(ob);
+	free(spans);
+	free(spanned);
+	free(src);
+	return 0;
+}
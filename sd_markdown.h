@@ -19,6 +19,41 @@
  *
  *     #define SD_NO_HTML
  *
+ *  The parser calls every callback through the sd_callbacks table. To let the
+ *  compiler inline a callback instead, define SD_CB_<NAME> (the slot name in
+ *  capitals) in the implementation file to a function of the slot's type,
+ *  declared above the #include:
+ *
+ *     static void my_text(struct sd_buf *ob, const struct sd_buf *text, void *opaque);
+ *     #define SD_CB_NORMAL_TEXT my_text
+ *
+ *  Where a parser's table holds that function, the parser calls it directly.
+ *  Other slots, and parsers created with other tables, still call through the
+ *  table.
+ *
+ *  sd_autolink_issafe (and HTML_SAFELINK) accepts links starting with "/",
+ *  "http://", "https://", "ftp://" or "mailto:". To use another allowlist,
+ *  define it in the implementation file as a list of lowercase prefixes:
+ *
+ *     #define SD_AUTOLINK_SCHEMES "/", "http://", "https://", "irc://"
+ *
+ *  The autolink recognizers take time linear in the text, link-dense or not;
+ *  bench/autolink_bench.c checks that as the input doubles.
+ *
+ *  The houdini_* escapers (html, xml, href, uri, url and js, with the matching
+ *  unescapers) copy clean runs whole, and look for the characters to escape 16
+ *  or 32 bytes at a time with SSE2, AVX2 (when the CPU has it) or NEON on GCC and
+ *  Clang. A run is scanned and copied 4KB at a time, so the copy reads it back
+ *  from L1. On clean text, on an x86-64 core with AVX2, the escapers run at
+ *  70-90% of the speed of memcpy and the unescapers, which find their next
+ *  escape with memchr, at 80-100%; with the byte loops the escapers run at
+ *  1-2.5 GB/s. bench/escape_bench.c measures each of them next to memcpy, on
+ *  long runs and on short spans. The uri, url and js scans need a byte shuffle,
+ *  so on x86 without AVX2 they take the byte loop. To build the escapers with
+ *  the plain byte loops only, add above the #include:
+ *
+ *     #define SD_NO_SIMD
+ *
  *  # Compiler warnings
  *
  *  In MSVC v19.x, this header will generate the following two warnings on level 4:
@@ -29,7 +64,7 @@
  *  These will not be fixed for algorithmic/API reasons. I recommend you ignore them.
  *
  *  In GCC, in C99 mode, this header should compile without warnings. It will not
- *  compile in C89 mode.
+ *  compile in C89 mode. The implementation also compiles as C++11 or later.
  *
  *  # DOCUMENTATION
  *
@@ -55,6 +90,11 @@
  *
  *       size_t max_nesting = 15;
  *
+ *  Blockquotes and lists are tracked on the heap rather than on the C stack,
+ *  so deep documents are safe on small-stack threads. The contents of
+ *  containers nested beyond the limit are rendered as a paragraph of plain
+ *  text.
+ *
  *  Sundown will call back into your code to render an output document:
  *
  *       struct sd_callbacks callbacks;
@@ -112,6 +152,129 @@
  *  while rendering the document, which you should pass in as the opaque pointer
  *  when creating the markdown parser.
  *
+ *  Entities are passed through verbatim by default. HTML_DECODE_ENTITIES writes
+ *  known entities (named HTML5 ones and numeric references) as UTF-8 instead, and
+ *  HTML_VALIDATE_ENTITIES escapes the ones that are not known, so "&bogus;"
+ *  renders as "&amp;bogus;". The lookup is also available on its own as
+ *  sd_entity_decode for renderers that want plain text.
+ *
+ *  HTML_SMARTYPANTS applies SmartyPants (curly quotes, dashes, ellipses and the
+ *  like) to the text as it is rendered, with the quote state kept in the
+ *  html_renderopt. Code spans, code blocks and raw html are never text, so they
+ *  are left alone without looking for tags, and there is no second pass over
+ *  the output. sdhtml_smartypants still does that pass for html from elsewhere.
+ *
+ *  Tables are streamed when the table_begin callback is set: the header row is
+ *  passed to table_begin, each body row goes to the output as soon as it is
+ *  parsed, and table_end closes the table, so a large table is never held in
+ *  memory as a whole. Without table_begin the rows are collected and handed to
+ *  the table callback as before. The html renderer streams its tables with the
+ *  HTML_STREAM_TABLES flag, which replaces a table callback set by the caller.
+ *
+ *  Blockquotes, lists and list items are written through in the same way when
+ *  both halves of blockquote_begin/_end, list_begin/_end or listitem_begin/_end
+ *  are set: the opening tag goes out first, the contents are rendered straight
+ *  after it, and the _end callback closes the container, instead of each level
+ *  being built in a buffer of its own and copied into its parent. The html
+ *  renderer sets all three pairs with the HTML_WRITE_THROUGH flag, in place of
+ *  any blockquote, list and listitem callbacks set by the caller.
+ *
+ *  A page and its table of contents can come from a single parse. Make a parser
+ *  for each renderer, with the same extensions, and hand the extra ones to
+ *  sd_markdown_render_fanout along with their output buffers:
+ *
+ *       struct sd_fanout toc = { toc_md, toc_buffer };
+ *       sd_markdown_render_fanout(output_buffer, input_data, in_data_size, md, &toc, 1);
+ *
+ *  md alone splits the document into blocks and collects the link references.
+ *  Each block is then rendered by md and by every fan, through its own callbacks
+ *  and into its own buffer, so the fans see the blocks md sees: with the html
+ *  renderer first, headers inside raw html blocks stay out of the contents.
+ *
+ *  A block whose callback is NULL is skipped without parsing its text, so the
+ *  toc renderer, which only renders headers, costs little more than finding the
+ *  blocks, alone or as a fan.
+ *
+ *  ## CACHING
+ *
+ *  Pages rendered on every read can go through a cache of rendered documents,
+ *  shared by any number of threads (each with its own sd_markdown):
+ *
+ *       struct sd_cache *cache = sd_cache_new(max_bytes_of_output);
+ *
+ *       sd_cache_render(output_buffer, input_data, in_data_size, md, cache, html_flags);
+ *
+ *  A render is keyed by a 128-bit hash (MurmurHash3) of the document, seeded
+ *  with the callbacks, extensions and nesting limit of md and with the flags
+ *  passed along, which stand for whatever else the output depends on. A repeated
+ *  render is that hash and a copy of the stored output; sd_cache_stats has the
+ *  hits, misses and evictions.
+ *
+ *  The state a renderer carries from one render to the next is not in the key,
+ *  and a hit neither reads nor advances it. Give every cached render fresh
+ *  options (call sdhtml_renderer again, which clears them): the toc counters of
+ *  a reused html_renderopt keep counting, and a hit would return the ids of the
+ *  render that stored it.
+ *
+ *  The cache is split into SD_CACHE_STRIPES stripes (16 unless defined), each an
+ *  LRU list with its share of the byte budget and a lock of its own. The locks
+ *  are only held to look an entry up or link it in, never while a document is
+ *  rendered or copied. They are spinlocks on GCC, Clang and MSVC, and on C11
+ *  atomics elsewhere; a waiting thread pauses between tries and, on POSIX
+ *  systems, yields now and then. Other compilers can define SD_CACHE_LOCK(l) and
+ *  SD_CACHE_UNLOCK(l), over a volatile long, or leave the cache out by defining
+ *  SD_NO_CACHE; without either the header stops with #error.
+ *
+ *  Pages edited a few blocks at a time can be cached a block at a time instead,
+ *  so that a render only parses the blocks that changed:
+ *
+ *       sd_cache_render_blocks(output_buffer, input_data, in_data_size, md, cache,
+ *           html_flags, &options, SDHTML_STATE_SIZE);
+ *
+ *  Each top-level block is looked up by the hash of its lines, of the lines past
+ *  it the parser may look at to find its end, of what the references it uses
+ *  resolve to (found or not) and of the state of the renderer before it; for the
+ *  HTML renderer, the toc counters and the smartypants quotes. A block found is
+ *  copied in and the state it leaves restored. A block whose end depends on text
+ *  further on, such as an html block without its closing tag, is never stored.
+ *  Documents of plain paragraphs, which skip the parser, are rendered as usual.
+ *  The blocks found and not found are counted apart from the documents, in the
+ *  block_hits and block_misses of sd_cache_stats.
+ *
+ *  ## C++ RENDERERS
+ *
+ *  From C++11 on (unless SD_NO_CPP is defined), sd::callbacks<R>() fills a
+ *  callback table from the members of a renderer type R. The members take the
+ *  arguments of the matching sd_callbacks slot, minus the opaque pointer, which
+ *  is the renderer; slots without a member are left NULL. The implementation
+ *  compiles as C++, so defining SD_RENDERER in the implementation file also sets
+ *  every SD_CB_<NAME> hook to R's member, and the parser calls the members
+ *  directly, where the compiler can inline them:
+ *
+ *       #include "markdown.h"
+ *
+ *       struct my_renderer {
+ *           int autolink(struct sd_buf *ob, const struct sd_buf *link, enum mkd_autolink type);
+ *           void paragraph(struct sd_buf *ob, const struct sd_buf *text);
+ *           void normal_text(struct sd_buf *ob, const struct sd_buf *text);
+ *       };
+ *
+ *       #define SD_IMPLEMENTATION
+ *       #define SD_RENDERER my_renderer
+ *       #include "markdown.h"
+ *
+ *       struct sd_callbacks callbacks;
+ *       my_renderer r;
+ *
+ *       sd::callbacks<my_renderer>(&callbacks);
+ *       md = sd_markdown_new(extensions, max_nesting, &callbacks, &r);
+ *
+ *  The header can be included again with SD_IMPLEMENTATION after a plain #include,
+ *  so the type can use the header's types; its members only need to be declared
+ *  above the second #include and can be defined further down. Parsers with other
+ *  tables, such as the HTML renderer's, still call through the table in the same
+ *  build.
+ *
  *  # Philosophy
  *
  *  This port of sundown is crafted in the style of Sean Barett's stb_ libraries
@@ -148,13 +311,14 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
-#ifndef SD_SINGLE_HEADER
-#define SD_SINGLE_HEADER
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*	the declarations are read once; the implementation once, by the first
+ *	#include with SD_IMPLEMENTATION, which can follow a plain one */
+#ifndef SD_SINGLE_HEADER
+
 // We disable CRT security warnings as the code is written for
 // _snprintf, not _snprintf_s.
 #define _CRT_SECURE_NO_WARNINGS 1
@@ -257,6 +421,22 @@ struct sd_callbacks {
 	/* header and footer */
 	void (*doc_header)(struct sd_buf *ob, void *opaque);
 	void (*doc_footer)(struct sd_buf *ob, void *opaque);
+
+	/* streaming tables - when table_begin is set, the body rows are
+	 * written to the output as they are parsed, between table_begin
+	 * and table_end, and table is not called */
+	void (*table_begin)(struct sd_buf *ob, const struct sd_buf *header, void *opaque);
+	void (*table_end)(struct sd_buf *ob, void *opaque);
+
+	/* write-through containers - when both halves are set, the contents
+	 * are rendered straight into ob between them, and the matching
+	 * blockquote, list or listitem callback is not called */
+	void (*blockquote_begin)(struct sd_buf *ob, void *opaque);
+	void (*blockquote_end)(struct sd_buf *ob, void *opaque);
+	void (*list_begin)(struct sd_buf *ob, int flags, void *opaque);
+	void (*list_end)(struct sd_buf *ob, int flags, void *opaque);
+	void (*listitem_begin)(struct sd_buf *ob, int flags, void *opaque);
+	void (*listitem_end)(struct sd_buf *ob, int flags, void *opaque);
 };
 
 struct sd_markdown;
@@ -283,6 +463,16 @@ sd_markdown_new(
 extern void
 sd_markdown_render(struct sd_buf *outbuffer, const uint8_t *document, size_t doc_size, struct sd_markdown *md);
 
+/* sd_fanout • a parser rendering into its own buffer alongside another one */
+struct sd_fanout {
+	struct sd_markdown *md;
+	struct sd_buf *ob;
+};
+
+extern void
+sd_markdown_render_fanout(struct sd_buf *outbuffer, const uint8_t *document, size_t doc_size,
+	struct sd_markdown *md, const struct sd_fanout *fans, size_t nfans);
+
 extern void
 sd_markdown_free(struct sd_markdown *md);
 
@@ -376,6 +566,80 @@ sd_autolink__url(size_t *rewind_p, struct sd_buf *link,
 
 // ENDREGION: AUTOLINK.H
 
+// REGION: ENTITIES.H
+
+/* longest UTF-8 expansion of a single entity (two 4-byte codepoints) */
+#define SD_ENTITY_MAX_UTF8 8
+
+/* sd_entity_decode • decodes one "&name;", "&#nnn;" or "&#xhhh;" entity into
+ * out (at least SD_ENTITY_MAX_UTF8 bytes), returns the UTF-8 length or 0 when
+ * the entity is unknown */
+size_t
+sd_entity_decode(uint8_t *out, const uint8_t *entity, size_t entity_size);
+
+// ENDREGION: ENTITIES.H
+
+// REGION: CACHE.H
+
+/* the cache locks need GCC, Clang or MSVC atomics, C11 ones, or the
+ * SD_CACHE_LOCK and SD_CACHE_UNLOCK of the user; without any, the cache
+ * has to be left out with SD_NO_CACHE */
+#if !defined(SD_NO_CACHE) && !defined(SD_CACHE_LOCK) && \
+	!defined(__GNUC__) && !defined(_MSC_VER) && \
+	!(defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__))
+#error "define SD_CACHE_LOCK(l) and SD_CACHE_UNLOCK(l) for this compiler, or SD_NO_CACHE"
+#endif
+
+#ifndef SD_NO_CACHE
+
+/* sd_cache • rendered documents, shared by any number of threads */
+struct sd_cache;
+
+/* sd_cache_stats • counters of a cache, summed over its stripes */
+struct sd_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t block_hits;	/* top-level blocks of sd_cache_render_blocks */
+	uint64_t block_misses;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;
+};
+
+/* sd_cache_new • a cache holding at most max_bytes of rendered output */
+struct sd_cache *
+sd_cache_new(size_t max_bytes);
+
+/* sd_cache_free • frees a cache no thread is rendering through */
+void
+sd_cache_free(struct sd_cache *cache);
+
+/* sd_cache_render • sd_markdown_render, through the cache */
+/*	render_flags stands for whatever else the output depends on, such as
+ *	the html_renderopt flags; only renders into an empty ob are cached.
+ *	Returns 1 when the output came from the cache */
+int
+sd_cache_render(struct sd_buf *ob, const uint8_t *document, size_t doc_size,
+	struct sd_markdown *md, struct sd_cache *cache, unsigned int render_flags);
+
+/* sd_cache_render_blocks • sd_markdown_render, splicing in the top-level
+ * blocks found in the cache rather than parsing them */
+/*	state is the part of the renderer's opaque data carried from a block to
+ *	the next, such as the first SDHTML_STATE_SIZE bytes of html_renderopt,
+ *	or NULL. Returns the number of top-level blocks that were parsed */
+size_t
+sd_cache_render_blocks(struct sd_buf *ob, const uint8_t *document, size_t doc_size,
+	struct sd_markdown *md, struct sd_cache *cache, unsigned int render_flags,
+	void *state, size_t state_size);
+
+/* sd_cache_stats • reads the counters of the cache */
+void
+sd_cache_stats(struct sd_cache *cache, struct sd_cache_stats *stats);
+
+#endif // SD_NO_CACHE
+
+// ENDREGION: CACHE.H
+
 // REGION: STACK.H
 
 struct stack {
@@ -458,7 +722,7 @@ static unsigned char gperf_downcase[256] =
 #ifndef GPERF_CASE_STRNCMP
 #define GPERF_CASE_STRNCMP 1
 static int
-gperf_case_strncmp (register const char *s1, register const char *s2, register unsigned int n)
+gperf_case_strncmp (const char *s1, const char *s2, unsigned int n)
 {
   for (; n > 0;)
     {
@@ -483,7 +747,7 @@ inline
 #endif
 #endif
 static unsigned int
-hash_block_tag (register const char *str, register unsigned int len)
+hash_block_tag (const char *str, unsigned int len)
 {
   static const unsigned char asso_values[] =
     {
@@ -514,7 +778,7 @@ hash_block_tag (register const char *str, register unsigned int len)
       38, 38, 38, 38, 38, 38, 38, 38, 38, 38,
       38, 38, 38, 38, 38, 38, 38
     };
-  register int hval = len;
+  int hval = len;
 
   switch (hval)
     {
@@ -530,16 +794,109 @@ hash_block_tag (register const char *str, register unsigned int len)
 
 // ENDREGION: HTML_BLOCKS.H
 
-#ifdef SD_IMPLEMENTATION
+// REGION: MARKDOWN.HPP
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L || _MSVC_LANG >= 201103L) && !defined(SD_NO_CPP)
+
+}	/* extern "C" */
+
+namespace sd {
+namespace detail {
+
+template <class... T> inline void unused(T &&...) {}
+
+/* SD_CPP_CALLBACKS • every sd_callbacks slot, as X(ret, name, params, args) */
+#define SD_CPP_CALLBACKS(X) \
+	X(void, blockcode, (struct sd_buf *ob, const struct sd_buf *text, const struct sd_buf *lang, void *opaque), (ob, text, lang)) \
+	X(void, blockquote, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(void, blockhtml, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(void, header, (struct sd_buf *ob, const struct sd_buf *text, int level, void *opaque), (ob, text, level)) \
+	X(void, hrule, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(void, list, (struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque), (ob, text, flags)) \
+	X(void, listitem, (struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque), (ob, text, flags)) \
+	X(void, paragraph, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(void, table, (struct sd_buf *ob, const struct sd_buf *header, const struct sd_buf *body, void *opaque), (ob, header, body)) \
+	X(void, table_row, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(void, table_cell, (struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque), (ob, text, flags)) \
+	X(int, autolink, (struct sd_buf *ob, const struct sd_buf *link, enum mkd_autolink type, void *opaque), (ob, link, type)) \
+	X(int, codespan, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(int, double_emphasis, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(int, emphasis, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(int, image, (struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *alt, void *opaque), (ob, link, title, alt)) \
+	X(int, linebreak, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(int, link, (struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *content, void *opaque), (ob, link, title, content)) \
+	X(int, raw_html_tag, (struct sd_buf *ob, const struct sd_buf *tag, void *opaque), (ob, tag)) \
+	X(int, triple_emphasis, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(int, strikethrough, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(int, superscript, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(void, entity, (struct sd_buf *ob, const struct sd_buf *entity, void *opaque), (ob, entity)) \
+	X(void, normal_text, (struct sd_buf *ob, const struct sd_buf *text, void *opaque), (ob, text)) \
+	X(void, doc_header, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(void, doc_footer, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(void, table_begin, (struct sd_buf *ob, const struct sd_buf *header, void *opaque), (ob, header)) \
+	X(void, table_end, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(void, blockquote_begin, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(void, blockquote_end, (struct sd_buf *ob, void *opaque), (ob)) \
+	X(void, list_begin, (struct sd_buf *ob, int flags, void *opaque), (ob, flags)) \
+	X(void, list_end, (struct sd_buf *ob, int flags, void *opaque), (ob, flags)) \
+	X(void, listitem_begin, (struct sd_buf *ob, int flags, void *opaque), (ob, flags)) \
+	X(void, listitem_end, (struct sd_buf *ob, int flags, void *opaque), (ob, flags))
+
+/* <name>_slot • the slot of one callback for the renderer type R */
+/*	bound says whether R has the member; thunk calls it on the renderer
+ *	the opaque pointer holds. Without the member, thunk does nothing and
+ *	is never put in a table */
+#define SD_CPP_SLOT(ret, name, params, args) \
+	template <class R, class = void> struct name##_slot { \
+		static const bool bound = false; \
+		static ret thunk params { unused(opaque); return unused args, ret(); } \
+	}; \
+	template <class R> struct name##_slot<R, decltype((void)&R::name)> { \
+		static const bool bound = true; \
+		static ret thunk params { return static_cast<R *>(opaque)->name args; } \
+	};
 
-#ifdef __GNUC__
+SD_CPP_CALLBACKS(SD_CPP_SLOT)
+
+#define SD_CPP_BIND(ret, name, params, args) \
+	if (name##_slot<R>::bound) \
+		cb->name = &name##_slot<R>::thunk;
+
+} // namespace detail
+
+/* callbacks • fills cb from the members of R; slots without one stay NULL */
+template <class R>
+inline void
+callbacks(struct sd_callbacks *cb)
+{
+	memset(cb, 0x0, sizeof(struct sd_callbacks));
+	{
+		using namespace detail;
+		SD_CPP_CALLBACKS(SD_CPP_BIND)
+	}
+}
+
+} // namespace sd
+
+extern "C" {
+
+#endif // __cplusplus
+
+// ENDREGION: MARKDOWN.HPP
+
+#endif // SD_SINGLE_HEADER
+
+#if defined(SD_IMPLEMENTATION) && !defined(SD_SINGLE_HEADER_IMPLEMENTATION)
+
+/* in C++, gnu_inline is extern inline and would leave no definition */
+#if defined(__GNUC__) && !defined(__cplusplus)
 __inline
 #ifdef __GNUC_STDC_INLINE__
 __attribute__ ((__gnu_inline__))
 #endif
 #endif
 const char *
-find_block_tag (register const char *str, register unsigned int len)
+find_block_tag (const char *str, unsigned int len)
 {
   enum
     {
@@ -588,11 +945,11 @@ find_block_tag (register const char *str, register unsigned int len)
 
   if (len <= MAX_WORD_LENGTH && len >= MIN_WORD_LENGTH)
     {
-      register int key = hash_block_tag (str, len);
+      int key = hash_block_tag (str, len);
 
       if (key <= MAX_HASH_VALUE && key >= 0)
         {
-          register const char *s = wordlist[key];
+          const char *s = wordlist[key];
 
           if ((((unsigned char)*str ^ (unsigned char)*s) & ~32) == 0 && !gperf_case_strncmp (str, s, len) && s[len] == '\0')
             return s;
@@ -652,7 +1009,7 @@ sd_bufgrow(struct sd_buf *buf, size_t neosz)
 	if (!neodata)
 		return BUF_ENOMEM;
 
-	buf->data = neodata;
+	buf->data = (uint8_t *)neodata;
 	buf->asize = neoasz;
 	return BUF_OK;
 }
@@ -663,7 +1020,7 @@ struct sd_buf *
 sd_bufnew(size_t unit)
 {
 	struct sd_buf *ret;
-	ret = malloc(sizeof (struct sd_buf));
+	ret = (struct sd_buf *)malloc(sizeof (struct sd_buf));
 
 	if (ret) {
 		ret->data = 0;
@@ -808,22 +1165,72 @@ sd_bufslurp(struct sd_buf *buf, size_t len)
 
 // REGION: AUTOLINK.C
 
+/* character classes used by the autolink recognizers; the table is
+ * locale-independent, with the C locale meaning of isalpha & friends.
+ * NUL is part of the email and trim classes on purpose: the former
+ * strchr()-based tests matched the string terminator as well */
+enum {
+	AUTOLINK_ALPHA = (1 << 0),
+	AUTOLINK_DIGIT = (1 << 1),
+	AUTOLINK_DOMAIN = (1 << 2),	/* [A-Za-z0-9-] */
+	AUTOLINK_EMAIL = (1 << 3),	/* [A-Za-z0-9.+_-] */
+	AUTOLINK_TRIM = (1 << 4),	/* [?!.,] trailing punctuation */
+	AUTOLINK_SPACE = (1 << 5),
+	AUTOLINK_PUNCT = (1 << 6),
+
+	AUTOLINK_ALNUM = AUTOLINK_ALPHA | AUTOLINK_DIGIT,
+};
+
+static const uint8_t AUTOLINK_CHARS[] = {
+	24,  0,  0,  0,  0,  0,  0,  0,  0, 32, 32, 32, 32, 32,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	32, 80, 64, 64, 64, 64, 64, 64, 64, 64, 64, 72, 80, 76, 88, 64,
+	14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 64, 64, 64, 64, 64, 80,
+	64, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+	13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 64, 64, 64, 64, 72,
+	64, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+	13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 64, 64, 64, 64,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+#define autolink_is(c, cls) ((AUTOLINK_CHARS[(uint8_t)(c)] & (cls)) != 0)
+
+/* allowlist for sd_autolink_issafe; define SD_AUTOLINK_SCHEMES before
+ * including the implementation to replace it. Entries are lowercase
+ * prefixes, and a link is safe when one of them is followed by an
+ * alphanumeric character */
+#ifndef SD_AUTOLINK_SCHEMES
+#define SD_AUTOLINK_SCHEMES "/", "http://", "https://", "ftp://", "mailto:"
+#endif
+
 int
 sd_autolink_issafe(const uint8_t *link, size_t link_len)
 {
-	static const size_t valid_uris_count = 5;
-	static const char *valid_uris[] = {
-		"/", "http://", "https://", "ftp://", "mailto:"
-	};
+	static const char *valid_uris[] = { SD_AUTOLINK_SCHEMES };
+	static const size_t valid_uris_count = sizeof(valid_uris) / sizeof(valid_uris[0]);
 
-	size_t i;
+	size_t i, len;
+
+	if (link_len == 0)
+		return 0;
 
 	for (i = 0; i < valid_uris_count; ++i) {
-		size_t len = strlen(valid_uris[i]);
+		const uint8_t *uri = (const uint8_t *)valid_uris[i];
+
+		/* a single pass over the prefix, no strlen */
+		for (len = 0; uri[len] != 0 && len < link_len; ++len)
+			if (tolower(link[len]) != tolower(uri[len]))
+				break;
 
-		if (link_len > len &&
-			strncasecmp((char *)link, valid_uris[i], len) == 0 &&
-			isalnum(link[len]))
+		if (uri[len] == 0 && len < link_len &&
+			autolink_is(link[len], AUTOLINK_ALNUM))
 			return 1;
 	}
 
@@ -834,22 +1241,19 @@ static size_t
 autolink_delim(uint8_t *data, size_t link_end, size_t max_rewind, size_t size)
 {
 	uint8_t cclose, copen = 0;
-	size_t i;
+	uint8_t *lt;
 
-	for (i = 0; i < link_end; ++i)
-		if (data[i] == '<') {
-			link_end = i;
-			break;
-		}
+	if ((lt = (uint8_t *)memchr(data, '<', link_end)) != NULL)
+		link_end = lt - data;
 
 	while (link_end > 0) {
-		if (strchr("?!.,", data[link_end - 1]) != NULL)
+		if (autolink_is(data[link_end - 1], AUTOLINK_TRIM))
 			link_end--;
 
 		else if (data[link_end - 1] == ';') {
 			size_t new_end = link_end - 2;
 
-			while (new_end > 0 && isalpha(data[new_end]))
+			while (new_end > 0 && autolink_is(data[new_end], AUTOLINK_ALPHA))
 				new_end--;
 
 			if (new_end < link_end - 2 && data[new_end] == '&')
@@ -919,12 +1323,12 @@ check_domain(uint8_t *data, size_t size, int allow_short)
 {
 	size_t i, np = 0;
 
-	if (!isalnum(data[0]))
+	if (!autolink_is(data[0], AUTOLINK_ALNUM))
 		return 0;
 
 	for (i = 1; i < size - 1; ++i) {
 		if (data[i] == '.') np++;
-		else if (!isalnum(data[i]) && data[i] != '-') break;
+		else if (!autolink_is(data[i], AUTOLINK_DOMAIN)) break;
 	}
 
 	if (allow_short) {
@@ -940,6 +1344,16 @@ check_domain(uint8_t *data, size_t size, int allow_short)
 	}
 }
 
+/* autolink_span_end • end of the whitespace-free run starting at i */
+static inline size_t
+autolink_span_end(uint8_t *data, size_t i, size_t size)
+{
+	while (i < size && !autolink_is(data[i], AUTOLINK_SPACE))
+		i++;
+
+	return i;
+}
+
 size_t
 sd_autolink__www(
 	size_t *rewind_p,
@@ -951,20 +1365,18 @@ sd_autolink__www(
 {
 	size_t link_end;
 
-	if (max_rewind > 0 && !ispunct(data[-1]) && !isspace(data[-1]))
+	if (max_rewind > 0 && !autolink_is(data[-1], AUTOLINK_PUNCT | AUTOLINK_SPACE))
 		return 0;
 
-	if (size < 4 || memcmp(data, "www.", strlen("www.")) != 0)
+	if (size < 4 || memcmp(data, "www.", 4) != 0)
 		return 0;
 
-	link_end = check_domain(data, size, 0);
+	link_end = check_domain(data, size, flags & SD_AUTOLINK_SHORT_DOMAINS);
 
 	if (link_end == 0)
 		return 0;
 
-	while (link_end < size && !isspace(data[link_end]))
-		link_end++;
-
+	link_end = autolink_span_end(data, link_end, size);
 	link_end = autolink_delim(data, link_end, max_rewind, size);
 
 	if (link_end == 0)
@@ -988,17 +1400,9 @@ sd_autolink__email(
 	size_t link_end, rewind;
 	int nb = 0, np = 0;
 
-	for (rewind = 0; rewind < max_rewind; ++rewind) {
-		uint8_t c = data[(-rewind - 1)];
-
-		if (isalnum(c))
-			continue;
-
-		if (strchr(".+-_", c) != NULL)
-			continue;
-
-		break;
-	}
+	for (rewind = 0; rewind < max_rewind; ++rewind)
+		if (!autolink_is(data[(-rewind - 1)], AUTOLINK_EMAIL))
+			break;
 
 	if (rewind == 0)
 		return 0;
@@ -1006,19 +1410,24 @@ sd_autolink__email(
 	for (link_end = 0; link_end < size; ++link_end) {
 		uint8_t c = data[link_end];
 
-		if (isalnum(c))
+		if (autolink_is(c, AUTOLINK_ALNUM))
 			continue;
 
-		if (c == '@')
-			nb++;
-		else if (c == '.' && link_end < size - 1)
+		/* a second '@' rules the address out, so the scan stops there
+		 * and a run of "a@a@..." is not scanned again from every '@' */
+		if (c == '@') {
+			if (nb++)
+				break;
+		} else if (c == '.' && link_end < size - 1)
 			np++;
 		else if (c != '-' && c != '_')
 			break;
 	}
 
-	if (link_end < 2 || nb != 1 || np == 0 ||
-		!isalpha(data[link_end - 1]))
+	/* an address without a dot is only taken with SD_AUTOLINK_SHORT_DOMAINS */
+	if (link_end < 2 || nb != 1 ||
+		(np == 0 && !(flags & SD_AUTOLINK_SHORT_DOMAINS)) ||
+		!autolink_is(data[link_end - 1], AUTOLINK_ALPHA))
 		return 0;
 
 	link_end = autolink_delim(data, link_end, max_rewind, size);
@@ -1046,7 +1455,7 @@ sd_autolink__url(
 	if (size < 4 || data[1] != '/' || data[2] != '/')
 		return 0;
 
-	while (rewind < max_rewind && isalpha(data[-rewind - 1]))
+	while (rewind < max_rewind && autolink_is(data[-rewind - 1], AUTOLINK_ALPHA))
 		rewind++;
 
 	if (!sd_autolink_issafe(data - rewind, size + rewind))
@@ -1062,10 +1471,7 @@ sd_autolink__url(
 	if (domain_len == 0)
 		return 0;
 
-	link_end += domain_len;
-	while (link_end < size && !isspace(data[link_end]))
-		link_end++;
-
+	link_end = autolink_span_end(data, link_end + domain_len, size);
 	link_end = autolink_delim(data, link_end, max_rewind, size);
 
 	if (link_end == 0)
@@ -1079,3492 +1485,7656 @@ sd_autolink__url(
 
 // ENDREGION: AUTOLINK.C
 
-// REGION: MARKDOWN.C
-
-#define REF_TABLE_SIZE 8
-
-#define BUFFER_BLOCK 0
-#define BUFFER_SPAN 1
-
-#define MKD_LI_END 8	/* internal list flag */
-
-#define gperf_case_strncmp(s1, s2, n) strncasecmp(s1, s2, n)
-#define GPERF_DOWNCASE 1
-#define GPERF_CASE_STRNCMP 1
-
-/***************
- * LOCAL TYPES *
- ***************/
-
-/* link_ref: reference to a link */
-struct link_ref {
-	unsigned int id;
+// REGION: ENTITIES.C
 
-	struct sd_buf *link;
-	struct sd_buf *title;
+/* The named entity table is the WHATWG HTML5 list (entities ending in ';'),
+ * keyed without the leading '&' and trailing ';'. It is a minimal perfect
+ * hash in the "hash and displace" style: the unseeded hash of a name picks a
+ * bucket in ENTITY_SEEDS, and hashing again with that bucket's seed gives the
+ * only slot of HTML_ENTITIES the name can live in. Regenerating the table means
+ * searching, bucket by bucket (largest first), for the smallest seed that sends
+ * every name of the bucket to a free slot. */
 
-	struct link_ref *next;
+struct html_entity {
+	const char *name;
+	uint32_t codepoint;
+	uint32_t extra; /* second codepoint, or 0 */
 };
 
-/* char_trigger: function pointer to render active chars */
-/*   returns the number of chars taken care of */
-/*   data is the pointer of the beginning of the span */
-/*   offset is the number of valid chars before data */
-struct sd_markdown;
-typedef size_t
-(*char_trigger)(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-
-static size_t char_emphasis(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_linebreak(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_codespan(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_escape(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_entity(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_langle_tag(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_autolink_url(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_autolink_email(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_autolink_www(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_link(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
-static size_t char_superscript(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+#define ENTITY_MAX_NAME 31
+#define ENTITY_SLOTS 2125
+#define ENTITY_BUCKETS 532
+
+static const uint16_t ENTITY_SEEDS[ENTITY_BUCKETS] = {
+	   37,     8,     3,   444,    14,   423,    86,     8,    36,    32,     6,    16,
+	   14,    53,    16,   214,    85,   150,    31,    19,    65,    16,     6,     1,
+	    1,   112,     6,   126,   302,    11,   117,     6,   116,    33,     1,   181,
+	   81,   214,     1,    89,    11,    12,     1,    26,    69,   150,     0,    42,
+	    1,   142,   133,    17,     1,    12,     4,   124,     3,     9,    65,     1,
+	   54,    22,    64,   106,     2,    97,   163,    27,    10,    12,    81,     1,
+	    0,    89,     2,    68,     6,    12,   190,   255,     1,    37,     1,     1,
+	    3,    16,     3,    33,    30,     1,    94,     3,    28,     6,    17,   193,
+	   24,     0,     1,     6,     3,     4,    24,    86,     2,   380,   205,     1,
+	   26,     4,    11,     1,     7,    12,     4,    55,    24,    15,    48,    11,
+	  338,     7,    14,     8,    14,    35,     1,     0,    19,   223,    62,     9,
+	    1,   392,   182,   148,    34,    16,   583,     1,   165,     3,   535,    20,
+	  128,   160,    26,   200,    14,    49,   143,     1,    64,   208,    34,     3,
+	    1,   239,     8,   322,   191,   120,     3,   111,   163,   150,    22,     1,
+	   36,   369,     5,     2,    21,    22,    38,    44,    11,     1,    12,     8,
+	   15,   424,     7,   142,    60,     2,     8,   136,     1,   306,     1,    44,
+	   49,   161,    35,     1,     1,   439,   111,    73,   275,     9,   114,     6,
+	    4,    21,     9,    38,    67,   218,     9,   878,   141,     9,     1,   177,
+	  142,    60,   109,   905,    32,    19,     3,    11,   119,     1,  1018,   148,
+	  520,    97,     8,     2,    55,    10,    37,     1,    18,    89,     4,    36,
+	   71,    20,    52,   481,     2,     3,   128,     6,    52,    21,     2,   252,
+	   34,   232,    91,    90,    21,   213,     2,     1,   142,    66,     4,    64,
+	   41,   470,    23,    45,     2,    78,   185,   153,   122,     2,   329,    20,
+	  179,    12,     1,   125,    60,     1,     1,     8,    83,    20,   208,     9,
+	   28,   143,   409,    58,     3,   273,    72,    46,     2,     1,   144,   180,
+	  164,   113,   135,     3,  1360,     0,   105,   242,     7,   366,    14,     5,
+	   88,   189,   372,     1,   652,     9,    67,   107,   150,     2,    43,   518,
+	   52,   512,    91,   213,   491,    83,   174,   803,   559,    14,     7,   754,
+	  144,    14,   388,     5,   300,   374,   319,   203,   479,    50,   185,   497,
+	  213,     4,     7,  1603,   268,   678,    64,    67,   267,    32,   110,   579,
+	  398,    35,    91,    20,    12,     4,   228,   116,   565,    38,     4,   437,
+	  157,     0,   214,   769,   610,   202,    48,    61,   110,   188,    15,   338,
+	   14,   535,   252,     1,     9,   876,    59,   207,     1,    33,  1951,     9,
+	  268,     6,     1,   133,  1080,   576,   730,     3,   179,     6,   498,    66,
+	  345,  1220,     8,   190,     2,   236,     2,    10,   208,    47,    10,   134,
+	   87,     1,     3,    21,   171,   173,    15,    99,     2,     8,   235,    20,
+	    4,    73,   754,     6,   185,    66,   767,   164,   425,    39,     1,  1886,
+	 1981,   519,   441,   242,    56,     9,     1,   224,    11,  1191,  1036,     1,
+	  701,    31,  1288,     7,  2548,   902,    95,   609,   129,   556,   837,    87,
+	 2404,     3,     3,   579,    26,   164,     1,   113,  2825,     5,    73,    76,
+	  479,   430,   109,    24,    53,     7,     1,   130,    25,    17,     3,    25,
+	 6279,     0,    37,    76,  1166,   200,   942,   956,   426,    20,    38,  2333,
+	  669,  1399,     9,   278,    19,    15,   278,     5,    18,    52,   126,   564,
+	  421,     3,   186,   101,     1,    23,     0,    46,  3490,     9,   665,     4,
+	   51,   119,    14,   354,
+};
 
-enum markdown_char_t {
-	MD_CHAR_NONE = 0,
-	MD_CHAR_EMPHASIS,
-	MD_CHAR_CODESPAN,
-	MD_CHAR_LINEBREAK,
-	MD_CHAR_LINK,
-	MD_CHAR_LANGLE,
-	MD_CHAR_ESCAPE,
-	MD_CHAR_ENTITITY,
-	MD_CHAR_AUTOLINK_URL,
-	MD_CHAR_AUTOLINK_EMAIL,
-	MD_CHAR_AUTOLINK_WWW,
-	MD_CHAR_SUPERSCRIPT,
+static const struct html_entity HTML_ENTITIES[ENTITY_SLOTS] = {
+	{ "downdownarrows", 0x21CA, 0 }, { "gscr", 0x210A, 0 }, { "bigsqcup", 0x2A06, 0 },
+	{ "duarr", 0x21F5, 0 }, { "oS", 0x24C8, 0 }, { "olt", 0x29C0, 0 }, { "laquo", 0xAB, 0 },
+	{ "gammad", 0x3DD, 0 }, { "Zacute", 0x179, 0 }, { "SOFTcy", 0x42C, 0 },
+	{ "LessFullEqual", 0x2266, 0 }, { "acy", 0x430, 0 }, { "ForAll", 0x2200, 0 },
+	{ "ifr", 0x1D526, 0 }, { "apE", 0x2A70, 0 }, { "iinfin", 0x29DC, 0 }, { "aelig", 0xE6, 0 },
+	{ "mp", 0x2213, 0 }, { "quot", 0x22, 0 }, { "Eacute", 0xC9, 0 }, { "notin", 0x2209, 0 },
+	{ "Implies", 0x21D2, 0 }, { "sub", 0x2282, 0 }, { "Psi", 0x3A8, 0 }, { "tfr", 0x1D531, 0 },
+	{ "propto", 0x221D, 0 }, { "DScy", 0x405, 0 }, { "ZeroWidthSpace", 0x200B, 0 },
+	{ "trianglerighteq", 0x22B5, 0 }, { "searhk", 0x2925, 0 }, { "smashp", 0x2A33, 0 },
+	{ "UnderBracket", 0x23B5, 0 }, { "CircleDot", 0x2299, 0 }, { "Element", 0x2208, 0 },
+	{ "Kcy", 0x41A, 0 }, { "varepsilon", 0x3F5, 0 }, { "timesd", 0x2A30, 0 },
+	{ "LeftTeeArrow", 0x21A4, 0 }, { "bigoplus", 0x2A01, 0 }, { "Longleftarrow", 0x27F8, 0 },
+	{ "mfr", 0x1D52A, 0 }, { "FilledSmallSquare", 0x25FC, 0 }, { "subE", 0x2AC5, 0 },
+	{ "szlig", 0xDF, 0 }, { "Rscr", 0x211B, 0 }, { "beth", 0x2136, 0 }, { "hstrok", 0x127, 0 },
+	{ "gtlPar", 0x2995, 0 }, { "measuredangle", 0x2221, 0 }, { "cuesc", 0x22DF, 0 },
+	{ "mDDot", 0x223A, 0 }, { "sup", 0x2283, 0 }, { "GreaterGreater", 0x2AA2, 0 },
+	{ "rtri", 0x25B9, 0 }, { "sdote", 0x2A66, 0 }, { "oast", 0x229B, 0 }, { "glE", 0x2A92, 0 },
+	{ "IJlig", 0x132, 0 }, { "oint", 0x222E, 0 }, { "boxvL", 0x2561, 0 }, { "icirc", 0xEE, 0 },
+	{ "rpargt", 0x2994, 0 }, { "lfloor", 0x230A, 0 }, { "Hscr", 0x210B, 0 }, { "acd", 0x223F, 0 },
+	{ "blacktriangleleft", 0x25C2, 0 }, { "Fcy", 0x424, 0 }, { "PartialD", 0x2202, 0 },
+	{ "Lcaron", 0x13D, 0 }, { "fflig", 0xFB00, 0 }, { "NotGreaterFullEqual", 0x2267, 0x338 },
+	{ "Amacr", 0x100, 0 }, { "sfr", 0x1D530, 0 }, { "iuml", 0xEF, 0 }, { "plustwo", 0x2A27, 0 },
+	{ "apid", 0x224B, 0 }, { "ffllig", 0xFB04, 0 }, { "homtht", 0x223B, 0 }, { "vprop", 0x221D, 0 },
+	{ "gvnE", 0x2269, 0xFE00 }, { "ngeqslant", 0x2A7E, 0x338 }, { "afr", 0x1D51E, 0 },
+	{ "cylcty", 0x232D, 0 }, { "boxUR", 0x255A, 0 }, { "thksim", 0x223C, 0 },
+	{ "circlearrowright", 0x21BB, 0 }, { "nsqsube", 0x22E2, 0 }, { "sharp", 0x266F, 0 },
+	{ "doublebarwedge", 0x2306, 0 }, { "LongLeftRightArrow", 0x27F7, 0 }, { "ecir", 0x2256, 0 },
+	{ "vscr", 0x1D4CB, 0 }, { "tcaron", 0x165, 0 }, { "subnE", 0x2ACB, 0 }, { "cong", 0x2245, 0 },
+	{ "NotCupCap", 0x226D, 0 }, { "bumpe", 0x224F, 0 }, { "nvge", 0x2265, 0x20D2 },
+	{ "nsub", 0x2284, 0 }, { "shy", 0xAD, 0 }, { "DiacriticalDot", 0x2D9, 0 },
+	{ "LowerLeftArrow", 0x2199, 0 }, { "succneqq", 0x2AB6, 0 }, { "itilde", 0x129, 0 },
+	{ "nleqq", 0x2266, 0x338 }, { "boxhd", 0x252C, 0 }, { "easter", 0x2A6E, 0 }, { "lg", 0x2276, 0 },
+	{ "rbrace", 0x7D, 0 }, { "sup2", 0xB2, 0 }, { "DZcy", 0x40F, 0 },
+	{ "RightDownTeeVector", 0x295D, 0 }, { "nVdash", 0x22AE, 0 }, { "bbrktbrk", 0x23B6, 0 },
+	{ "profsurf", 0x2313, 0 }, { "uarr", 0x2191, 0 }, { "CirclePlus", 0x2295, 0 },
+	{ "DiacriticalGrave", 0x60, 0 }, { "lparlt", 0x2993, 0 }, { "nsubE", 0x2AC5, 0x338 },
+	{ "nleftrightarrow", 0x21AE, 0 }, { "iquest", 0xBF, 0 }, { "times", 0xD7, 0 },
+	{ "scap", 0x2AB8, 0 }, { "ldquo", 0x201C, 0 }, { "ofr", 0x1D52C, 0 }, { "Yfr", 0x1D51C, 0 },
+	{ "lsquo", 0x2018, 0 }, { "DownRightTeeVector", 0x295F, 0 }, { "hearts", 0x2665, 0 },
+	{ "cdot", 0x10B, 0 }, { "SubsetEqual", 0x2286, 0 }, { "puncsp", 0x2008, 0 }, { "ordm", 0xBA, 0 },
+	{ "bottom", 0x22A5, 0 }, { "Lscr", 0x2112, 0 }, { "OverBrace", 0x23DE, 0 },
+	{ "Bernoullis", 0x212C, 0 }, { "varsigma", 0x3C2, 0 }, { "succsim", 0x227F, 0 },
+	{ "Proportional", 0x221D, 0 }, { "parsl", 0x2AFD, 0 }, { "kappa", 0x3BA, 0 },
+	{ "rtimes", 0x22CA, 0 }, { "Darr", 0x21A1, 0 }, { "blk12", 0x2592, 0 }, { "Upsi", 0x3D2, 0 },
+	{ "pr", 0x227A, 0 }, { "gesdot", 0x2A80, 0 }, { "InvisibleTimes", 0x2062, 0 },
+	{ "Cayleys", 0x212D, 0 }, { "wcirc", 0x175, 0 }, { "lrarr", 0x21C6, 0 }, { "lang", 0x27E8, 0 },
+	{ "NotRightTriangleEqual", 0x22ED, 0 }, { "lozenge", 0x25CA, 0 }, { "ltrif", 0x25C2, 0 },
+	{ "harrcir", 0x2948, 0 }, { "imof", 0x22B7, 0 }, { "ldquor", 0x201E, 0 }, { "ecolon", 0x2255, 0 },
+	{ "supdot", 0x2ABE, 0 }, { "isinv", 0x2208, 0 }, { "Kopf", 0x1D542, 0 },
+	{ "GreaterTilde", 0x2273, 0 }, { "dopf", 0x1D555, 0 }, { "ldca", 0x2936, 0 },
+	{ "eDDot", 0x2A77, 0 }, { "MediumSpace", 0x205F, 0 }, { "phiv", 0x3D5, 0 },
+	{ "urcorner", 0x231D, 0 }, { "copysr", 0x2117, 0 }, { "Lacute", 0x139, 0 },
+	{ "boxUl", 0x255C, 0 }, { "Rfr", 0x211C, 0 }, { "MinusPlus", 0x2213, 0 }, { "bkarow", 0x290D, 0 },
+	{ "smeparsl", 0x29E4, 0 }, { "Oacute", 0xD3, 0 }, { "cupcap", 0x2A46, 0 }, { "boxhU", 0x2568, 0 },
+	{ "rAarr", 0x21DB, 0 }, { "boxVr", 0x255F, 0 }, { "TildeTilde", 0x2248, 0 },
+	{ "Uparrow", 0x21D1, 0 }, { "tridot", 0x25EC, 0 }, { "vartriangleleft", 0x22B2, 0 },
+	{ "HARDcy", 0x42A, 0 }, { "scE", 0x2AB4, 0 }, { "rarrfs", 0x291E, 0 }, { "angmsd", 0x2221, 0 },
+	{ "check", 0x2713, 0 }, { "Oopf", 0x1D546, 0 }, { "Uacute", 0xDA, 0 }, { "xcirc", 0x25EF, 0 },
+	{ "gt", 0x3E, 0 }, { "nlarr", 0x219A, 0 }, { "hellip", 0x2026, 0 }, { "odash", 0x229D, 0 },
+	{ "duhar", 0x296F, 0 }, { "squf", 0x25AA, 0 }, { "capcup", 0x2A47, 0 }, { "rbrkslu", 0x2990, 0 },
+	{ "trianglelefteq", 0x22B4, 0 }, { "CircleMinus", 0x2296, 0 }, { "Therefore", 0x2234, 0 },
+	{ "Ocirc", 0xD4, 0 }, { "otilde", 0xF5, 0 }, { "fjlig", 0x66, 0x6A },
+	{ "NotGreaterEqual", 0x2271, 0 }, { "uwangle", 0x29A7, 0 }, { "tritime", 0x2A3B, 0 },
+	{ "HumpEqual", 0x224F, 0 }, { "drcrop", 0x230C, 0 }, { "QUOT", 0x22, 0 }, { "boxDL", 0x2557, 0 },
+	{ "RightDownVector", 0x21C2, 0 }, { "vsupne", 0x228B, 0xFE00 }, { "Poincareplane", 0x210C, 0 },
+	{ "mcomma", 0x2A29, 0 }, { "wr", 0x2240, 0 }, { "Egrave", 0xC8, 0 }, { "xotime", 0x2A02, 0 },
+	{ "RightCeiling", 0x2309, 0 }, { "nmid", 0x2224, 0 }, { "ltdot", 0x22D6, 0 }, { "Acy", 0x410, 0 },
+	{ "rarrap", 0x2975, 0 }, { "zigrarr", 0x21DD, 0 }, { "ltri", 0x25C3, 0 },
+	{ "backsim", 0x223D, 0 }, { "nles", 0x2A7D, 0x338 }, { "zfr", 0x1D537, 0 }, { "Iukcy", 0x406, 0 },
+	{ "lbbrk", 0x2772, 0 }, { "notinvb", 0x22F7, 0 }, { "int", 0x222B, 0 }, { "simgE", 0x2AA0, 0 },
+	{ "rlarr", 0x21C4, 0 }, { "LeftRightVector", 0x294E, 0 }, { "otimes", 0x2297, 0 },
+	{ "boxbox", 0x29C9, 0 }, { "Zeta", 0x396, 0 }, { "ncedil", 0x146, 0 }, { "lcaron", 0x13E, 0 },
+	{ "nearhk", 0x2924, 0 }, { "ctdot", 0x22EF, 0 }, { "vsupnE", 0x2ACC, 0xFE00 },
+	{ "swarr", 0x2199, 0 }, { "SquareIntersection", 0x2293, 0 }, { "angrtvb", 0x22BE, 0 },
+	{ "xwedge", 0x22C0, 0 }, { "rtrif", 0x25B8, 0 }, { "utrif", 0x25B4, 0 }, { "Sfr", 0x1D516, 0 },
+	{ "not", 0xAC, 0 }, { "Ubreve", 0x16C, 0 }, { "nvap", 0x224D, 0x20D2 }, { "ngeq", 0x2271, 0 },
+	{ "NestedGreaterGreater", 0x226B, 0 }, { "DoubleLongRightArrow", 0x27F9, 0 },
+	{ "nGt", 0x226B, 0x20D2 }, { "nge", 0x2271, 0 }, { "fllig", 0xFB02, 0 }, { "divonx", 0x22C7, 0 },
+	{ "GJcy", 0x403, 0 }, { "lrcorner", 0x231F, 0 }, { "rsquo", 0x2019, 0 },
+	{ "nsubseteqq", 0x2AC5, 0x338 }, { "sqcaps", 0x2293, 0xFE00 }, { "shortparallel", 0x2225, 0 },
+	{ "ShortLeftArrow", 0x2190, 0 }, { "scaron", 0x161, 0 }, { "Sc", 0x2ABC, 0 },
+	{ "boxVH", 0x256C, 0 }, { "uscr", 0x1D4CA, 0 }, { "ccaron", 0x10D, 0 },
+	{ "NotExists", 0x2204, 0 }, { "vfr", 0x1D533, 0 }, { "wreath", 0x2240, 0 }, { "commat", 0x40, 0 },
+	{ "ii", 0x2148, 0 }, { "LeftArrowBar", 0x21E4, 0 }, { "phi", 0x3C6, 0 }, { "Lopf", 0x1D543, 0 },
+	{ "Efr", 0x1D508, 0 }, { "twixt", 0x226C, 0 }, { "angmsdab", 0x29A9, 0 },
+	{ "mapstodown", 0x21A7, 0 }, { "vsubne", 0x228A, 0xFE00 }, { "Ncy", 0x41D, 0 },
+	{ "OverParenthesis", 0x23DC, 0 }, { "Ropf", 0x211D, 0 }, { "jukcy", 0x454, 0 },
+	{ "ntilde", 0xF1, 0 }, { "delta", 0x3B4, 0 }, { "YUcy", 0x42E, 0 }, { "Dot", 0xA8, 0 },
+	{ "THORN", 0xDE, 0 }, { "cwconint", 0x2232, 0 }, { "omicron", 0x3BF, 0 }, { "reg", 0xAE, 0 },
+	{ "Dcy", 0x414, 0 }, { "nsucc", 0x2281, 0 }, { "Bfr", 0x1D505, 0 }, { "verbar", 0x7C, 0 },
+	{ "Escr", 0x2130, 0 }, { "hscr", 0x1D4BD, 0 }, { "Rarrtl", 0x2916, 0 }, { "ycirc", 0x177, 0 },
+	{ "nsupseteqq", 0x2AC6, 0x338 }, { "Uopf", 0x1D54C, 0 }, { "swarhk", 0x2926, 0 },
+	{ "leftrightharpoons", 0x21CB, 0 }, { "YAcy", 0x42F, 0 }, { "Sacute", 0x15A, 0 },
+	{ "lneqq", 0x2268, 0 }, { "circledcirc", 0x229A, 0 }, { "UpDownArrow", 0x2195, 0 },
+	{ "cacute", 0x107, 0 }, { "leftrightarrows", 0x21C6, 0 }, { "top", 0x22A4, 0 },
+	{ "larrtl", 0x21A2, 0 }, { "isinE", 0x22F9, 0 }, { "iiint", 0x222D, 0 }, { "sce", 0x2AB0, 0 },
+	{ "yfr", 0x1D536, 0 }, { "varrho", 0x3F1, 0 }, { "nLeftrightarrow", 0x21CE, 0 },
+	{ "supseteq", 0x2287, 0 }, { "Sum", 0x2211, 0 }, { "CloseCurlyDoubleQuote", 0x201D, 0 },
+	{ "zcy", 0x437, 0 }, { "angmsdad", 0x29AB, 0 }, { "Rrightarrow", 0x21DB, 0 },
+	{ "Jscr", 0x1D4A5, 0 }, { "complexes", 0x2102, 0 }, { "nltrie", 0x22EC, 0 },
+	{ "hcirc", 0x125, 0 }, { "map", 0x21A6, 0 }, { "mapsto", 0x21A6, 0 }, { "Ntilde", 0xD1, 0 },
+	{ "downharpoonleft", 0x21C3, 0 }, { "gcirc", 0x11D, 0 }, { "Alpha", 0x391, 0 },
+	{ "NegativeThinSpace", 0x200B, 0 }, { "Ofr", 0x1D512, 0 }, { "Lambda", 0x39B, 0 },
+	{ "Conint", 0x222F, 0 }, { "Gamma", 0x393, 0 }, { "nle", 0x2270, 0 },
+	{ "RightUpVectorBar", 0x2954, 0 }, { "kfr", 0x1D528, 0 }, { "iocy", 0x451, 0 },
+	{ "rarrbfs", 0x2920, 0 }, { "solb", 0x29C4, 0 }, { "Gt", 0x226B, 0 }, { "urtri", 0x25F9, 0 },
+	{ "rightarrowtail", 0x21A3, 0 }, { "nshortparallel", 0x2226, 0 }, { "Gg", 0x22D9, 0 },
+	{ "hairsp", 0x200A, 0 }, { "para", 0xB6, 0 }, { "uArr", 0x21D1, 0 }, { "Tau", 0x3A4, 0 },
+	{ "ntrianglelefteq", 0x22EC, 0 }, { "ReverseUpEquilibrium", 0x296F, 0 },
+	{ "leftarrow", 0x2190, 0 }, { "looparrowleft", 0x21AB, 0 }, { "Phi", 0x3A6, 0 },
+	{ "leq", 0x2264, 0 }, { "Omacr", 0x14C, 0 }, { "Mopf", 0x1D544, 0 }, { "circledR", 0xAE, 0 },
+	{ "bump", 0x224E, 0 }, { "cupdot", 0x228D, 0 }, { "Agrave", 0xC0, 0 },
+	{ "NotLeftTriangleBar", 0x29CF, 0x338 }, { "mapstoup", 0x21A5, 0 }, { "daleth", 0x2138, 0 },
+	{ "NotEqualTilde", 0x2242, 0x338 }, { "lesges", 0x2A93, 0 }, { "uplus", 0x228E, 0 },
+	{ "LT", 0x3C, 0 }, { "dagger", 0x2020, 0 }, { "gg", 0x226B, 0 }, { "boxUL", 0x255D, 0 },
+	{ "isins", 0x22F4, 0 }, { "mapstoleft", 0x21A4, 0 }, { "frac25", 0x2156, 0 },
+	{ "Bscr", 0x212C, 0 }, { "LeftTeeVector", 0x295A, 0 }, { "aacute", 0xE1, 0 },
+	{ "smile", 0x2323, 0 }, { "models", 0x22A7, 0 }, { "jcirc", 0x135, 0 },
+	{ "triangleleft", 0x25C3, 0 }, { "ratail", 0x291A, 0 }, { "ldrdhar", 0x2967, 0 },
+	{ "infin", 0x221E, 0 }, { "precsim", 0x227E, 0 }, { "DoubleLeftTee", 0x2AE4, 0 },
+	{ "NotSquareSupersetEqual", 0x22E3, 0 }, { "leftleftarrows", 0x21C7, 0 },
+	{ "nleqslant", 0x2A7D, 0x338 }, { "GT", 0x3E, 0 }, { "solbar", 0x233F, 0 }, { "fnof", 0x192, 0 },
+	{ "Lleftarrow", 0x21DA, 0 }, { "lbrace", 0x7B, 0 }, { "hookleftarrow", 0x21A9, 0 },
+	{ "kjcy", 0x45C, 0 }, { "rtrie", 0x22B5, 0 }, { "lessdot", 0x22D6, 0 }, { "ncup", 0x2A42, 0 },
+	{ "imped", 0x1B5, 0 }, { "GreaterLess", 0x2277, 0 }, { "gnE", 0x2269, 0 }, { "dharr", 0x21C2, 0 },
+	{ "SucceedsEqual", 0x2AB0, 0 }, { "lobrk", 0x27E6, 0 }, { "timesbar", 0x2A31, 0 },
+	{ "smtes", 0x2AAC, 0xFE00 }, { "downarrow", 0x2193, 0 }, { "capcap", 0x2A4B, 0 },
+	{ "zwj", 0x200D, 0 }, { "Tcaron", 0x164, 0 }, { "SucceedsSlantEqual", 0x227D, 0 },
+	{ "Hfr", 0x210C, 0 }, { "kcy", 0x43A, 0 }, { "xuplus", 0x2A04, 0 }, { "fcy", 0x444, 0 },
+	{ "xhArr", 0x27FA, 0 }, { "Nopf", 0x2115, 0 }, { "curarr", 0x21B7, 0 },
+	{ "NotHumpEqual", 0x224F, 0x338 }, { "gsiml", 0x2A90, 0 }, { "nldr", 0x2025, 0 },
+	{ "ffilig", 0xFB03, 0 }, { "oopf", 0x1D560, 0 }, { "scy", 0x441, 0 }, { "kscr", 0x1D4C0, 0 },
+	{ "nsup", 0x2285, 0 }, { "DownTee", 0x22A4, 0 }, { "fork", 0x22D4, 0 }, { "Assign", 0x2254, 0 },
+	{ "leftrightarrow", 0x2194, 0 }, { "NotEqual", 0x2260, 0 }, { "sqsubset", 0x228F, 0 },
+	{ "male", 0x2642, 0 }, { "NotSquareSubsetEqual", 0x22E2, 0 }, { "nequiv", 0x2262, 0 },
+	{ "lmidot", 0x140, 0 }, { "Bumpeq", 0x224E, 0 }, { "SHcy", 0x428, 0 }, { "xrarr", 0x27F6, 0 },
+	{ "khcy", 0x445, 0 }, { "gtrdot", 0x22D7, 0 }, { "iecy", 0x435, 0 }, { "bsemi", 0x204F, 0 },
+	{ "nearr", 0x2197, 0 }, { "dlcorn", 0x231E, 0 }, { "lat", 0x2AAB, 0 }, { "xnis", 0x22FB, 0 },
+	{ "curlyeqprec", 0x22DE, 0 }, { "ngt", 0x226F, 0 }, { "boxDR", 0x2554, 0 },
+	{ "drcorn", 0x231F, 0 }, { "kgreen", 0x138, 0 }, { "GreaterEqual", 0x2265, 0 },
+	{ "Lmidot", 0x13F, 0 }, { "zcaron", 0x17E, 0 }, { "TripleDot", 0x20DB, 0 },
+	{ "intlarhk", 0x2A17, 0 }, { "sbquo", 0x201A, 0 }, { "lEg", 0x2A8B, 0 },
+	{ "nsubseteq", 0x2288, 0 }, { "barwed", 0x2305, 0 }, { "esim", 0x2242, 0 },
+	{ "boxdR", 0x2552, 0 }, { "oscr", 0x2134, 0 }, { "cfr", 0x1D520, 0 }, { "larrpl", 0x2939, 0 },
+	{ "nshortmid", 0x2224, 0 }, { "nabla", 0x2207, 0 }, { "varpi", 0x3D6, 0 },
+	{ "demptyv", 0x29B1, 0 }, { "Umacr", 0x16A, 0 }, { "Odblac", 0x150, 0 },
+	{ "cupbrcap", 0x2A48, 0 }, { "curlyvee", 0x22CE, 0 }, { "Vvdash", 0x22AA, 0 },
+	{ "bowtie", 0x22C8, 0 }, { "nLeftarrow", 0x21CD, 0 }, { "Nu", 0x39D, 0 }, { "umacr", 0x16B, 0 },
+	{ "larrfs", 0x291D, 0 }, { "Auml", 0xC4, 0 }, { "Gdot", 0x120, 0 }, { "bigcap", 0x22C2, 0 },
+	{ "NotSuperset", 0x2283, 0x20D2 }, { "suphsub", 0x2AD7, 0 },
+	{ "NegativeVeryThinSpace", 0x200B, 0 }, { "Vscr", 0x1D4B1, 0 }, { "wedge", 0x2227, 0 },
+	{ "DiacriticalAcute", 0xB4, 0 }, { "succapprox", 0x2AB8, 0 }, { "exist", 0x2203, 0 },
+	{ "acute", 0xB4, 0 }, { "cudarrl", 0x2938, 0 }, { "NegativeThickSpace", 0x200B, 0 },
+	{ "emsp", 0x2003, 0 }, { "DownArrowUpArrow", 0x21F5, 0 }, { "Chi", 0x3A7, 0 },
+	{ "omid", 0x29B6, 0 }, { "veeeq", 0x225A, 0 }, { "awint", 0x2A11, 0 }, { "larr", 0x2190, 0 },
+	{ "gtcc", 0x2AA7, 0 }, { "bigodot", 0x2A00, 0 }, { "xsqcup", 0x2A06, 0 },
+	{ "cirfnint", 0x2A10, 0 }, { "ocir", 0x229A, 0 }, { "sqsup", 0x2290, 0 }, { "div", 0xF7, 0 },
+	{ "prnsim", 0x22E8, 0 }, { "trpezium", 0x23E2, 0 }, { "notni", 0x220C, 0 },
+	{ "curarrm", 0x293C, 0 }, { "Ascr", 0x1D49C, 0 }, { "el", 0x2A99, 0 }, { "dscy", 0x455, 0 },
+	{ "nspar", 0x2226, 0 }, { "lesdot", 0x2A7F, 0 }, { "lrm", 0x200E, 0 }, { "rdca", 0x2937, 0 },
+	{ "oacute", 0xF3, 0 }, { "ang", 0x2220, 0 }, { "nsupset", 0x2283, 0x20D2 },
+	{ "circledast", 0x229B, 0 }, { "simdot", 0x2A6A, 0 }, { "veebar", 0x22BB, 0 },
+	{ "ni", 0x220B, 0 }, { "Icy", 0x418, 0 }, { "ropar", 0x2986, 0 }, { "nang", 0x2220, 0x20D2 },
+	{ "rsaquo", 0x203A, 0 }, { "lcy", 0x43B, 0 }, { "nsube", 0x2288, 0 }, { "infintie", 0x29DD, 0 },
+	{ "boxHD", 0x2566, 0 }, { "olarr", 0x21BA, 0 }, { "part", 0x2202, 0 }, { "epsiv", 0x3F5, 0 },
+	{ "LeftCeiling", 0x2308, 0 }, { "gne", 0x2A88, 0 }, { "sdot", 0x22C5, 0 }, { "lBarr", 0x290E, 0 },
+	{ "period", 0x2E, 0 }, { "VerticalBar", 0x2223, 0 }, { "Beta", 0x392, 0 },
+	{ "multimap", 0x22B8, 0 }, { "DoubleLongLeftArrow", 0x27F8, 0 }, { "Scy", 0x421, 0 },
+	{ "nharr", 0x21AE, 0 }, { "bnot", 0x2310, 0 }, { "ThinSpace", 0x2009, 0 }, { "trisb", 0x29CD, 0 },
+	{ "boxhD", 0x2565, 0 }, { "Kcedil", 0x136, 0 }, { "rpar", 0x29, 0 }, { "comma", 0x2C, 0 },
+	{ "tbrk", 0x23B4, 0 }, { "caron", 0x2C7, 0 }, { "iiota", 0x2129, 0 },
+	{ "longleftrightarrow", 0x27F7, 0 }, { "LeftDownVectorBar", 0x2959, 0 }, { "Ucy", 0x423, 0 },
+	{ "ufisht", 0x297E, 0 }, { "forkv", 0x2AD9, 0 }, { "csup", 0x2AD0, 0 },
+	{ "RightVectorBar", 0x2953, 0 }, { "nGtv", 0x226B, 0x338 }, { "horbar", 0x2015, 0 },
+	{ "isinsv", 0x22F3, 0 }, { "gimel", 0x2137, 0 }, { "cscr", 0x1D4B8, 0 }, { "ccirc", 0x109, 0 },
+	{ "NotLessLess", 0x226A, 0x338 }, { "LeftTriangleBar", 0x29CF, 0 }, { "Tcedil", 0x162, 0 },
+	{ "Vbar", 0x2AEB, 0 }, { "image", 0x2111, 0 }, { "Cdot", 0x10A, 0 }, { "Vfr", 0x1D519, 0 },
+	{ "gescc", 0x2AA9, 0 }, { "varpropto", 0x221D, 0 }, { "LeftUpTeeVector", 0x2960, 0 },
+	{ "nvgt", 0x3E, 0x20D2 }, { "emptyv", 0x2205, 0 }, { "intercal", 0x22BA, 0 },
+	{ "simg", 0x2A9E, 0 }, { "eqcolon", 0x2255, 0 }, { "gdot", 0x121, 0 }, { "nltri", 0x22EA, 0 },
+	{ "napid", 0x224B, 0x338 }, { "LJcy", 0x409, 0 }, { "nvrArr", 0x2903, 0 }, { "nsc", 0x2281, 0 },
+	{ "efr", 0x1D522, 0 }, { "emptyset", 0x2205, 0 }, { "UnderBar", 0x5F, 0 }, { "boxdr", 0x250C, 0 },
+	{ "thkap", 0x2248, 0 }, { "NegativeMediumSpace", 0x200B, 0 }, { "eogon", 0x119, 0 },
+	{ "PrecedesTilde", 0x227E, 0 }, { "cudarrr", 0x2935, 0 }, { "loplus", 0x2A2D, 0 },
+	{ "nvdash", 0x22AC, 0 }, { "cularrp", 0x293D, 0 }, { "DoubleDownArrow", 0x21D3, 0 },
+	{ "ogon", 0x2DB, 0 }, { "hamilt", 0x210B, 0 }, { "Cscr", 0x1D49E, 0 }, { "Bopf", 0x1D539, 0 },
+	{ "nrtrie", 0x22ED, 0 }, { "ShortUpArrow", 0x2191, 0 }, { "deg", 0xB0, 0 }, { "chcy", 0x447, 0 },
+	{ "nhpar", 0x2AF2, 0 }, { "precnsim", 0x22E8, 0 }, { "dstrok", 0x111, 0 },
+	{ "dbkarow", 0x290F, 0 }, { "raquo", 0xBB, 0 }, { "ohbar", 0x29B5, 0 }, { "gcy", 0x433, 0 },
+	{ "clubsuit", 0x2663, 0 }, { "rect", 0x25AD, 0 }, { "suplarr", 0x297B, 0 },
+	{ "racute", 0x155, 0 }, { "ndash", 0x2013, 0 }, { "diamondsuit", 0x2666, 0 }, { "Pi", 0x3A0, 0 },
+	{ "UpTee", 0x22A5, 0 }, { "csupe", 0x2AD2, 0 }, { "thickapprox", 0x2248, 0 },
+	{ "fltns", 0x25B1, 0 }, { "Uarr", 0x219F, 0 }, { "vartheta", 0x3D1, 0 }, { "conint", 0x222E, 0 },
+	{ "harrw", 0x21AD, 0 }, { "RightTee", 0x22A2, 0 }, { "eqslantgtr", 0x2A96, 0 },
+	{ "Diamond", 0x22C4, 0 }, { "Vopf", 0x1D54D, 0 }, { "Dcaron", 0x10E, 0 },
+	{ "eqslantless", 0x2A95, 0 }, { "varsupsetneq", 0x228B, 0xFE00 }, { "zdot", 0x17C, 0 },
+	{ "flat", 0x266D, 0 }, { "Omega", 0x3A9, 0 }, { "cap", 0x2229, 0 }, { "Uscr", 0x1D4B0, 0 },
+	{ "Xscr", 0x1D4B3, 0 }, { "tprime", 0x2034, 0 }, { "DownLeftRightVector", 0x2950, 0 },
+	{ "sol", 0x2F, 0 }, { "bigcup", 0x22C3, 0 }, { "InvisibleComma", 0x2063, 0 },
+	{ "longleftarrow", 0x27F5, 0 }, { "natur", 0x266E, 0 }, { "plussim", 0x2A26, 0 },
+	{ "andd", 0x2A5C, 0 }, { "PrecedesEqual", 0x2AAF, 0 }, { "cirscir", 0x29C2, 0 },
+	{ "iiiint", 0x2A0C, 0 }, { "wfr", 0x1D534, 0 }, { "sext", 0x2736, 0 }, { "xcup", 0x22C3, 0 },
+	{ "rarrsim", 0x2974, 0 }, { "triangleright", 0x25B9, 0 }, { "ltimes", 0x22C9, 0 },
+	{ "Precedes", 0x227A, 0 }, { "cedil", 0xB8, 0 }, { "FilledVerySmallSquare", 0x25AA, 0 },
+	{ "sup1", 0xB9, 0 }, { "NotTilde", 0x2241, 0 }, { "angsph", 0x2222, 0 }, { "zacute", 0x17A, 0 },
+	{ "DoubleLeftRightArrow", 0x21D4, 0 }, { "rightarrow", 0x2192, 0 }, { "qfr", 0x1D52E, 0 },
+	{ "OElig", 0x152, 0 }, { "Abreve", 0x102, 0 }, { "ccupssm", 0x2A50, 0 },
+	{ "NotNestedLessLess", 0x2AA1, 0x338 }, { "gfr", 0x1D524, 0 }, { "CupCap", 0x224D, 0 },
+	{ "nvsim", 0x223C, 0x20D2 }, { "gtrapprox", 0x2A86, 0 }, { "notindot", 0x22F5, 0x338 },
+	{ "Emacr", 0x112, 0 }, { "minusd", 0x2238, 0 }, { "sup3", 0xB3, 0 }, { "Tscr", 0x1D4AF, 0 },
+	{ "epar", 0x22D5, 0 }, { "Hacek", 0x2C7, 0 }, { "notinvc", 0x22F6, 0 },
+	{ "gvertneqq", 0x2269, 0xFE00 }, { "nvDash", 0x22AD, 0 }, { "circlearrowleft", 0x21BA, 0 },
+	{ "utilde", 0x169, 0 }, { "orarr", 0x21BB, 0 }, { "LongLeftArrow", 0x27F5, 0 },
+	{ "sstarf", 0x22C6, 0 }, { "Theta", 0x398, 0 }, { "lArr", 0x21D0, 0 }, { "prec", 0x227A, 0 },
+	{ "NotGreaterGreater", 0x226B, 0x338 }, { "triminus", 0x2A3A, 0 }, { "amalg", 0x2A3F, 0 },
+	{ "wedbar", 0x2A5F, 0 }, { "iexcl", 0xA1, 0 }, { "nprcue", 0x22E0, 0 }, { "mu", 0x3BC, 0 },
+	{ "supmult", 0x2AC2, 0 }, { "fopf", 0x1D557, 0 }, { "minus", 0x2212, 0 },
+	{ "NotSupersetEqual", 0x2289, 0 }, { "lmoust", 0x23B0, 0 }, { "pcy", 0x43F, 0 },
+	{ "lsqb", 0x5B, 0 }, { "erDot", 0x2253, 0 }, { "ccups", 0x2A4C, 0 }, { "bumpeq", 0x224F, 0 },
+	{ "GreaterFullEqual", 0x2267, 0 }, { "tshcy", 0x45B, 0 }, { "oline", 0x203E, 0 },
+	{ "hopf", 0x1D559, 0 }, { "upsih", 0x3D2, 0 }, { "ulcrop", 0x230F, 0 },
+	{ "exponentiale", 0x2147, 0 }, { "dcy", 0x434, 0 }, { "cup", 0x222A, 0 },
+	{ "NotVerticalBar", 0x2224, 0 }, { "filig", 0xFB01, 0 }, { "circledS", 0x24C8, 0 },
+	{ "UnderParenthesis", 0x23DD, 0 }, { "semi", 0x3B, 0 }, { "DownLeftVectorBar", 0x2956, 0 },
+	{ "Colon", 0x2237, 0 }, { "lbrke", 0x298B, 0 }, { "ngsim", 0x2275, 0 }, { "swnwar", 0x292A, 0 },
+	{ "bull", 0x2022, 0 }, { "nbumpe", 0x224F, 0x338 }, { "frac56", 0x215A, 0 },
+	{ "Dstrok", 0x110, 0 }, { "NotPrecedesEqual", 0x2AAF, 0x338 }, { "subdot", 0x2ABD, 0 },
+	{ "trade", 0x2122, 0 }, { "drbkarow", 0x2910, 0 }, { "IOcy", 0x401, 0 }, { "edot", 0x117, 0 },
+	{ "frac45", 0x2158, 0 }, { "gtreqqless", 0x2A8C, 0 }, { "Ncedil", 0x145, 0 },
+	{ "rbrack", 0x5D, 0 }, { "rnmid", 0x2AEE, 0 }, { "lbrkslu", 0x298D, 0 }, { "dtri", 0x25BF, 0 },
+	{ "DoubleLongLeftRightArrow", 0x27FA, 0 }, { "ge", 0x2265, 0 }, { "par", 0x2225, 0 },
+	{ "UnionPlus", 0x228E, 0 }, { "iota", 0x3B9, 0 }, { "intcal", 0x22BA, 0 },
+	{ "plusdu", 0x2A25, 0 }, { "lcub", 0x7B, 0 }, { "mstpos", 0x223E, 0 }, { "ntlg", 0x2278, 0 },
+	{ "Zfr", 0x2128, 0 }, { "EmptySmallSquare", 0x25FB, 0 }, { "wp", 0x2118, 0 },
+	{ "upharpoonleft", 0x21BF, 0 }, { "ohm", 0x3A9, 0 }, { "varr", 0x2195, 0 },
+	{ "dtrif", 0x25BE, 0 }, { "lbarr", 0x290C, 0 }, { "lscr", 0x1D4C1, 0 },
+	{ "Coproduct", 0x2210, 0 }, { "bemptyv", 0x29B0, 0 }, { "nearrow", 0x2197, 0 },
+	{ "rAtail", 0x291C, 0 }, { "VeryThinSpace", 0x200A, 0 }, { "ap", 0x2248, 0 },
+	{ "ltrPar", 0x2996, 0 }, { "SquareSubsetEqual", 0x2291, 0 }, { "harr", 0x2194, 0 },
+	{ "lhblk", 0x2584, 0 }, { "larrb", 0x21E4, 0 }, { "npar", 0x2226, 0 }, { "or", 0x2228, 0 },
+	{ "napprox", 0x2249, 0 }, { "aring", 0xE5, 0 }, { "lHar", 0x2962, 0 }, { "eopf", 0x1D556, 0 },
+	{ "gesl", 0x22DB, 0xFE00 }, { "lambda", 0x3BB, 0 }, { "awconint", 0x2233, 0 },
+	{ "Upsilon", 0x3A5, 0 }, { "rcaron", 0x159, 0 }, { "varphi", 0x3D5, 0 }, { "rdquo", 0x201D, 0 },
+	{ "Proportion", 0x2237, 0 }, { "bbrk", 0x23B5, 0 }, { "Edot", 0x116, 0 }, { "icy", 0x438, 0 },
+	{ "pre", 0x2AAF, 0 }, { "angmsdag", 0x29AE, 0 }, { "rightleftharpoons", 0x21CC, 0 },
+	{ "ldrushar", 0x294B, 0 }, { "niv", 0x220B, 0 }, { "nsucceq", 0x2AB0, 0x338 },
+	{ "lbrack", 0x5B, 0 }, { "pertenk", 0x2031, 0 }, { "SHCHcy", 0x429, 0 }, { "simeq", 0x2243, 0 },
+	{ "Nacute", 0x143, 0 }, { "vnsup", 0x2283, 0x20D2 }, { "blacktriangledown", 0x25BE, 0 },
+	{ "rightharpoondown", 0x21C1, 0 }, { "vDash", 0x22A8, 0 }, { "fscr", 0x1D4BB, 0 },
+	{ "Iota", 0x399, 0 }, { "lE", 0x2266, 0 }, { "excl", 0x21, 0 }, { "female", 0x2640, 0 },
+	{ "Longrightarrow", 0x27F9, 0 }, { "DotDot", 0x20DC, 0 }, { "rarr", 0x2192, 0 },
+	{ "nis", 0x22FC, 0 }, { "nsqsupe", 0x22E3, 0 }, { "ange", 0x29A4, 0 }, { "leg", 0x22DA, 0 },
+	{ "supsup", 0x2AD6, 0 }, { "subrarr", 0x2979, 0 }, { "larrsim", 0x2973, 0 },
+	{ "ContourIntegral", 0x222E, 0 }, { "les", 0x2A7D, 0 }, { "approx", 0x2248, 0 },
+	{ "npolint", 0x2A14, 0 }, { "RightArrow", 0x2192, 0 }, { "late", 0x2AAD, 0 },
+	{ "squarf", 0x25AA, 0 }, { "DDotrahd", 0x2911, 0 }, { "Ufr", 0x1D518, 0 }, { "ascr", 0x1D4B6, 0 },
+	{ "bcong", 0x224C, 0 }, { "andslope", 0x2A58, 0 }, { "epsi", 0x3B5, 0 }, { "sqcap", 0x2293, 0 },
+	{ "ClockwiseContourIntegral", 0x2232, 0 }, { "Eogon", 0x118, 0 }, { "larrbfs", 0x291F, 0 },
+	{ "RightUpTeeVector", 0x295C, 0 }, { "ccedil", 0xE7, 0 }, { "bsime", 0x22CD, 0 },
+	{ "bigvee", 0x22C1, 0 }, { "rhov", 0x3F1, 0 }, { "nbump", 0x224E, 0x338 }, { "Cedilla", 0xB8, 0 },
+	{ "iscr", 0x1D4BE, 0 }, { "Ycy", 0x42B, 0 }, { "gopf", 0x1D558, 0 }, { "nLt", 0x226A, 0x20D2 },
+	{ "Ll", 0x22D8, 0 }, { "sscr", 0x1D4C8, 0 }, { "Integral", 0x222B, 0 }, { "xlarr", 0x27F5, 0 },
+	{ "orv", 0x2A5B, 0 }, { "varnothing", 0x2205, 0 }, { "frac12", 0xBD, 0 },
+	{ "rightsquigarrow", 0x219D, 0 }, { "spades", 0x2660, 0 }, { "bcy", 0x431, 0 },
+	{ "RightArrowBar", 0x21E5, 0 }, { "Rsh", 0x21B1, 0 }, { "sqsube", 0x2291, 0 },
+	{ "checkmark", 0x2713, 0 }, { "lsquor", 0x201A, 0 }, { "succcurlyeq", 0x227D, 0 },
+	{ "Dscr", 0x1D49F, 0 }, { "xutri", 0x25B3, 0 }, { "circ", 0x2C6, 0 }, { "dArr", 0x21D3, 0 },
+	{ "minusb", 0x229F, 0 }, { "ape", 0x224A, 0 }, { "NotSubsetEqual", 0x2288, 0 },
+	{ "eplus", 0x2A71, 0 }, { "Mellintrf", 0x2133, 0 }, { "bigstar", 0x2605, 0 },
+	{ "elsdot", 0x2A97, 0 }, { "Zcaron", 0x17D, 0 }, { "supedot", 0x2AC4, 0 }, { "Lsh", 0x21B0, 0 },
+	{ "lesssim", 0x2272, 0 }, { "hyphen", 0x2010, 0 }, { "loang", 0x27EC, 0 },
+	{ "UpArrow", 0x2191, 0 }, { "Dfr", 0x1D507, 0 }, { "topf", 0x1D565, 0 }, { "prime", 0x2032, 0 },
+	{ "empty", 0x2205, 0 }, { "vBarv", 0x2AE9, 0 }, { "Or", 0x2A54, 0 }, { "Yacute", 0xDD, 0 },
+	{ "Iacute", 0xCD, 0 }, { "egsdot", 0x2A98, 0 }, { "Longleftrightarrow", 0x27FA, 0 },
+	{ "reals", 0x211D, 0 }, { "frasl", 0x2044, 0 }, { "eng", 0x14B, 0 }, { "COPY", 0xA9, 0 },
+	{ "Esim", 0x2A73, 0 }, { "lneq", 0x2A87, 0 }, { "Mscr", 0x2133, 0 }, { "ecirc", 0xEA, 0 },
+	{ "efDot", 0x2252, 0 }, { "dotplus", 0x2214, 0 }, { "phone", 0x260E, 0 }, { "uuml", 0xFC, 0 },
+	{ "glj", 0x2AA4, 0 }, { "Fopf", 0x1D53D, 0 }, { "hkswarow", 0x2926, 0 },
+	{ "integers", 0x2124, 0 }, { "ltrie", 0x22B4, 0 }, { "pm", 0xB1, 0 }, { "xi", 0x3BE, 0 },
+	{ "lltri", 0x25FA, 0 }, { "prurel", 0x22B0, 0 }, { "andv", 0x2A5A, 0 }, { "boxV", 0x2551, 0 },
+	{ "eth", 0xF0, 0 }, { "ecaron", 0x11B, 0 }, { "rarrc", 0x2933, 0 }, { "hardcy", 0x44A, 0 },
+	{ "twoheadleftarrow", 0x219E, 0 }, { "ThickSpace", 0x205F, 0x200A }, { "shcy", 0x448, 0 },
+	{ "bnequiv", 0x2261, 0x20E5 }, { "lstrok", 0x142, 0 }, { "Yuml", 0x178, 0 },
+	{ "congdot", 0x2A6D, 0 }, { "uuarr", 0x21C8, 0 }, { "boxVL", 0x2563, 0 }, { "simne", 0x2246, 0 },
+	{ "lopf", 0x1D55D, 0 }, { "Utilde", 0x168, 0 }, { "CenterDot", 0xB7, 0 },
+	{ "RightTriangleEqual", 0x22B5, 0 }, { "SquareUnion", 0x2294, 0 }, { "subset", 0x2282, 0 },
+	{ "equivDD", 0x2A78, 0 }, { "expectation", 0x2130, 0 }, { "uopf", 0x1D566, 0 },
+	{ "aleph", 0x2135, 0 }, { "nexist", 0x2204, 0 }, { "nwarr", 0x2196, 0 }, { "apacir", 0x2A6F, 0 },
+	{ "sect", 0xA7, 0 }, { "uacute", 0xFA, 0 }, { "Star", 0x22C6, 0 }, { "realine", 0x211B, 0 },
+	{ "ncy", 0x43D, 0 }, { "preccurlyeq", 0x227C, 0 }, { "lsh", 0x21B0, 0 }, { "breve", 0x2D8, 0 },
+	{ "Mu", 0x39C, 0 }, { "ntriangleright", 0x22EB, 0 }, { "lacute", 0x13A, 0 },
+	{ "vartriangleright", 0x22B3, 0 }, { "dzigrarr", 0x27FF, 0 }, { "rharu", 0x21C0, 0 },
+	{ "triangledown", 0x25BF, 0 }, { "LeftTriangleEqual", 0x22B4, 0 }, { "boxhu", 0x2534, 0 },
+	{ "piv", 0x3D6, 0 }, { "dlcrop", 0x230D, 0 }, { "CircleTimes", 0x2297, 0 },
+	{ "rfloor", 0x230B, 0 }, { "qprime", 0x2057, 0 }, { "approxeq", 0x224A, 0 },
+	{ "forall", 0x2200, 0 }, { "rho", 0x3C1, 0 }, { "NotLessSlantEqual", 0x2A7D, 0x338 },
+	{ "nexists", 0x2204, 0 }, { "therefore", 0x2234, 0 }, { "angmsdaa", 0x29A8, 0 },
+	{ "nleq", 0x2270, 0 }, { "thorn", 0xFE, 0 }, { "thetasym", 0x3D1, 0 },
+	{ "VerticalLine", 0x7C, 0 }, { "smid", 0x2223, 0 }, { "Breve", 0x2D8, 0 }, { "Rho", 0x3A1, 0 },
+	{ "cross", 0x2717, 0 }, { "frown", 0x2322, 0 }, { "longmapsto", 0x27FC, 0 }, { "ycy", 0x44B, 0 },
+	{ "ic", 0x2063, 0 }, { "ufr", 0x1D532, 0 }, { "Lfr", 0x1D50F, 0 },
+	{ "DownLeftVector", 0x21BD, 0 }, { "diam", 0x22C4, 0 }, { "euml", 0xEB, 0 },
+	{ "Colone", 0x2A74, 0 }, { "rtriltri", 0x29CE, 0 }, { "TildeEqual", 0x2243, 0 },
+	{ "SquareSubset", 0x228F, 0 }, { "siml", 0x2A9D, 0 }, { "equiv", 0x2261, 0 },
+	{ "frac35", 0x2157, 0 }, { "ggg", 0x22D9, 0 }, { "Euml", 0xCB, 0 }, { "qint", 0x2A0C, 0 },
+	{ "plusacir", 0x2A23, 0 }, { "nvHarr", 0x2904, 0 }, { "ssmile", 0x2323, 0 },
+	{ "osol", 0x2298, 0 }, { "ee", 0x2147, 0 }, { "precapprox", 0x2AB7, 0 }, { "boxUr", 0x2559, 0 },
+	{ "NotNestedGreaterGreater", 0x2AA2, 0x338 }, { "lthree", 0x22CB, 0 }, { "alefsym", 0x2135, 0 },
+	{ "straightepsilon", 0x3F5, 0 }, { "bfr", 0x1D51F, 0 }, { "le", 0x2264, 0 }, { "eg", 0x2A9A, 0 },
+	{ "tcedil", 0x163, 0 }, { "barwedge", 0x2305, 0 }, { "dfr", 0x1D521, 0 },
+	{ "ImaginaryI", 0x2148, 0 }, { "Wedge", 0x22C0, 0 }, { "ecy", 0x44D, 0 },
+	{ "Equilibrium", 0x21CC, 0 }, { "supsetneqq", 0x2ACC, 0 }, { "jscr", 0x1D4BF, 0 },
+	{ "Union", 0x22C3, 0 }, { "imacr", 0x12B, 0 }, { "Qscr", 0x1D4AC, 0 }, { "xmap", 0x27FC, 0 },
+	{ "colon", 0x3A, 0 }, { "ngE", 0x2267, 0x338 }, { "Int", 0x222C, 0 }, { "scnap", 0x2ABA, 0 },
+	{ "kappav", 0x3F0, 0 }, { "becaus", 0x2235, 0 }, { "RightTeeArrow", 0x21A6, 0 },
+	{ "complement", 0x2201, 0 }, { "NotPrecedes", 0x2280, 0 }, { "RightVector", 0x21C0, 0 },
+	{ "tilde", 0x2DC, 0 }, { "euro", 0x20AC, 0 }, { "Gfr", 0x1D50A, 0 }, { "bopf", 0x1D553, 0 },
+	{ "smt", 0x2AAA, 0 }, { "iopf", 0x1D55A, 0 }, { "topfork", 0x2ADA, 0 }, { "eparsl", 0x29E3, 0 },
+	{ "rightharpoonup", 0x21C0, 0 }, { "sdotb", 0x22A1, 0 }, { "succeq", 0x2AB0, 0 },
+	{ "dollar", 0x24, 0 }, { "isin", 0x2208, 0 }, { "comp", 0x2201, 0 }, { "UpArrowBar", 0x2912, 0 },
+	{ "blacktriangleright", 0x25B8, 0 }, { "notnivc", 0x22FD, 0 }, { "odot", 0x2299, 0 },
+	{ "angrt", 0x221F, 0 }, { "rmoustache", 0x23B1, 0 }, { "LowerRightArrow", 0x2198, 0 },
+	{ "copf", 0x1D554, 0 }, { "Dashv", 0x2AE4, 0 }, { "lvnE", 0x2268, 0xFE00 }, { "oslash", 0xF8, 0 },
+	{ "angmsdaf", 0x29AD, 0 }, { "caret", 0x2041, 0 }, { "nwnear", 0x2927, 0 }, { "darr", 0x2193, 0 },
+	{ "Cross", 0x2A2F, 0 }, { "Gscr", 0x1D4A2, 0 }, { "loz", 0x25CA, 0 }, { "Ffr", 0x1D509, 0 },
+	{ "smallsetminus", 0x2216, 0 }, { "UpTeeArrow", 0x21A5, 0 }, { "nsmid", 0x2224, 0 },
+	{ "dscr", 0x1D4B9, 0 }, { "Ycirc", 0x176, 0 }, { "NotPrecedesSlantEqual", 0x22E0, 0 },
+	{ "fallingdotseq", 0x2252, 0 }, { "angst", 0xC5, 0 }, { "Rcy", 0x420, 0 },
+	{ "subsetneqq", 0x2ACB, 0 }, { "scnsim", 0x22E9, 0 }, { "Sigma", 0x3A3, 0 },
+	{ "trie", 0x225C, 0 }, { "ijlig", 0x133, 0 }, { "rHar", 0x2964, 0 }, { "Tab", 0x9, 0 },
+	{ "VerticalTilde", 0x2240, 0 }, { "RightDoubleBracket", 0x27E7, 0 }, { "rdquor", 0x201D, 0 },
+	{ "bigotimes", 0x2A02, 0 }, { "parsim", 0x2AF3, 0 }, { "xopf", 0x1D569, 0 }, { "Mcy", 0x41C, 0 },
+	{ "leftharpoonup", 0x21BC, 0 }, { "DiacriticalDoubleAcute", 0x2DD, 0 }, { "Map", 0x2905, 0 },
+	{ "lfisht", 0x297C, 0 }, { "risingdotseq", 0x2253, 0 }, { "topcir", 0x2AF1, 0 },
+	{ "lhard", 0x21BD, 0 }, { "nparallel", 0x2226, 0 }, { "ocy", 0x43E, 0 }, { "thinsp", 0x2009, 0 },
+	{ "Ncaron", 0x147, 0 }, { "NotDoubleVerticalBar", 0x2226, 0 }, { "die", 0xA8, 0 },
+	{ "lozf", 0x29EB, 0 }, { "Dagger", 0x2021, 0 }, { "LeftDoubleBracket", 0x27E6, 0 },
+	{ "napE", 0x2A70, 0x338 }, { "rbrke", 0x298C, 0 }, { "Idot", 0x130, 0 }, { "latail", 0x2919, 0 },
+	{ "LessSlantEqual", 0x2A7D, 0 }, { "subsup", 0x2AD3, 0 }, { "sqcups", 0x2294, 0xFE00 },
+	{ "lap", 0x2A85, 0 }, { "rdsh", 0x21B3, 0 }, { "hfr", 0x1D525, 0 }, { "between", 0x226C, 0 },
+	{ "straightphi", 0x3D5, 0 }, { "els", 0x2A95, 0 }, { "centerdot", 0xB7, 0 },
+	{ "rscr", 0x1D4C7, 0 }, { "DownArrowBar", 0x2913, 0 }, { "Cfr", 0x212D, 0 },
+	{ "mdash", 0x2014, 0 }, { "hslash", 0x210F, 0 }, { "equals", 0x3D, 0 }, { "target", 0x2316, 0 },
+	{ "Sqrt", 0x221A, 0 }, { "planckh", 0x210E, 0 }, { "incare", 0x2105, 0 }, { "nhArr", 0x21CE, 0 },
+	{ "gneq", 0x2A88, 0 }, { "supsetneq", 0x228B, 0 }, { "Zdot", 0x17B, 0 }, { "disin", 0x22F2, 0 },
+	{ "nwArr", 0x21D6, 0 }, { "xscr", 0x1D4CD, 0 }, { "NotLeftTriangle", 0x22EA, 0 },
+	{ "Jsercy", 0x408, 0 }, { "Scaron", 0x160, 0 }, { "DotEqual", 0x2250, 0 }, { "lsim", 0x2272, 0 },
+	{ "hookrightarrow", 0x21AA, 0 }, { "prsim", 0x227E, 0 }, { "lsaquo", 0x2039, 0 },
+	{ "micro", 0xB5, 0 }, { "Congruent", 0x2261, 0 }, { "nlArr", 0x21CD, 0 }, { "rsquor", 0x2019, 0 },
+	{ "vrtri", 0x22B3, 0 }, { "shchcy", 0x449, 0 }, { "rbarr", 0x290D, 0 }, { "profline", 0x2312, 0 },
+	{ "sqcup", 0x2294, 0 }, { "rarrlp", 0x21AC, 0 }, { "Uuml", 0xDC, 0 }, { "uparrow", 0x2191, 0 },
+	{ "supseteqq", 0x2AC6, 0 }, { "bsolhsub", 0x27C8, 0 }, { "bumpE", 0x2AAE, 0 },
+	{ "searrow", 0x2198, 0 }, { "LeftArrowRightArrow", 0x21C6, 0 }, { "abreve", 0x103, 0 },
+	{ "inodot", 0x131, 0 }, { "Leftrightarrow", 0x21D4, 0 }, { "rfr", 0x1D52F, 0 },
+	{ "ac", 0x223E, 0 }, { "toea", 0x2928, 0 }, { "cuepr", 0x22DE, 0 }, { "prnap", 0x2AB9, 0 },
+	{ "tstrok", 0x167, 0 }, { "lbrksld", 0x298F, 0 }, { "prop", 0x221D, 0 }, { "suphsol", 0x27C9, 0 },
+	{ "RightTriangleBar", 0x29D0, 0 }, { "supplus", 0x2AC0, 0 }, { "DownLeftTeeVector", 0x295E, 0 },
+	{ "digamma", 0x3DD, 0 }, { "ApplyFunction", 0x2061, 0 }, { "yucy", 0x44E, 0 },
+	{ "sacute", 0x15B, 0 }, { "brvbar", 0xA6, 0 }, { "csube", 0x2AD1, 0 }, { "sung", 0x266A, 0 },
+	{ "acirc", 0xE2, 0 }, { "njcy", 0x45A, 0 }, { "prod", 0x220F, 0 }, { "lesseqqgtr", 0x2A8B, 0 },
+	{ "Cconint", 0x2230, 0 }, { "compfn", 0x2218, 0 }, { "isindot", 0x22F5, 0 },
+	{ "numsp", 0x2007, 0 }, { "yuml", 0xFF, 0 }, { "sime", 0x2243, 0 }, { "Equal", 0x2A75, 0 },
+	{ "erarr", 0x2971, 0 }, { "bernou", 0x212C, 0 }, { "divideontimes", 0x22C7, 0 },
+	{ "Yopf", 0x1D550, 0 }, { "sqsubseteq", 0x2291, 0 }, { "cir", 0x25CB, 0 }, { "xharr", 0x27F7, 0 },
+	{ "yopf", 0x1D56A, 0 }, { "Sup", 0x22D1, 0 }, { "pointint", 0x2A15, 0 },
+	{ "RightTriangle", 0x22B3, 0 }, { "dotminus", 0x2238, 0 }, { "radic", 0x221A, 0 },
+	{ "ring", 0x2DA, 0 }, { "pi", 0x3C0, 0 }, { "marker", 0x25AE, 0 }, { "operp", 0x29B9, 0 },
+	{ "boxVh", 0x256B, 0 }, { "lharu", 0x21BC, 0 }, { "ord", 0x2A5D, 0 }, { "LessLess", 0x2AA1, 0 },
+	{ "LeftVectorBar", 0x2952, 0 }, { "Im", 0x2111, 0 }, { "tdot", 0x20DB, 0 },
+	{ "larrhk", 0x21A9, 0 }, { "nparsl", 0x2AFD, 0x20E5 }, { "tscy", 0x446, 0 },
+	{ "mlcp", 0x2ADB, 0 }, { "nrarrc", 0x2933, 0x338 }, { "auml", 0xE4, 0 }, { "kcedil", 0x137, 0 },
+	{ "zeetrf", 0x2128, 0 }, { "boxuL", 0x255B, 0 }, { "ovbar", 0x233D, 0 },
+	{ "angmsdac", 0x29AA, 0 }, { "npart", 0x2202, 0x338 }, { "setminus", 0x2216, 0 },
+	{ "nsime", 0x2244, 0 }, { "lharul", 0x296A, 0 }, { "gtrless", 0x2277, 0 }, { "dblac", 0x2DD, 0 },
+	{ "geqslant", 0x2A7E, 0 }, { "LessEqualGreater", 0x22DA, 0 }, { "nfr", 0x1D52B, 0 },
+	{ "blacklozenge", 0x29EB, 0 }, { "wopf", 0x1D568, 0 }, { "gamma", 0x3B3, 0 },
+	{ "vsubnE", 0x2ACB, 0xFE00 }, { "NotSquareSuperset", 0x2290, 0x338 }, { "gtreqless", 0x22DB, 0 },
+	{ "UnderBrace", 0x23DF, 0 }, { "pluscir", 0x2A22, 0 }, { "sopf", 0x1D564, 0 },
+	{ "lessgtr", 0x2276, 0 }, { "rmoust", 0x23B1, 0 }, { "dHar", 0x2965, 0 }, { "omacr", 0x14D, 0 },
+	{ "cupcup", 0x2A4A, 0 }, { "rationals", 0x211A, 0 }, { "gnsim", 0x22E7, 0 },
+	{ "natural", 0x266E, 0 }, { "boxplus", 0x229E, 0 }, { "mnplus", 0x2213, 0 }, { "lgE", 0x2A91, 0 },
+	{ "Ecaron", 0x11A, 0 }, { "boxH", 0x2550, 0 }, { "pound", 0xA3, 0 }, { "lrhard", 0x296D, 0 },
+	{ "Hstrok", 0x126, 0 }, { "olcir", 0x29BE, 0 }, { "laemptyv", 0x29B4, 0 },
+	{ "rharul", 0x296C, 0 }, { "vltri", 0x22B2, 0 }, { "dwangle", 0x29A6, 0 }, { "bNot", 0x2AED, 0 },
+	{ "bigtriangledown", 0x25BD, 0 }, { "nleftarrow", 0x219A, 0 }, { "nwarrow", 0x2196, 0 },
+	{ "plusdo", 0x2214, 0 }, { "Sub", 0x22D0, 0 }, { "NotLessEqual", 0x2270, 0 },
+	{ "bdquo", 0x201E, 0 }, { "rbrksld", 0x298E, 0 }, { "lvertneqq", 0x2268, 0xFE00 },
+	{ "pscr", 0x1D4C5, 0 }, { "clubs", 0x2663, 0 }, { "ulcorn", 0x231C, 0 },
+	{ "Uarrocir", 0x2949, 0 }, { "loarr", 0x21FD, 0 }, { "nsccue", 0x22E1, 0 },
+	{ "because", 0x2235, 0 }, { "Ccedil", 0xC7, 0 }, { "ominus", 0x2296, 0 },
+	{ "subsetneq", 0x228A, 0 }, { "iogon", 0x12F, 0 }, { "eqcirc", 0x2256, 0 }, { "ucirc", 0xFB, 0 },
+	{ "Verbar", 0x2016, 0 }, { "frac58", 0x215D, 0 }, { "NewLine", 0xA, 0 }, { "asymp", 0x2248, 0 },
+	{ "Xfr", 0x1D51B, 0 }, { "OpenCurlyQuote", 0x2018, 0 }, { "GreaterSlantEqual", 0x2A7E, 0 },
+	{ "order", 0x2134, 0 }, { "heartsuit", 0x2665, 0 }, { "scedil", 0x15F, 0 },
+	{ "boxdl", 0x2510, 0 }, { "angle", 0x2220, 0 }, { "midcir", 0x2AF0, 0 }, { "boxDl", 0x2556, 0 },
+	{ "vangrt", 0x299C, 0 }, { "succnapprox", 0x2ABA, 0 }, { "TRADE", 0x2122, 0 },
+	{ "curren", 0xA4, 0 }, { "nopf", 0x1D55F, 0 }, { "RightTeeVector", 0x295B, 0 },
+	{ "nlt", 0x226E, 0 }, { "Pfr", 0x1D513, 0 }, { "Aogon", 0x104, 0 },
+	{ "ntrianglerighteq", 0x22ED, 0 }, { "there4", 0x2234, 0 }, { "rfisht", 0x297D, 0 },
+	{ "YIcy", 0x407, 0 }, { "hybull", 0x2043, 0 }, { "ncap", 0x2A43, 0 },
+	{ "NonBreakingSpace", 0xA0, 0 }, { "sqsub", 0x228F, 0 }, { "ntgl", 0x2279, 0 },
+	{ "theta", 0x3B8, 0 }, { "DiacriticalTilde", 0x2DC, 0 }, { "nacute", 0x144, 0 },
+	{ "lesseqgtr", 0x22DA, 0 }, { "square", 0x25A1, 0 }, { "leqq", 0x2266, 0 },
+	{ "seArr", 0x21D8, 0 }, { "roang", 0x27ED, 0 }, { "Nscr", 0x1D4A9, 0 },
+	{ "DoubleLeftArrow", 0x21D0, 0 }, { "Product", 0x220F, 0 }, { "sqsupe", 0x2292, 0 },
+	{ "ugrave", 0xF9, 0 }, { "uhblk", 0x2580, 0 }, { "boxVR", 0x2560, 0 }, { "boxvR", 0x255E, 0 },
+	{ "cemptyv", 0x29B2, 0 }, { "odsold", 0x29BC, 0 }, { "permil", 0x2030, 0 },
+	{ "cwint", 0x2231, 0 }, { "AMP", 0x26, 0 }, { "npre", 0x2AAF, 0x338 }, { "ljcy", 0x459, 0 },
+	{ "NotTildeEqual", 0x2244, 0 }, { "capand", 0x2A44, 0 }, { "nwarhk", 0x2923, 0 },
+	{ "NotCongruent", 0x2262, 0 }, { "kopf", 0x1D55C, 0 }, { "rangd", 0x2992, 0 },
+	{ "LeftUpDownVector", 0x2951, 0 }, { "NotTildeTilde", 0x2249, 0 }, { "boxHu", 0x2567, 0 },
+	{ "planck", 0x210F, 0 }, { "rthree", 0x22CC, 0 }, { "scsim", 0x227F, 0 }, { "spar", 0x2225, 0 },
+	{ "Subset", 0x22D0, 0 }, { "rarrhk", 0x21AA, 0 }, { "Racute", 0x154, 0 },
+	{ "notinE", 0x22F9, 0x338 }, { "rArr", 0x21D2, 0 }, { "aopf", 0x1D552, 0 },
+	{ "nesear", 0x2928, 0 }, { "Vdashl", 0x2AE6, 0 }, { "DoubleRightTee", 0x22A8, 0 },
+	{ "colone", 0x2254, 0 }, { "sube", 0x2286, 0 }, { "SucceedsTilde", 0x227F, 0 },
+	{ "PrecedesSlantEqual", 0x227C, 0 }, { "otimesas", 0x2A36, 0 }, { "cirE", 0x29C3, 0 },
+	{ "subplus", 0x2ABF, 0 }, { "Lt", 0x226A, 0 }, { "Lcy", 0x41B, 0 }, { "iukcy", 0x456, 0 },
+	{ "LeftVector", 0x21BC, 0 }, { "scirc", 0x15D, 0 }, { "nedot", 0x2250, 0x338 },
+	{ "Square", 0x25A1, 0 }, { "VerticalSeparator", 0x2758, 0 }, { "eacute", 0xE9, 0 },
+	{ "percnt", 0x25, 0 }, { "RightUpVector", 0x21BE, 0 }, { "dsol", 0x29F6, 0 },
+	{ "boxvh", 0x253C, 0 }, { "Itilde", 0x128, 0 }, { "Bcy", 0x411, 0 }, { "angmsdah", 0x29AF, 0 },
+	{ "rightrightarrows", 0x21C9, 0 }, { "ubreve", 0x16D, 0 }, { "agrave", 0xE0, 0 },
+	{ "LeftTee", 0x22A3, 0 }, { "subne", 0x228A, 0 }, { "maltese", 0x2720, 0 }, { "hArr", 0x21D4, 0 },
+	{ "hksearow", 0x2925, 0 }, { "squ", 0x25A1, 0 }, { "copy", 0xA9, 0 },
+	{ "EmptyVerySmallSquare", 0x25AB, 0 }, { "HumpDownHump", 0x224E, 0 }, { "LessTilde", 0x2272, 0 },
+	{ "vert", 0x7C, 0 }, { "ZHcy", 0x416, 0 }, { "plankv", 0x210F, 0 }, { "nsubset", 0x2282, 0x20D2 },
+	{ "dash", 0x2010, 0 }, { "gE", 0x2267, 0 }, { "Fscr", 0x2131, 0 }, { "LessGreater", 0x2276, 0 },
+	{ "lesg", 0x22DA, 0xFE00 }, { "nless", 0x226E, 0 }, { "Atilde", 0xC3, 0 }, { "xrArr", 0x27F9, 0 },
+	{ "Succeeds", 0x227B, 0 }, { "plusmn", 0xB1, 0 }, { "supdsub", 0x2AD8, 0 },
+	{ "upuparrows", 0x21C8, 0 }, { "pluse", 0x2A72, 0 }, { "oelig", 0x153, 0 }, { "bepsi", 0x3F6, 0 },
+	{ "boxur", 0x2514, 0 }, { "angzarr", 0x237C, 0 }, { "ngeqq", 0x2267, 0x338 },
+	{ "Gammad", 0x3DC, 0 }, { "timesb", 0x22A0, 0 }, { "nrarrw", 0x219D, 0x338 },
+	{ "LeftTriangle", 0x22B2, 0 }, { "Kappa", 0x39A, 0 }, { "RightArrowLeftArrow", 0x21C4, 0 },
+	{ "asympeq", 0x224D, 0 }, { "nbsp", 0xA0, 0 }, { "yicy", 0x457, 0 }, { "Aring", 0xC5, 0 },
+	{ "ncaron", 0x148, 0 }, { "nvlArr", 0x2902, 0 }, { "nsce", 0x2AB0, 0x338 }, { "Not", 0x2AEC, 0 },
+	{ "Udblac", 0x170, 0 }, { "curvearrowleft", 0x21B6, 0 }, { "Copf", 0x2102, 0 },
+	{ "ast", 0x2A, 0 }, { "precneqq", 0x2AB5, 0 }, { "SuchThat", 0x220B, 0 }, { "range", 0x29A5, 0 },
+	{ "doteqdot", 0x2251, 0 }, { "UpperLeftArrow", 0x2196, 0 }, { "capdot", 0x2A40, 0 },
+	{ "nesim", 0x2242, 0x338 }, { "boxtimes", 0x22A0, 0 }, { "Eta", 0x397, 0 },
+	{ "Lcedil", 0x13B, 0 }, { "subsim", 0x2AC7, 0 }, { "lpar", 0x28, 0 },
+	{ "rightleftarrows", 0x21C4, 0 }, { "xfr", 0x1D535, 0 }, { "smte", 0x2AAC, 0 },
+	{ "quest", 0x3F, 0 }, { "popf", 0x1D561, 0 }, { "frac13", 0x2153, 0 }, { "pfr", 0x1D52D, 0 },
+	{ "xvee", 0x22C1, 0 }, { "updownarrow", 0x2195, 0 }, { "cups", 0x222A, 0xFE00 },
+	{ "LeftArrow", 0x2190, 0 }, { "udarr", 0x21C5, 0 }, { "boxminus", 0x229F, 0 },
+	{ "notniva", 0x220C, 0 }, { "Ubrcy", 0x40E, 0 }, { "ETH", 0xD0, 0 }, { "gtquest", 0x2A7C, 0 },
+	{ "UpperRightArrow", 0x2197, 0 }, { "Kscr", 0x1D4A6, 0 }, { "OpenCurlyDoubleQuote", 0x201C, 0 },
+	{ "OverBar", 0x203E, 0 }, { "NotTildeFullEqual", 0x2247, 0 }, { "roplus", 0x2A2E, 0 },
+	{ "supsim", 0x2AC8, 0 }, { "dtdot", 0x22F1, 0 }, { "Cacute", 0x106, 0 }, { "Del", 0x2207, 0 },
+	{ "mldr", 0x2026, 0 }, { "djcy", 0x452, 0 }, { "rotimes", 0x2A35, 0 }, { "lsimg", 0x2A8F, 0 },
+	{ "af", 0x2061, 0 }, { "dzcy", 0x45F, 0 }, { "Uogon", 0x172, 0 }, { "dashv", 0x22A3, 0 },
+	{ "rsh", 0x21B1, 0 }, { "frac16", 0x2159, 0 }, { "Barwed", 0x2306, 0 },
+	{ "UpArrowDownArrow", 0x21C5, 0 }, { "diamond", 0x22C4, 0 }, { "subsub", 0x2AD5, 0 },
+	{ "lnap", 0x2A89, 0 }, { "ddagger", 0x2021, 0 }, { "Nfr", 0x1D511, 0 }, { "Ccirc", 0x108, 0 },
+	{ "CloseCurlyQuote", 0x2019, 0 }, { "NotSucceedsTilde", 0x227F, 0x338 }, { "Gbreve", 0x11E, 0 },
+	{ "notnivb", 0x22FE, 0 }, { "jmath", 0x237, 0 }, { "Gcedil", 0x122, 0 }, { "Iscr", 0x2110, 0 },
+	{ "topbot", 0x2336, 0 }, { "mcy", 0x43C, 0 }, { "ograve", 0xF2, 0 }, { "elinters", 0x23E7, 0 },
+	{ "uHar", 0x2963, 0 }, { "minusdu", 0x2A2A, 0 }, { "lmoustache", 0x23B0, 0 },
+	{ "sqsupset", 0x2290, 0 }, { "KHcy", 0x425, 0 }, { "gneqq", 0x2269, 0 }, { "and", 0x2227, 0 },
+	{ "upsi", 0x3C5, 0 }, { "rsqb", 0x5D, 0 }, { "wedgeq", 0x2259, 0 }, { "eDot", 0x2251, 0 },
+	{ "ocirc", 0xF4, 0 }, { "bullet", 0x2022, 0 }, { "sigma", 0x3C3, 0 },
+	{ "DoubleUpArrow", 0x21D1, 0 }, { "lessapprox", 0x2A85, 0 }, { "subedot", 0x2AC3, 0 },
+	{ "vopf", 0x1D567, 0 }, { "succ", 0x227B, 0 }, { "Pscr", 0x1D4AB, 0 }, { "vArr", 0x21D5, 0 },
+	{ "imagline", 0x2110, 0 }, { "macr", 0xAF, 0 }, { "vzigzag", 0x299A, 0 }, { "nrarr", 0x219B, 0 },
+	{ "realpart", 0x211C, 0 }, { "lnapprox", 0x2A89, 0 }, { "LeftDownVector", 0x21C3, 0 },
+	{ "setmn", 0x2216, 0 }, { "opar", 0x29B7, 0 }, { "ccaps", 0x2A4D, 0 }, { "gEl", 0x2A8C, 0 },
+	{ "NotLeftTriangleEqual", 0x22EC, 0 }, { "bigwedge", 0x22C0, 0 }, { "Leftarrow", 0x21D0, 0 },
+	{ "Qfr", 0x1D514, 0 }, { "ltcir", 0x2A79, 0 }, { "rlm", 0x200F, 0 }, { "ltquest", 0x2A7B, 0 },
+	{ "leftarrowtail", 0x21A2, 0 }, { "bne", 0x3D, 0x20E5 }, { "gnap", 0x2A8A, 0 },
+	{ "amp", 0x26, 0 }, { "rcy", 0x440, 0 }, { "Imacr", 0x12A, 0 }, { "gtdot", 0x22D7, 0 },
+	{ "KJcy", 0x40C, 0 }, { "half", 0xBD, 0 }, { "boxDr", 0x2553, 0 }, { "crarr", 0x21B5, 0 },
+	{ "acE", 0x223E, 0x333 }, { "lrtri", 0x22BF, 0 }, { "Intersection", 0x22C2, 0 },
+	{ "notinva", 0x2209, 0 }, { "Ifr", 0x2111, 0 }, { "Popf", 0x2119, 0 }, { "lotimes", 0x2A34, 0 },
+	{ "LeftUpVector", 0x21BF, 0 }, { "Prime", 0x2033, 0 }, { "Ccaron", 0x10C, 0 },
+	{ "LongRightArrow", 0x27F6, 0 }, { "ulcorner", 0x231C, 0 }, { "Gcy", 0x413, 0 },
+	{ "frac15", 0x2155, 0 }, { "curvearrowright", 0x21B7, 0 }, { "egs", 0x2A96, 0 },
+	{ "roarr", 0x21FE, 0 }, { "RightFloor", 0x230B, 0 }, { "zhcy", 0x436, 0 }, { "mho", 0x2127, 0 },
+	{ "Fouriertrf", 0x2131, 0 }, { "plusb", 0x229E, 0 }, { "DownArrow", 0x2193, 0 },
+	{ "questeq", 0x225F, 0 }, { "NotGreater", 0x226F, 0 }, { "plus", 0x2B, 0 },
+	{ "Oscr", 0x1D4AA, 0 }, { "weierp", 0x2118, 0 }, { "dotsquare", 0x22A1, 0 },
+	{ "ReverseEquilibrium", 0x21CB, 0 }, { "DJcy", 0x402, 0 }, { "backprime", 0x2035, 0 },
+	{ "ratio", 0x2236, 0 }, { "hbar", 0x210F, 0 }, { "twoheadrightarrow", 0x21A0, 0 },
+	{ "rightthreetimes", 0x22CC, 0 }, { "Tstrok", 0x166, 0 }, { "geq", 0x2265, 0 },
+	{ "nLl", 0x22D8, 0x338 }, { "hercon", 0x22B9, 0 }, { "Rcaron", 0x158, 0 },
+	{ "backepsilon", 0x3F6, 0 }, { "nprec", 0x2280, 0 }, { "Jcirc", 0x134, 0 },
+	{ "ddarr", 0x21CA, 0 }, { "Pcy", 0x41F, 0 }, { "nRightarrow", 0x21CF, 0 },
+	{ "vnsub", 0x2282, 0x20D2 }, { "subseteq", 0x2286, 0 }, { "lfr", 0x1D529, 0 }, { "REG", 0xAE, 0 },
+	{ "blank", 0x2423, 0 }, { "npreceq", 0x2AAF, 0x338 }, { "epsilon", 0x3B5, 0 },
+	{ "Zcy", 0x417, 0 }, { "ShortRightArrow", 0x2192, 0 }, { "leftharpoondown", 0x21BD, 0 },
+	{ "DoubleDot", 0xA8, 0 }, { "gesdotol", 0x2A84, 0 }, { "coloneq", 0x2254, 0 },
+	{ "npr", 0x2280, 0 }, { "udblac", 0x171, 0 }, { "cent", 0xA2, 0 }, { "Updownarrow", 0x21D5, 0 },
+	{ "Exists", 0x2203, 0 }, { "scnE", 0x2AB6, 0 }, { "RuleDelayed", 0x29F4, 0 },
+	{ "zscr", 0x1D4CF, 0 }, { "leqslant", 0x2A7D, 0 }, { "dcaron", 0x10F, 0 }, { "Jcy", 0x419, 0 },
+	{ "Acirc", 0xC2, 0 }, { "yscr", 0x1D4CE, 0 }, { "amacr", 0x101, 0 }, { "ensp", 0x2002, 0 },
+	{ "Scirc", 0x15C, 0 }, { "dot", 0x2D9, 0 }, { "lne", 0x2A87, 0 }, { "Vert", 0x2016, 0 },
+	{ "LeftUpVectorBar", 0x2958, 0 }, { "Lstrok", 0x141, 0 }, { "DoubleContourIntegral", 0x222F, 0 },
+	{ "Wscr", 0x1D4B2, 0 }, { "boxul", 0x2518, 0 }, { "rcedil", 0x157, 0 }, { "Ouml", 0xD6, 0 },
+	{ "Xi", 0x39E, 0 }, { "circleddash", 0x229D, 0 }, { "TildeFullEqual", 0x2245, 0 },
+	{ "geqq", 0x2267, 0 }, { "boxvH", 0x256A, 0 }, { "frac78", 0x215E, 0 }, { "lesdoto", 0x2A81, 0 },
+	{ "ShortDownArrow", 0x2193, 0 }, { "Barv", 0x2AE7, 0 }, { "xoplus", 0x2A01, 0 },
+	{ "real", 0x211C, 0 }, { "lowbar", 0x5F, 0 }, { "capbrcup", 0x2A49, 0 }, { "cirmid", 0x2AEF, 0 },
+	{ "nlE", 0x2266, 0x338 }, { "nscr", 0x1D4C3, 0 }, { "varkappa", 0x3F0, 0 },
+	{ "equest", 0x225F, 0 }, { "rangle", 0x27E9, 0 }, { "longrightarrow", 0x27F6, 0 },
+	{ "Lang", 0x27EA, 0 }, { "eta", 0x3B7, 0 }, { "prnE", 0x2AB5, 0 }, { "scpolint", 0x2A13, 0 },
+	{ "bigcirc", 0x25EF, 0 }, { "Mfr", 0x1D510, 0 }, { "seswar", 0x2929, 0 },
+	{ "curlywedge", 0x22CF, 0 }, { "NotGreaterTilde", 0x2275, 0 }, { "simplus", 0x2A24, 0 },
+	{ "Jfr", 0x1D50D, 0 }, { "jsercy", 0x458, 0 }, { "lnsim", 0x22E6, 0 }, { "pitchfork", 0x22D4, 0 },
+	{ "blacktriangle", 0x25B4, 0 }, { "boxHU", 0x2569, 0 }, { "emacr", 0x113, 0 },
+	{ "ssetmn", 0x2216, 0 }, { "Superset", 0x2283, 0 }, { "Omicron", 0x39F, 0 },
+	{ "gacute", 0x1F5, 0 }, { "langd", 0x2991, 0 }, { "napos", 0x149, 0 }, { "Aacute", 0xC1, 0 },
+	{ "RBarr", 0x2910, 0 }, { "gsime", 0x2A8E, 0 }, { "larrlp", 0x21AB, 0 },
+	{ "succnsim", 0x22E9, 0 }, { "lrhar", 0x21CB, 0 }, { "Backslash", 0x2216, 0 },
+	{ "nlsim", 0x2274, 0 }, { "ges", 0x2A7E, 0 }, { "supe", 0x2287, 0 }, { "ll", 0x226A, 0 },
+	{ "thetav", 0x3D1, 0 }, { "Gopf", 0x1D53E, 0 }, { "shortmid", 0x2223, 0 },
+	{ "caps", 0x2229, 0xFE00 }, { "iff", 0x21D4, 0 }, { "imath", 0x131, 0 }, { "ltcc", 0x2AA6, 0 },
+	{ "Epsilon", 0x395, 0 }, { "backsimeq", 0x22CD, 0 }, { "simlE", 0x2A9F, 0 },
+	{ "Hopf", 0x210D, 0 }, { "cire", 0x2257, 0 }, { "andand", 0x2A55, 0 }, { "boxh", 0x2500, 0 },
+	{ "igrave", 0xEC, 0 }, { "uharr", 0x21BE, 0 }, { "TScy", 0x426, 0 }, { "rppolint", 0x2A12, 0 },
+	{ "Sscr", 0x1D4AE, 0 }, { "NotSubset", 0x2282, 0x20D2 }, { "AElig", 0xC6, 0 },
+	{ "psi", 0x3C8, 0 }, { "GreaterEqualLess", 0x22DB, 0 }, { "vdash", 0x22A2, 0 },
+	{ "HorizontalLine", 0x2500, 0 }, { "lowast", 0x2217, 0 }, { "DD", 0x2145, 0 },
+	{ "ropf", 0x1D563, 0 }, { "gtrsim", 0x2273, 0 }, { "supset", 0x2283, 0 }, { "zopf", 0x1D56B, 0 },
+	{ "rceil", 0x2309, 0 }, { "zwnj", 0x200C, 0 }, { "simrarr", 0x2972, 0 }, { "ltlarr", 0x2976, 0 },
+	{ "Pr", 0x2ABB, 0 }, { "HilbertSpace", 0x210B, 0 }, { "triplus", 0x2A39, 0 },
+	{ "Vee", 0x22C1, 0 }, { "frac23", 0x2154, 0 }, { "Xopf", 0x1D54F, 0 }, { "nisd", 0x22FA, 0 },
+	{ "midast", 0x2A, 0 }, { "utri", 0x25B5, 0 }, { "raemptyv", 0x29B3, 0 }, { "ddotseq", 0x2A77, 0 },
+	{ "ucy", 0x443, 0 }, { "mid", 0x2223, 0 }, { "emsp13", 0x2004, 0 }, { "Supset", 0x22D1, 0 },
+	{ "Sopf", 0x1D54A, 0 }, { "varsubsetneqq", 0x2ACB, 0xFE00 }, { "Ecy", 0x42D, 0 },
+	{ "sfrown", 0x2322, 0 }, { "telrec", 0x2315, 0 }, { "supne", 0x228B, 0 },
+	{ "nvinfin", 0x29DE, 0 }, { "blk14", 0x2591, 0 }, { "perp", 0x22A5, 0 }, { "Gcirc", 0x11C, 0 },
+	{ "urcorn", 0x231D, 0 }, { "utdot", 0x22F0, 0 }, { "barvee", 0x22BD, 0 }, { "Iuml", 0xCF, 0 },
+	{ "rdldhar", 0x2969, 0 }, { "rrarr", 0x21C9, 0 }, { "yacy", 0x44F, 0 }, { "xdtri", 0x25BD, 0 },
+	{ "numero", 0x2116, 0 }, { "angrtvbd", 0x299D, 0 }, { "xodot", 0x2A00, 0 }, { "Rarr", 0x21A0, 0 },
+	{ "Rcedil", 0x156, 0 }, { "Topf", 0x1D54B, 0 }, { "uharl", 0x21BF, 0 }, { "lnE", 0x2268, 0 },
+	{ "blk34", 0x2593, 0 }, { "vBar", 0x2AE8, 0 }, { "gla", 0x2AA5, 0 }, { "frac34", 0xBE, 0 },
+	{ "sim", 0x223C, 0 }, { "LeftRightArrow", 0x2194, 0 }, { "Ecirc", 0xCA, 0 },
+	{ "bscr", 0x1D4B7, 0 }, { "cularr", 0x21B6, 0 }, { "ubrcy", 0x45E, 0 }, { "Aopf", 0x1D538, 0 },
+	{ "iacute", 0xED, 0 }, { "NotLessGreater", 0x2278, 0 }, { "Laplacetrf", 0x2112, 0 },
+	{ "lopar", 0x2985, 0 }, { "ncongdot", 0x2A6D, 0x338 }, { "fpartint", 0x2A0D, 0 },
+	{ "qscr", 0x1D4C6, 0 }, { "NotLessTilde", 0x2274, 0 }, { "block", 0x2588, 0 },
+	{ "nsupe", 0x2289, 0 }, { "star", 0x2606, 0 }, { "ntriangleleft", 0x22EA, 0 },
+	{ "naturals", 0x2115, 0 }, { "nrArr", 0x21CF, 0 }, { "gesles", 0x2A94, 0 }, { "yen", 0xA5, 0 },
+	{ "hoarr", 0x21FF, 0 }, { "boxdL", 0x2555, 0 }, { "gel", 0x22DB, 0 }, { "gnapprox", 0x2A8A, 0 },
+	{ "DoubleVerticalBar", 0x2225, 0 }, { "ogt", 0x29C1, 0 }, { "SupersetEqual", 0x2287, 0 },
+	{ "lates", 0x2AAD, 0xFE00 }, { "NotHumpDownHump", 0x224E, 0x338 }, { "strns", 0xAF, 0 },
+	{ "gsim", 0x2273, 0 }, { "quaternions", 0x210D, 0 }, { "intprod", 0x2A3C, 0 },
+	{ "orderof", 0x2134, 0 }, { "thicksim", 0x223C, 0 }, { "ncong", 0x2247, 0 },
+	{ "Iopf", 0x1D540, 0 }, { "jcy", 0x439, 0 }, { "Delta", 0x394, 0 }, { "divide", 0xF7, 0 },
+	{ "dfisht", 0x297F, 0 }, { "Tilde", 0x223C, 0 }, { "ouml", 0xF6, 0 }, { "Otilde", 0xD5, 0 },
+	{ "boxHd", 0x2564, 0 }, { "searr", 0x2198, 0 }, { "prap", 0x2AB7, 0 }, { "Otimes", 0x2A37, 0 },
+	{ "upharpoonright", 0x21BE, 0 }, { "tau", 0x3C4, 0 }, { "swArr", 0x21D9, 0 },
+	{ "DoubleUpDownArrow", 0x21D5, 0 }, { "ell", 0x2113, 0 }, { "NoBreak", 0x2060, 0 },
+	{ "nrightarrow", 0x219B, 0 }, { "gtrarr", 0x2978, 0 }, { "Ograve", 0xD2, 0 }, { "ne", 0x2260, 0 },
+	{ "lesdotor", 0x2A83, 0 }, { "escr", 0x212F, 0 }, { "varsupsetneqq", 0x2ACC, 0xFE00 },
+	{ "mumap", 0x22B8, 0 }, { "lAarr", 0x21DA, 0 }, { "boxvr", 0x251C, 0 }, { "apos", 0x27, 0 },
+	{ "ngtr", 0x226F, 0 }, { "bsolb", 0x29C5, 0 }, { "OverBracket", 0x23B4, 0 },
+	{ "cuwed", 0x22CF, 0 }, { "RightDownVectorBar", 0x2955, 0 }, { "boxvl", 0x2524, 0 },
+	{ "nu", 0x3BD, 0 }, { "ultri", 0x25F8, 0 }, { "NotGreaterSlantEqual", 0x2A7E, 0x338 },
+	{ "grave", 0x60, 0 }, { "LeftFloor", 0x230A, 0 }, { "ENG", 0x14A, 0 }, { "Ucirc", 0xDB, 0 },
+	{ "cuvee", 0x22CE, 0 }, { "nvlt", 0x3C, 0x20D2 }, { "PlusMinus", 0xB1, 0 }, { "csub", 0x2ACF, 0 },
+	{ "Because", 0x2235, 0 }, { "Uring", 0x16E, 0 }, { "mopf", 0x1D55E, 0 }, { "eqsim", 0x2242, 0 },
+	{ "Zscr", 0x1D4B5, 0 }, { "num", 0x23, 0 }, { "DownBreve", 0x311, 0 }, { "ffr", 0x1D523, 0 },
+	{ "lcedil", 0x13C, 0 }, { "DoubleRightArrow", 0x21D2, 0 }, { "submult", 0x2AC1, 0 },
+	{ "bsim", 0x223D, 0 }, { "luruhar", 0x2966, 0 }, { "esdot", 0x2250, 0 },
+	{ "DownTeeArrow", 0x21A7, 0 }, { "tcy", 0x442, 0 }, { "olcross", 0x29BB, 0 },
+	{ "nGg", 0x22D9, 0x338 }, { "wscr", 0x1D4CC, 0 }, { "Igrave", 0xCC, 0 }, { "vellip", 0x22EE, 0 },
+	{ "CHcy", 0x427, 0 }, { "jopf", 0x1D55B, 0 }, { "sccue", 0x227D, 0 }, { "sigmaf", 0x3C2, 0 },
+	{ "mscr", 0x1D4C2, 0 }, { "neArr", 0x21D7, 0 }, { "lt", 0x3C, 0 }, { "ordf", 0xAA, 0 },
+	{ "nges", 0x2A7E, 0x338 }, { "preceq", 0x2AAF, 0 }, { "sigmav", 0x3C2, 0 }, { "Wfr", 0x1D51A, 0 },
+	{ "biguplus", 0x2A04, 0 }, { "upsilon", 0x3C5, 0 }, { "NotRightTriangleBar", 0x29D0, 0x338 },
+	{ "doteq", 0x2250, 0 }, { "supE", 0x2AC6, 0 }, { "llarr", 0x21C7, 0 }, { "ruluhar", 0x2968, 0 },
+	{ "SquareSuperset", 0x2290, 0 }, { "Vcy", 0x412, 0 }, { "beta", 0x3B2, 0 }, { "bsol", 0x5C, 0 },
+	{ "nVDash", 0x22AF, 0 }, { "NotRightTriangle", 0x22EB, 0 }, { "starf", 0x2605, 0 },
+	{ "lescc", 0x2AA8, 0 }, { "oror", 0x2A56, 0 }, { "langle", 0x27E8, 0 }, { "yacute", 0xFD, 0 },
+	{ "frac18", 0x215B, 0 }, { "qopf", 0x1D562, 0 }, { "Downarrow", 0x21D3, 0 },
+	{ "backcong", 0x224C, 0 }, { "softcy", 0x44C, 0 }, { "NotLess", 0x226E, 0 },
+	{ "robrk", 0x27E7, 0 }, { "frac14", 0xBC, 0 }, { "subseteqq", 0x2AC5, 0 }, { "oplus", 0x2295, 0 },
+	{ "Eopf", 0x1D53C, 0 }, { "coprod", 0x2210, 0 }, { "Kfr", 0x1D50E, 0 }, { "zeta", 0x3B6, 0 },
+	{ "triangle", 0x25B5, 0 }, { "Ocy", 0x41E, 0 }, { "varsubsetneq", 0x228A, 0xFE00 },
+	{ "ReverseElement", 0x220B, 0 }, { "vcy", 0x432, 0 }, { "Iogon", 0x12E, 0 },
+	{ "bigtriangleup", 0x25B3, 0 }, { "rlhar", 0x21CC, 0 }, { "NotGreaterLess", 0x2279, 0 },
+	{ "rbbrk", 0x2773, 0 }, { "TSHcy", 0x40B, 0 }, { "NotSucceeds", 0x2281, 0 },
+	{ "imagpart", 0x2111, 0 }, { "Tcy", 0x422, 0 }, { "triangleq", 0x225C, 0 }, { "tosa", 0x2929, 0 },
+	{ "gtcir", 0x2A7A, 0 }, { "tint", 0x222D, 0 }, { "gl", 0x2277, 0 }, { "precnapprox", 0x2AB9, 0 },
+	{ "RoundImplies", 0x2970, 0 }, { "NJcy", 0x40A, 0 }, { "nvltrie", 0x22B4, 0x20D2 },
+	{ "leftrightsquigarrow", 0x21AD, 0 }, { "Cap", 0x22D2, 0 }, { "Scedil", 0x15E, 0 },
+	{ "gbreve", 0x11F, 0 }, { "egrave", 0xE8, 0 }, { "xcap", 0x22C2, 0 },
+	{ "SmallCircle", 0x2218, 0 }, { "cupor", 0x2A45, 0 },
+	{ "CounterClockwiseContourIntegral", 0x2233, 0 }, { "lsime", 0x2A8D, 0 }, { "dharl", 0x21C3, 0 },
+	{ "RightAngleBracket", 0x27E9, 0 }, { "nsupseteq", 0x2289, 0 }, { "srarr", 0x2192, 0 },
+	{ "nrtri", 0x22EB, 0 }, { "nvle", 0x2264, 0x20D2 }, { "Yscr", 0x1D4B4, 0 },
+	{ "EqualTilde", 0x2242, 0 }, { "LeftDownTeeVector", 0x2961, 0 }, { "looparrowright", 0x21AC, 0 },
+	{ "orslope", 0x2A57, 0 }, { "Ugrave", 0xD9, 0 }, { "bprime", 0x2035, 0 }, { "lceil", 0x2308, 0 },
+	{ "rarrpl", 0x2945, 0 }, { "supnE", 0x2ACC, 0 }, { "ldsh", 0x21B2, 0 }, { "llcorner", 0x231E, 0 },
+	{ "circeq", 0x2257, 0 }, { "Cup", 0x22D3, 0 }, { "profalar", 0x232E, 0 }, { "chi", 0x3C7, 0 },
+	{ "in", 0x2208, 0 }, { "eqvparsl", 0x29E5, 0 }, { "odblac", 0x151, 0 },
+	{ "ExponentialE", 0x2147, 0 }, { "RightUpDownVector", 0x294F, 0 }, { "omega", 0x3C9, 0 },
+	{ "ofcir", 0x29BF, 0 }, { "Larr", 0x219E, 0 }, { "NotReverseElement", 0x220C, 0 },
+	{ "rhard", 0x21C1, 0 }, { "sc", 0x227B, 0 }, { "Wcirc", 0x174, 0 }, { "nvrtrie", 0x22B5, 0x20D2 },
+	{ "NestedLessLess", 0x226A, 0 }, { "rang", 0x27E9, 0 }, { "Jopf", 0x1D541, 0 },
+	{ "primes", 0x2119, 0 }, { "rarrw", 0x219D, 0 }, { "origof", 0x22B6, 0 }, { "odiv", 0x2A38, 0 },
+	{ "Vdash", 0x22A9, 0 }, { "angmsdae", 0x29AC, 0 }, { "VDash", 0x22AB, 0 },
+	{ "DifferentialD", 0x2146, 0 }, { "boxv", 0x2502, 0 }, { "Oslash", 0xD8, 0 },
+	{ "prcue", 0x227C, 0 }, { "rBarr", 0x290F, 0 }, { "Hcirc", 0x124, 0 }, { "jfr", 0x1D527, 0 },
+	{ "Hat", 0x5E, 0 }, { "middot", 0xB7, 0 }, { "Icirc", 0xCE, 0 }, { "phmmat", 0x2133, 0 },
+	{ "rarrb", 0x21E5, 0 }, { "boxuR", 0x2558, 0 }, { "rcub", 0x7D, 0 }, { "aogon", 0x105, 0 },
+	{ "Dopf", 0x1D53B, 0 }, { "rarrtl", 0x21A3, 0 }, { "Afr", 0x1D504, 0 }, { "race", 0x223D, 0x331 },
+	{ "gap", 0x2A86, 0 }, { "Tfr", 0x1D517, 0 }, { "Jukcy", 0x404, 0 }, { "Wopf", 0x1D54E, 0 },
+	{ "spadesuit", 0x2660, 0 }, { "atilde", 0xE3, 0 }, { "dd", 0x2146, 0 }, { "nsimeq", 0x2244, 0 },
+	{ "sqsupseteq", 0x2292, 0 }, { "vee", 0x2228, 0 }, { "Rightarrow", 0x21D2, 0 },
+	{ "frac38", 0x215C, 0 }, { "uml", 0xA8, 0 }, { "emsp14", 0x2005, 0 }, { "lAtail", 0x291B, 0 },
+	{ "nsim", 0x2241, 0 }, { "lurdshar", 0x294A, 0 }, { "SquareSupersetEqual", 0x2292, 0 },
+	{ "supsub", 0x2AD4, 0 }, { "it", 0x2062, 0 }, { "diams", 0x2666, 0 }, { "bot", 0x22A5, 0 },
+	{ "CapitalDifferentialD", 0x2145, 0 }, { "NotElement", 0x2209, 0 }, { "nap", 0x2249, 0 },
+	{ "malt", 0x2720, 0 }, { "parallel", 0x2225, 0 }, { "LeftAngleBracket", 0x27E8, 0 },
+	{ "tscr", 0x1D4C9, 0 }, { "slarr", 0x2190, 0 }, { "Zopf", 0x2124, 0 }, { "gesdoto", 0x2A82, 0 },
+	{ "prE", 0x2AB3, 0 }, { "boxVl", 0x2562, 0 }, { "quatint", 0x2A16, 0 }, { "Qopf", 0x211A, 0 },
+	{ "UpEquilibrium", 0x296E, 0 }, { "downharpoonright", 0x21C2, 0 }, { "sum", 0x2211, 0 },
+	{ "leftthreetimes", 0x22CB, 0 }, { "Rang", 0x27EB, 0 }, { "iprod", 0x2A3C, 0 },
+	{ "xlArr", 0x27F8, 0 }, { "NotSquareSubset", 0x228F, 0x338 }, { "rx", 0x211E, 0 },
+	{ "DownRightVector", 0x21C1, 0 }, { "uogon", 0x173, 0 }, { "Re", 0x211C, 0 },
+	{ "lagran", 0x2112, 0 }, { "IEcy", 0x415, 0 }, { "curlyeqsucc", 0x22DF, 0 },
+	{ "llhard", 0x296B, 0 }, { "DownRightVectorBar", 0x2957, 0 }, { "nLtv", 0x226A, 0x338 },
+	{ "blacksquare", 0x25AA, 0 }, { "And", 0x2A53, 0 }, { "nsupE", 0x2AC6, 0x338 },
+	{ "NotSucceedsSlantEqual", 0x22E1, 0 }, { "udhar", 0x296E, 0 }, { "swarrow", 0x2199, 0 },
+	{ "NotSucceedsEqual", 0x2AB0, 0x338 }, { "gjcy", 0x453, 0 }, { "uring", 0x16F, 0 },
+	{ "alpha", 0x3B1, 0 }, { "urcrop", 0x230E, 0 },
 };
 
-static char_trigger markdown_char_ptrs[] = {
-	NULL,
-	&char_emphasis,
-	&char_codespan,
-	&char_linebreak,
-	&char_link,
-	&char_langle_tag,
-	&char_escape,
-	&char_entity,
-	&char_autolink_url,
-	&char_autolink_email,
-	&char_autolink_www,
-	&char_superscript,
+/* Windows-1252 remapping of numeric references to C1 controls, as HTML5 does */
+static const uint16_t ENTITY_C1[32] = {
+	0x20AC, 0x81, 0x201A, 0x192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x2C6, 0x2030, 0x160, 0x2039, 0x152, 0x8D, 0x17D, 0x8F,
+	0x90, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x2DC, 0x2122, 0x161, 0x203A, 0x153, 0x9D, 0x17E, 0x178,
 };
 
-/* render • structure containing one particular render */
-struct sd_markdown {
-	struct sd_callbacks	cb;
-	void *opaque;
+/* hash_entity • seeded FNV-1a */
+static inline unsigned int
+hash_entity(const uint8_t *str, size_t len, unsigned int seed)
+{
+	unsigned int h = 2166136261u ^ seed;
+	size_t i;
 
-	struct link_ref *refs[REF_TABLE_SIZE];
-	uint8_t active_char[256];
-	struct stack work_bufs[2];
-	unsigned int ext_flags;
-	size_t max_nesting;
-	int in_link_body;
-};
+	for (i = 0; i < len; ++i)
+		h = (h ^ str[i]) * 16777619u;
 
-/***************************
- * HELPER FUNCTIONS *
- ***************************/
+	return h;
+}
 
-static inline struct sd_buf *
-rndr_newbuf(struct sd_markdown *rndr, int type)
+/* find_entity • perfect hash lookup of a bare entity name */
+static const struct html_entity *
+find_entity(const uint8_t *name, size_t len)
 {
-	static const size_t buf_size[2] = {256, 64};
-	struct sd_buf *work = NULL;
-	struct stack *pool = &rndr->work_bufs[type];
+	const struct html_entity *ent;
+	unsigned int seed;
 
-	if (pool->size < pool->asize &&
-		pool->item[pool->size] != NULL) {
-		work = pool->item[pool->size++];
-		work->size = 0;
-	} else {
-		work = sd_bufnew(buf_size[type]);
-		stack_push(pool, work);
-	}
+	if (len == 0 || len > ENTITY_MAX_NAME)
+		return NULL;
 
-	return work;
+	seed = ENTITY_SEEDS[hash_entity(name, len, 0) % ENTITY_BUCKETS];
+	ent = &HTML_ENTITIES[hash_entity(name, len, seed) % ENTITY_SLOTS];
+
+	if (strncmp(ent->name, (const char *)name, len) == 0 && ent->name[len] == '\0')
+		return ent;
+
+	return NULL;
 }
 
-static inline void
-rndr_popbuf(struct sd_markdown *rndr, int type)
+/* put_utf8 • encodes a codepoint, returns the number of bytes written */
+static size_t
+put_utf8(uint8_t *out, uint32_t cp)
 {
-	rndr->work_bufs[type].size--;
+	if (cp < 0x80) {
+		out[0] = (uint8_t)cp;
+		return 1;
+	}
+	if (cp < 0x800) {
+		out[0] = (uint8_t)(0xC0 | (cp >> 6));
+		out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+		return 2;
+	}
+	if (cp < 0x10000) {
+		out[0] = (uint8_t)(0xE0 | (cp >> 12));
+		out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+		out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+		return 3;
+	}
+	out[0] = (uint8_t)(0xF0 | (cp >> 18));
+	out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+	out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+	out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+	return 4;
 }
 
-static void
-unscape_text(struct sd_buf *ob, struct sd_buf *src)
+/* numeric_entity • value of the digits of "&#nnn;" / "&#xhhh;", or -1 */
+static long
+numeric_entity(const uint8_t *data, size_t size)
 {
-	size_t i = 0, org;
-	while (i < src->size) {
-		org = i;
-		while (i < src->size && src->data[i] != '\\')
-			i++;
+	long cp = 0;
+	size_t i = 0;
+	int base = 10;
 
-		if (i > org)
-			sd_bufput(ob, src->data + org, i - org);
+	if (size > 0 && (data[0] == 'x' || data[0] == 'X')) {
+		base = 16;
+		i = 1;
+	}
 
-		if (i + 1 >= src->size)
-			break;
+	if (i >= size)
+		return -1;
 
-		sd_bufputc(ob, src->data[i + 1]);
-		i += 2;
+	for (; i < size; ++i) {
+		int digit;
+
+		if (data[i] >= '0' && data[i] <= '9')
+			digit = data[i] - '0';
+		else if (base == 16 && data[i] >= 'a' && data[i] <= 'f')
+			digit = data[i] - 'a' + 10;
+		else if (base == 16 && data[i] >= 'A' && data[i] <= 'F')
+			digit = data[i] - 'A' + 10;
+		else
+			return -1;
+
+		/* anything this large is out of range anyway, stop before overflowing */
+		if (cp <= 0x10FFFF)
+			cp = cp * base + digit;
 	}
+
+	return cp;
 }
 
-static unsigned int
-hash_link_ref(const uint8_t *link_ref, size_t length)
+size_t
+sd_entity_decode(uint8_t *out, const uint8_t *entity, size_t entity_size)
 {
-	size_t i;
-	unsigned int hash = 0;
-
-	for (i = 0; i < length; ++i)
-		hash = tolower(link_ref[i]) + (hash << 6) + (hash << 16) - hash;
-
-	return hash;
-}
+	const struct html_entity *ent;
+	size_t len;
 
-static struct link_ref *
-add_link_ref(
-	struct link_ref **references,
-	const uint8_t *name, size_t name_size)
-{
-	struct link_ref *ref = calloc(1, sizeof(struct link_ref));
+	if (entity_size < 3 || entity[0] != '&' || entity[entity_size - 1] != ';')
+		return 0;
 
-	if (!ref)
-		return NULL;
+	entity++;
+	entity_size -= 2;
 
-	ref->id = hash_link_ref(name, name_size);
-	ref->next = references[ref->id % REF_TABLE_SIZE];
+	if (entity[0] == '#') {
+		long cp = numeric_entity(entity + 1, entity_size - 1);
 
-	references[ref->id % REF_TABLE_SIZE] = ref;
-	return ref;
-}
+		if (cp < 0)
+			return 0;
 
-static struct link_ref *
-find_link_ref(struct link_ref **references, uint8_t *name, size_t length)
-{
-	unsigned int hash = hash_link_ref(name, length);
-	struct link_ref *ref = NULL;
+		if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+			cp = 0xFFFD;
+		else if (cp >= 0x80 && cp <= 0x9F)
+			cp = ENTITY_C1[cp - 0x80];
 
-	ref = references[hash % REF_TABLE_SIZE];
+		return put_utf8(out, (uint32_t)cp);
+	}
 
-	while (ref != NULL) {
-		if (ref->id == hash)
-			return ref;
+	ent = find_entity(entity, entity_size);
+	if (!ent)
+		return 0;
 
-		ref = ref->next;
-	}
+	len = put_utf8(out, ent->codepoint);
+	if (ent->extra)
+		len += put_utf8(out + len, ent->extra);
 
-	return NULL;
+	return len;
 }
 
-static void
-free_link_refs(struct link_ref **references)
-{
-	size_t i;
+// ENDREGION: ENTITIES.C
 
-	for (i = 0; i < REF_TABLE_SIZE; ++i) {
-		struct link_ref *r = references[i];
-		struct link_ref *next;
+// REGION: SCAN.C
 
-		while (r) {
-			next = r->next;
-			sd_bufrelease(r->link);
-			sd_bufrelease(r->title);
-			free(r);
-			r = next;
-		}
-	}
-}
+/* the scans look for a set of bytes a vector at a time where the
+ * compiler targets SSE2 (with AVX2 picked at runtime) or NEON */
+#if !defined(SD_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__) && \
+	(defined(__x86_64__) || defined(__i386__))
+#	define SD_SIMD_X86 1
+#	include <immintrin.h>
+#elif !defined(SD_NO_SIMD) && defined(__GNUC__) && defined(__aarch64__)
+#	define SD_SIMD_NEON 1
+#	include <arm_neon.h>
+#endif
 
-/*
- * Check whether a char is a Markdown space.
+enum {
+	SIMD_NONE,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_NEON
+};
 
- * Right now we only consider spaces the actual
- * space and a newline: tabs and carriage returns
- * are filtered out during the preprocessing phase.
- *
- * If we wanted to actually be UTF-8 compliant, we
- * should instead extract an Unicode codepoint from
- * this character and check for space properties.
- */
+/* simd_level • the widest vector kernels this CPU can run */
+/*	looked up on the first call; renders running at the same time may
+ *	all do it, and store the same level, so the cache is atomic */
 static inline int
-_isspace(int c)
+simd_level(void)
 {
-	return c == ' ' || c == '\n';
+#ifdef SD_SIMD_X86
+	static int level = SIMD_NONE;
+	int found = __atomic_load_n(&level, __ATOMIC_RELAXED);
+
+	if (found == SIMD_NONE) {
+		__builtin_cpu_init();
+		found = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+		__atomic_store_n(&level, found, __ATOMIC_RELAXED);
+	}
+
+	return found;
+#elif defined(SD_SIMD_NEON)
+	return SIMD_NEON;
+#else
+	return SIMD_NONE;
+#endif
 }
 
-/****************************
- * INLINE PARSING FUNCTIONS *
- ****************************/
+/* struct byte_class • a set of bytes for the table-driven scans */
+/*	the table marks the bytes to stop at, or with safe, the bytes to go
+ *	on over; the scalar scan reads it directly. The vector scans look
+ *	the low nibble of a byte up in lo, which holds one bit for each high
+ *	nibble 0-7 of the bytes in the set, and take the bytes from 0x80 all
+ *	in or all out as high says; lo is derived from the table and has to
+ *	be regenerated along with it */
+struct byte_class {
+	const char *table;
+	int safe;
+	int high;
+	uint8_t lo[16];
+};
 
-/* is_mail_autolink • looks for the address part of a mail autolink and '>' */
-/* this is less strict than the original markdown e-mail address matching */
+/* class_scan_scalar • index of the first byte at or after i in the class */
 static size_t
-is_mail_autolink(uint8_t *data, size_t size)
+class_scan_scalar(const struct byte_class *cls, const uint8_t *src, size_t i, size_t size)
 {
-	size_t i = 0, nb = 0;
+	const char *table = cls->table;
+	int safe = cls->safe;
 
-	/* address is assumed to be: [-@._a-zA-Z0-9]+ with exactly one '@' */
-	for (i = 0; i < size; ++i) {
-		if (isalnum(data[i]))
-			continue;
+	while (i + 4 <= size) {
+		if ((table[src[i]] != 0) != safe) return i;
+		if ((table[src[i + 1]] != 0) != safe) return i + 1;
+		if ((table[src[i + 2]] != 0) != safe) return i + 2;
+		if ((table[src[i + 3]] != 0) != safe) return i + 3;
+		i += 4;
+	}
 
-		switch (data[i]) {
-			case '@':
-				nb++;
+	while (i < size && (table[src[i]] != 0) == safe)
+		i++;
 
-			case '-':
-			case '.':
-			case '_':
-				break;
+	return i;
+}
 
-			case '>':
-				return (nb == 1) ? i + 1 : 0;
+/*	the nibble lookup needs a byte shuffle, so x86 has a vector scan
+ *	from AVX2 only; SSE2 alone gets the scalar loop */
 
-			default:
-				return 0;
-		}
+#ifdef SD_SIMD_X86
+__attribute__((target("avx2")))
+static size_t
+class_scan_avx2(const struct byte_class *cls, const uint8_t *src, size_t i, size_t size)
+{
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)cls->lo));
+	const __m256i hi = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble = _mm256_set1_epi8(0x0F), zero = _mm256_setzero_si256();
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i in = _mm256_and_si256(
+			_mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble)),
+			_mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+		unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, zero));
+
+		if (cls->high)
+			mask |= (unsigned int)_mm256_movemask_epi8(v);
+
+		if (mask)
+			return i + __builtin_ctz(mask);
 	}
 
-	return 0;
+	_mm256_zeroupper();
+	return class_scan_scalar(cls, src, i, size);
 }
+#endif
 
-/* tag_length • returns the length of the given tag, or 0 is it's not valid */
+#ifdef SD_SIMD_NEON
 static size_t
-tag_length(uint8_t *data, size_t size, enum mkd_autolink *autolink)
+class_scan_neon(const struct byte_class *cls, const uint8_t *src, size_t i, size_t size)
 {
-	size_t i, j;
-
-	/* a valid tag can't be shorter than 3 chars */
-	if (size < 3) return 0;
-
-	/* begins with a '<' optionally followed by '/', followed by letter or number */
-	if (data[0] != '<') return 0;
-	i = (data[1] == '/') ? 2 : 1;
-
-	if (!isalnum(data[i]))
-		return 0;
-
-	/* scheme test */
-	*autolink = MKDA_NOT_AUTOLINK;
-
-	/* try to find the beginning of an URI */
-	while (i < size && (isalnum(data[i]) || data[i] == '.' || data[i] == '+' || data[i] == '-'))
-		i++;
+	static const uint8_t hi_bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+	const uint8x16_t lo = vld1q_u8(cls->lo), hi = vld1q_u8(hi_bits);
+	const uint8x16_t nibble = vdupq_n_u8(0x0F);
+	const uint8x16_t high = vdupq_n_u8(cls->high ? 0x80 : 0);
 
-	if (i > 1 && data[i] == '@') {
-		if ((j = is_mail_autolink(data + i, size - i)) != 0) {
-			*autolink = MKDA_EMAIL;
-			return i + j;
-		}
-	}
+	for (; i + 16 <= size; i += 16) {
+		uint8x16_t v = vld1q_u8(src + i);
+		uint8x16_t in = vorrq_u8(
+			vtstq_u8(vqtbl1q_u8(lo, vandq_u8(v, nibble)), vqtbl1q_u8(hi, vshrq_n_u8(v, 4))),
+			vtstq_u8(v, high));
 
-	if (i > 2 && data[i] == ':') {
-		*autolink = MKDA_NORMAL;
-		i++;
+		if (vmaxvq_u8(in))
+			return class_scan_scalar(cls, src, i, i + 16);
 	}
 
-	/* completing autolink test: no whitespace or ' or " */
-	if (i >= size)
-		*autolink = MKDA_NOT_AUTOLINK;
-
-	else if (*autolink) {
-		j = i;
-
-		while (i < size) {
-			if (data[i] == '\\') i += 2;
-			else if (data[i] == '>' || data[i] == '\'' ||
-					data[i] == '"' || data[i] == ' ' || data[i] == '\n')
-					break;
-			else i++;
-		}
+	return class_scan_scalar(cls, src, i, size);
+}
+#endif
 
-		if (i >= size) return 0;
-		if (i > j && data[i] == '>') return i + 1;
-		/* one of the forbidden chars has been found */
-		*autolink = MKDA_NOT_AUTOLINK;
+/* class_scan • the kernel for this CPU */
+static inline size_t
+class_scan(const struct byte_class *cls, const uint8_t *src, size_t i, size_t size)
+{
+	switch (simd_level()) {
+#ifdef SD_SIMD_X86
+	case SIMD_AVX2: return class_scan_avx2(cls, src, i, size);
+#endif
+#ifdef SD_SIMD_NEON
+	case SIMD_NEON: return class_scan_neon(cls, src, i, size);
+#endif
+	default: return class_scan_scalar(cls, src, i, size);
 	}
-
-	/* looking for sometinhg looking like a tag end */
-	while (i < size && data[i] != '>') i++;
-	if (i >= size) return 0;
-	return i + 1;
 }
 
-/* parse_inline • parses inline markdown elements */
+/* byte_class_init • derives the class of a table built at runtime, the
+ * bytes from 0x80 go as 0x80 does */
 static void
-parse_inline(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+byte_class_init(struct byte_class *cls, const char *table, int safe)
 {
-	size_t i = 0, end = 0;
-	uint8_t action = 0;
-	struct sd_buf work = { 0, 0, 0, 0 };
+	size_t i;
 
-	if (rndr->work_bufs[BUFFER_SPAN].size +
-		rndr->work_bufs[BUFFER_BLOCK].size > rndr->max_nesting)
-		return;
+	cls->table = table;
+	cls->safe = safe;
+	cls->high = (table[0x80] != 0) != safe;
+	memset(cls->lo, 0x0, sizeof(cls->lo));
 
-	while (i < size) {
-		/* copying inactive chars into the output */
-		while (end < size && (action = rndr->active_char[data[end]]) == 0) {
-			end++;
-		}
+	for (i = 0; i < 0x80; ++i)
+		if ((table[i] != 0) != safe)
+			cls->lo[i & 0x0F] |= (uint8_t)(1 << (i >> 4));
+}
 
-		if (rndr->cb.normal_text) {
-			work.data = data + i;
-			work.size = end - i;
-			rndr->cb.normal_text(ob, &work, rndr->opaque);
-		}
-		else
-			sd_bufput(ob, data + i, end - i);
+// ENDREGION: SCAN.C
 
-		if (end >= size) break;
-		i = end;
+// REGION: MARKDOWN.C
 
-		end = markdown_char_ptrs[(int)action](ob, rndr, data + i, i, size - i);
-		if (!end) /* no action from the callback */
-			end = i + 1;
-		else {
-			i += end;
-			end = i;
-		}
-	}
-}
+#define REF_TABLE_SIZE 8
 
-/* find_emph_char • looks for the next emph uint8_t, skipping other constructs */
-static size_t
-find_emph_char(uint8_t *data, size_t size, uint8_t c)
-{
-	size_t i = 1;
+#define BUFFER_BLOCK 0
+#define BUFFER_SPAN 1
 
-	while (i < size) {
-		while (i < size && data[i] != c && data[i] != '`' && data[i] != '[')
-			i++;
+#define MKD_LI_END 8	/* internal list flag */
 
-		if (i == size)
-			return 0;
+#define gperf_case_strncmp(s1, s2, n) strncasecmp(s1, s2, n)
+#define GPERF_DOWNCASE 1
+#define GPERF_CASE_STRNCMP 1
 
-		if (data[i] == c)
-			return i;
+/***************
+ * LOCAL TYPES *
+ ***************/
 
-		/* not counting escaped chars */
-		if (i && data[i - 1] == '\\') {
-			i++; continue;
-		}
+/* link_ref: reference to a link */
+struct link_ref {
+	unsigned int id;
 
-		if (data[i] == '`') {
-			size_t span_nb = 0, bt;
-			size_t tmp_i = 0;
+	struct sd_buf *link;
+	struct sd_buf *title;
 
-			/* counting the number of opening backticks */
-			while (i < size && data[i] == '`') {
-				i++; span_nb++;
-			}
+	struct link_ref *next;
+};
 
-			if (i >= size) return 0;
+/* sd_line: a line as seen by the block parser */
+/*   data starts after the prefixes of the enclosing containers */
+/*   and the line always ends with '\n', included in size; */
+/*   containers only narrow these views, the text is never modified */
+struct sd_line {
+	uint8_t *data;
+	size_t size;
+	size_t indent;	/* number of leading spaces */
+	int blank;	/* nothing but spaces */
+	unsigned int starts;	/* BLOCK_* constructs the line may open */
+};
 
-			/* finding the matching closing sequence */
-			bt = 0;
-			while (i < size && bt < span_nb) {
-				if (!tmp_i && data[i] == c) tmp_i = i;
-				if (data[i] == '`') bt++;
-				else bt = 0;
-				i++;
-			}
+/* line_array: growable array of lines, pooled like the work buffers */
+struct line_array {
+	struct sd_line *item;
+	size_t size;
+	size_t asize;
+};
 
-			if (i >= size) return tmp_i;
-		}
-		/* skipping a link */
-		else if (data[i] == '[') {
-			size_t tmp_i = 0;
-			uint8_t cc;
+/* block frame kinds: the containers of the block parser */
+enum {
+	FRAME_ROOT,
+	FRAME_QUOTE,
+	FRAME_LIST,
+	FRAME_ITEM,
+};
 
-			i++;
-			while (i < size && data[i] != ']') {
-				if (!tmp_i && data[i] == c) tmp_i = i;
-				i++;
-			}
+/* block_frame: a container and the block sequence being parsed in it */
+struct block_frame {
+	int kind;	/* FRAME_* */
+	struct sd_buf *ob;	/* where the contents are rendered */
+	struct sd_line *lines;	/* the blocks to parse, or a list's items */
+	size_t nlines;
+	size_t beg;	/* next line to parse */
+	struct sd_line *tail;	/* items: a sublist, parsed after lines */
+	size_t ntail;
+	size_t used;	/* quotes: lines taken from the parent */
+	int flags;	/* lists: MKD_LIST_* and MKD_LI_* */
+	int through;	/* rendered by the _begin and _end callbacks */
+};
 
-			i++;
-			while (i < size && (data[i] == ' ' || data[i] == '\n'))
-				i++;
+/* frame_array: the explicit stack of the block parser */
+struct frame_array {
+	struct block_frame *item;
+	size_t size;
+	size_t asize;
+};
 
-			if (i >= size)
-				return tmp_i;
+/* html_close: a closing block tag ending its line, </tag>[ \t]*\n */
+struct html_close {
+	const char *tag;	/* find_block_tag() entry of the tag */
+	uint8_t *pos;	/* its opening '<' */
+};
+
+/* html_close_index: the html_close of a document, by tag then position */
+/*   built on the first HTML block probe of a render */
+struct html_close_index {
+	struct html_close *item;
+	size_t size;
+	size_t asize;
+	uint8_t *text;
+	size_t text_size;
+	int built;
+};
+
+/* frag_block: the top-level block being parsed, for sd_cache_render_blocks */
+struct frag_block {
+	struct sd_cache *cache;	/* NULL in the other renders */
+	uint64_t seed;	/* callbacks, extensions and flags of the render */
+	void *state;	/* the renderer's, carried from a block to the next */
+	size_t state_size;
+	uint64_t block_seed;	/* seed, state and output before the block */
+	uint64_t line_key[2];	/* its first line, with block_seed */
+	int open;	/* a block is being parsed */
+	int leaf;	/* its LEAF_*, for a leaf */
+	size_t beg;	/* its first line */
+	size_t mark;	/* start of its output */
+	size_t unsure;	/* html probes answered by the text past it,
+			 * reference ids that could not be noted */
+	unsigned int *ids;	/* ids of the references it looked up */
+	size_t nids;
+	size_t asize;
+	size_t parsed;	/* blocks parsed in the render */
+};
+
+/* char_trigger: function pointer to render active chars */
+/*   returns the number of chars taken care of */
+/*   data is the pointer of the beginning of the span */
+/*   offset is the number of valid chars before data */
+typedef size_t
+(*char_trigger)(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+
+static size_t char_emphasis(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_linebreak(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_codespan(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_escape(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_entity(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_langle_tag(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_autolink_url(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_autolink_email(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_autolink_www(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_link(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+static size_t char_superscript(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size);
+
+enum markdown_char_t {
+	MD_CHAR_NONE = 0,
+	MD_CHAR_EMPHASIS,
+	MD_CHAR_CODESPAN,
+	MD_CHAR_LINEBREAK,
+	MD_CHAR_LINK,
+	MD_CHAR_LANGLE,
+	MD_CHAR_ESCAPE,
+	MD_CHAR_ENTITITY,
+	MD_CHAR_AUTOLINK_URL,
+	MD_CHAR_AUTOLINK_EMAIL,
+	MD_CHAR_AUTOLINK_WWW,
+	MD_CHAR_SUPERSCRIPT,
+};
+
+static char_trigger markdown_char_ptrs[] = {
+	NULL,
+	&char_emphasis,
+	&char_codespan,
+	&char_linebreak,
+	&char_link,
+	&char_langle_tag,
+	&char_escape,
+	&char_entity,
+	&char_autolink_url,
+	&char_autolink_email,
+	&char_autolink_www,
+	&char_superscript,
+};
+
+/* render • structure containing one particular render */
+struct sd_markdown {
+	struct sd_callbacks	cb;
+	void *opaque;
+
+	struct link_ref *refs[REF_TABLE_SIZE];
+	uint8_t active_char[256];
+	struct byte_class active_class;	/* class_scan over active_char */
+	uint8_t plain_stop[256];	/* chars is_plain_text has to look at */
+	struct byte_class plain_class;	/* class_scan over plain_stop */
+	struct stack work_bufs[2];
+	struct stack line_bufs;
+	struct frame_array block_frames;
+	struct sd_buf *line_text;
+	struct html_close_index html_closes;
+	int *table_cols;
+	size_t table_cols_asize;
+	unsigned int ext_flags;
+	size_t max_nesting;
+	size_t through_nesting;	/* work buffers saved by write-through containers */
+	int in_link_body;
+
+	/* the parsers rendering the blocks found by this one */
+	const struct sd_fanout *fans;
+	size_t nfans;
+	struct stack fan_obs;	/* as a fan: its output at each open container */
+
+	/* top-level blocks spliced from a cache */
+	struct frag_block frag;
+
+	/* plain text seen by parse_inline but not yet handed to normal_text,
+	 * and the output it goes to */
+	struct sd_buf pending_text;
+	struct sd_buf *pending_ob;
+};
+
+/* with SD_RENDERER, the parser calls the members of that type directly */
+#if defined(__cplusplus) && (__cplusplus >= 201103L || _MSVC_LANG >= 201103L) && \
+	!defined(SD_NO_CPP) && defined(SD_RENDERER)
+#define SD_CB_BLOCKCODE sd::detail::blockcode_slot<SD_RENDERER>::thunk
+#define SD_CB_BLOCKQUOTE sd::detail::blockquote_slot<SD_RENDERER>::thunk
+#define SD_CB_BLOCKHTML sd::detail::blockhtml_slot<SD_RENDERER>::thunk
+#define SD_CB_HEADER sd::detail::header_slot<SD_RENDERER>::thunk
+#define SD_CB_HRULE sd::detail::hrule_slot<SD_RENDERER>::thunk
+#define SD_CB_LIST sd::detail::list_slot<SD_RENDERER>::thunk
+#define SD_CB_LISTITEM sd::detail::listitem_slot<SD_RENDERER>::thunk
+#define SD_CB_PARAGRAPH sd::detail::paragraph_slot<SD_RENDERER>::thunk
+#define SD_CB_TABLE sd::detail::table_slot<SD_RENDERER>::thunk
+#define SD_CB_TABLE_ROW sd::detail::table_row_slot<SD_RENDERER>::thunk
+#define SD_CB_TABLE_CELL sd::detail::table_cell_slot<SD_RENDERER>::thunk
+#define SD_CB_AUTOLINK sd::detail::autolink_slot<SD_RENDERER>::thunk
+#define SD_CB_CODESPAN sd::detail::codespan_slot<SD_RENDERER>::thunk
+#define SD_CB_DOUBLE_EMPHASIS sd::detail::double_emphasis_slot<SD_RENDERER>::thunk
+#define SD_CB_EMPHASIS sd::detail::emphasis_slot<SD_RENDERER>::thunk
+#define SD_CB_IMAGE sd::detail::image_slot<SD_RENDERER>::thunk
+#define SD_CB_LINEBREAK sd::detail::linebreak_slot<SD_RENDERER>::thunk
+#define SD_CB_LINK sd::detail::link_slot<SD_RENDERER>::thunk
+#define SD_CB_RAW_HTML_TAG sd::detail::raw_html_tag_slot<SD_RENDERER>::thunk
+#define SD_CB_TRIPLE_EMPHASIS sd::detail::triple_emphasis_slot<SD_RENDERER>::thunk
+#define SD_CB_STRIKETHROUGH sd::detail::strikethrough_slot<SD_RENDERER>::thunk
+#define SD_CB_SUPERSCRIPT sd::detail::superscript_slot<SD_RENDERER>::thunk
+#define SD_CB_ENTITY sd::detail::entity_slot<SD_RENDERER>::thunk
+#define SD_CB_NORMAL_TEXT sd::detail::normal_text_slot<SD_RENDERER>::thunk
+#define SD_CB_DOC_HEADER sd::detail::doc_header_slot<SD_RENDERER>::thunk
+#define SD_CB_DOC_FOOTER sd::detail::doc_footer_slot<SD_RENDERER>::thunk
+#define SD_CB_TABLE_BEGIN sd::detail::table_begin_slot<SD_RENDERER>::thunk
+#define SD_CB_TABLE_END sd::detail::table_end_slot<SD_RENDERER>::thunk
+#define SD_CB_BLOCKQUOTE_BEGIN sd::detail::blockquote_begin_slot<SD_RENDERER>::thunk
+#define SD_CB_BLOCKQUOTE_END sd::detail::blockquote_end_slot<SD_RENDERER>::thunk
+#define SD_CB_LIST_BEGIN sd::detail::list_begin_slot<SD_RENDERER>::thunk
+#define SD_CB_LIST_END sd::detail::list_end_slot<SD_RENDERER>::thunk
+#define SD_CB_LISTITEM_BEGIN sd::detail::listitem_begin_slot<SD_RENDERER>::thunk
+#define SD_CB_LISTITEM_END sd::detail::listitem_end_slot<SD_RENDERER>::thunk
+#endif
+
+/* CB_<NAME> • calls a callback of r, directly when it is SD_CB_<NAME> */
+#define CB_INDIRECT(r, name, ...) ((r)->cb.name(__VA_ARGS__, (r)->opaque))
+#define CB_DIRECT(r, name, hook, ...) \
+	((r)->cb.name == (hook) ? (hook)(__VA_ARGS__, (r)->opaque) : CB_INDIRECT(r, name, __VA_ARGS__))
+
+#ifdef SD_CB_BLOCKCODE
+#define CB_BLOCKCODE(r, ...) CB_DIRECT(r, blockcode, SD_CB_BLOCKCODE, __VA_ARGS__)
+#else
+#define CB_BLOCKCODE(r, ...) CB_INDIRECT(r, blockcode, __VA_ARGS__)
+#endif
+#ifdef SD_CB_BLOCKQUOTE
+#define CB_BLOCKQUOTE(r, ...) CB_DIRECT(r, blockquote, SD_CB_BLOCKQUOTE, __VA_ARGS__)
+#else
+#define CB_BLOCKQUOTE(r, ...) CB_INDIRECT(r, blockquote, __VA_ARGS__)
+#endif
+#ifdef SD_CB_BLOCKHTML
+#define CB_BLOCKHTML(r, ...) CB_DIRECT(r, blockhtml, SD_CB_BLOCKHTML, __VA_ARGS__)
+#else
+#define CB_BLOCKHTML(r, ...) CB_INDIRECT(r, blockhtml, __VA_ARGS__)
+#endif
+#ifdef SD_CB_HEADER
+#define CB_HEADER(r, ...) CB_DIRECT(r, header, SD_CB_HEADER, __VA_ARGS__)
+#else
+#define CB_HEADER(r, ...) CB_INDIRECT(r, header, __VA_ARGS__)
+#endif
+#ifdef SD_CB_HRULE
+#define CB_HRULE(r, ...) CB_DIRECT(r, hrule, SD_CB_HRULE, __VA_ARGS__)
+#else
+#define CB_HRULE(r, ...) CB_INDIRECT(r, hrule, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LIST
+#define CB_LIST(r, ...) CB_DIRECT(r, list, SD_CB_LIST, __VA_ARGS__)
+#else
+#define CB_LIST(r, ...) CB_INDIRECT(r, list, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LISTITEM
+#define CB_LISTITEM(r, ...) CB_DIRECT(r, listitem, SD_CB_LISTITEM, __VA_ARGS__)
+#else
+#define CB_LISTITEM(r, ...) CB_INDIRECT(r, listitem, __VA_ARGS__)
+#endif
+#ifdef SD_CB_PARAGRAPH
+#define CB_PARAGRAPH(r, ...) CB_DIRECT(r, paragraph, SD_CB_PARAGRAPH, __VA_ARGS__)
+#else
+#define CB_PARAGRAPH(r, ...) CB_INDIRECT(r, paragraph, __VA_ARGS__)
+#endif
+#ifdef SD_CB_TABLE
+#define CB_TABLE(r, ...) CB_DIRECT(r, table, SD_CB_TABLE, __VA_ARGS__)
+#else
+#define CB_TABLE(r, ...) CB_INDIRECT(r, table, __VA_ARGS__)
+#endif
+#ifdef SD_CB_TABLE_ROW
+#define CB_TABLE_ROW(r, ...) CB_DIRECT(r, table_row, SD_CB_TABLE_ROW, __VA_ARGS__)
+#else
+#define CB_TABLE_ROW(r, ...) CB_INDIRECT(r, table_row, __VA_ARGS__)
+#endif
+#ifdef SD_CB_TABLE_CELL
+#define CB_TABLE_CELL(r, ...) CB_DIRECT(r, table_cell, SD_CB_TABLE_CELL, __VA_ARGS__)
+#else
+#define CB_TABLE_CELL(r, ...) CB_INDIRECT(r, table_cell, __VA_ARGS__)
+#endif
+#ifdef SD_CB_AUTOLINK
+#define CB_AUTOLINK(r, ...) CB_DIRECT(r, autolink, SD_CB_AUTOLINK, __VA_ARGS__)
+#else
+#define CB_AUTOLINK(r, ...) CB_INDIRECT(r, autolink, __VA_ARGS__)
+#endif
+#ifdef SD_CB_CODESPAN
+#define CB_CODESPAN(r, ...) CB_DIRECT(r, codespan, SD_CB_CODESPAN, __VA_ARGS__)
+#else
+#define CB_CODESPAN(r, ...) CB_INDIRECT(r, codespan, __VA_ARGS__)
+#endif
+#ifdef SD_CB_DOUBLE_EMPHASIS
+#define CB_DOUBLE_EMPHASIS(r, ...) CB_DIRECT(r, double_emphasis, SD_CB_DOUBLE_EMPHASIS, __VA_ARGS__)
+#else
+#define CB_DOUBLE_EMPHASIS(r, ...) CB_INDIRECT(r, double_emphasis, __VA_ARGS__)
+#endif
+#ifdef SD_CB_EMPHASIS
+#define CB_EMPHASIS(r, ...) CB_DIRECT(r, emphasis, SD_CB_EMPHASIS, __VA_ARGS__)
+#else
+#define CB_EMPHASIS(r, ...) CB_INDIRECT(r, emphasis, __VA_ARGS__)
+#endif
+#ifdef SD_CB_IMAGE
+#define CB_IMAGE(r, ...) CB_DIRECT(r, image, SD_CB_IMAGE, __VA_ARGS__)
+#else
+#define CB_IMAGE(r, ...) CB_INDIRECT(r, image, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LINEBREAK
+#define CB_LINEBREAK(r, ...) CB_DIRECT(r, linebreak, SD_CB_LINEBREAK, __VA_ARGS__)
+#else
+#define CB_LINEBREAK(r, ...) CB_INDIRECT(r, linebreak, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LINK
+#define CB_LINK(r, ...) CB_DIRECT(r, link, SD_CB_LINK, __VA_ARGS__)
+#else
+#define CB_LINK(r, ...) CB_INDIRECT(r, link, __VA_ARGS__)
+#endif
+#ifdef SD_CB_RAW_HTML_TAG
+#define CB_RAW_HTML_TAG(r, ...) CB_DIRECT(r, raw_html_tag, SD_CB_RAW_HTML_TAG, __VA_ARGS__)
+#else
+#define CB_RAW_HTML_TAG(r, ...) CB_INDIRECT(r, raw_html_tag, __VA_ARGS__)
+#endif
+#ifdef SD_CB_TRIPLE_EMPHASIS
+#define CB_TRIPLE_EMPHASIS(r, ...) CB_DIRECT(r, triple_emphasis, SD_CB_TRIPLE_EMPHASIS, __VA_ARGS__)
+#else
+#define CB_TRIPLE_EMPHASIS(r, ...) CB_INDIRECT(r, triple_emphasis, __VA_ARGS__)
+#endif
+#ifdef SD_CB_STRIKETHROUGH
+#define CB_STRIKETHROUGH(r, ...) CB_DIRECT(r, strikethrough, SD_CB_STRIKETHROUGH, __VA_ARGS__)
+#else
+#define CB_STRIKETHROUGH(r, ...) CB_INDIRECT(r, strikethrough, __VA_ARGS__)
+#endif
+#ifdef SD_CB_SUPERSCRIPT
+#define CB_SUPERSCRIPT(r, ...) CB_DIRECT(r, superscript, SD_CB_SUPERSCRIPT, __VA_ARGS__)
+#else
+#define CB_SUPERSCRIPT(r, ...) CB_INDIRECT(r, superscript, __VA_ARGS__)
+#endif
+#ifdef SD_CB_ENTITY
+#define CB_ENTITY(r, ...) CB_DIRECT(r, entity, SD_CB_ENTITY, __VA_ARGS__)
+#else
+#define CB_ENTITY(r, ...) CB_INDIRECT(r, entity, __VA_ARGS__)
+#endif
+#ifdef SD_CB_NORMAL_TEXT
+#define CB_NORMAL_TEXT(r, ...) CB_DIRECT(r, normal_text, SD_CB_NORMAL_TEXT, __VA_ARGS__)
+#else
+#define CB_NORMAL_TEXT(r, ...) CB_INDIRECT(r, normal_text, __VA_ARGS__)
+#endif
+#ifdef SD_CB_DOC_HEADER
+#define CB_DOC_HEADER(r, ...) CB_DIRECT(r, doc_header, SD_CB_DOC_HEADER, __VA_ARGS__)
+#else
+#define CB_DOC_HEADER(r, ...) CB_INDIRECT(r, doc_header, __VA_ARGS__)
+#endif
+#ifdef SD_CB_DOC_FOOTER
+#define CB_DOC_FOOTER(r, ...) CB_DIRECT(r, doc_footer, SD_CB_DOC_FOOTER, __VA_ARGS__)
+#else
+#define CB_DOC_FOOTER(r, ...) CB_INDIRECT(r, doc_footer, __VA_ARGS__)
+#endif
+#ifdef SD_CB_TABLE_BEGIN
+#define CB_TABLE_BEGIN(r, ...) CB_DIRECT(r, table_begin, SD_CB_TABLE_BEGIN, __VA_ARGS__)
+#else
+#define CB_TABLE_BEGIN(r, ...) CB_INDIRECT(r, table_begin, __VA_ARGS__)
+#endif
+#ifdef SD_CB_TABLE_END
+#define CB_TABLE_END(r, ...) CB_DIRECT(r, table_end, SD_CB_TABLE_END, __VA_ARGS__)
+#else
+#define CB_TABLE_END(r, ...) CB_INDIRECT(r, table_end, __VA_ARGS__)
+#endif
+#ifdef SD_CB_BLOCKQUOTE_BEGIN
+#define CB_BLOCKQUOTE_BEGIN(r, ...) CB_DIRECT(r, blockquote_begin, SD_CB_BLOCKQUOTE_BEGIN, __VA_ARGS__)
+#else
+#define CB_BLOCKQUOTE_BEGIN(r, ...) CB_INDIRECT(r, blockquote_begin, __VA_ARGS__)
+#endif
+#ifdef SD_CB_BLOCKQUOTE_END
+#define CB_BLOCKQUOTE_END(r, ...) CB_DIRECT(r, blockquote_end, SD_CB_BLOCKQUOTE_END, __VA_ARGS__)
+#else
+#define CB_BLOCKQUOTE_END(r, ...) CB_INDIRECT(r, blockquote_end, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LIST_BEGIN
+#define CB_LIST_BEGIN(r, ...) CB_DIRECT(r, list_begin, SD_CB_LIST_BEGIN, __VA_ARGS__)
+#else
+#define CB_LIST_BEGIN(r, ...) CB_INDIRECT(r, list_begin, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LIST_END
+#define CB_LIST_END(r, ...) CB_DIRECT(r, list_end, SD_CB_LIST_END, __VA_ARGS__)
+#else
+#define CB_LIST_END(r, ...) CB_INDIRECT(r, list_end, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LISTITEM_BEGIN
+#define CB_LISTITEM_BEGIN(r, ...) CB_DIRECT(r, listitem_begin, SD_CB_LISTITEM_BEGIN, __VA_ARGS__)
+#else
+#define CB_LISTITEM_BEGIN(r, ...) CB_INDIRECT(r, listitem_begin, __VA_ARGS__)
+#endif
+#ifdef SD_CB_LISTITEM_END
+#define CB_LISTITEM_END(r, ...) CB_DIRECT(r, listitem_end, SD_CB_LISTITEM_END, __VA_ARGS__)
+#else
+#define CB_LISTITEM_END(r, ...) CB_INDIRECT(r, listitem_end, __VA_ARGS__)
+#endif
+
+/***************************
+ * HELPER FUNCTIONS *
+ ***************************/
+
+static inline struct sd_buf *
+rndr_newbuf(struct sd_markdown *rndr, int type)
+{
+	static const size_t buf_size[2] = {256, 64};
+	struct sd_buf *work = NULL;
+	struct stack *pool = &rndr->work_bufs[type];
+
+	if (pool->size < pool->asize &&
+		pool->item[pool->size] != NULL) {
+		work = (struct sd_buf *)pool->item[pool->size++];
+		work->size = 0;
+	} else {
+		work = sd_bufnew(buf_size[type]);
+		stack_push(pool, work);
+	}
+
+	return work;
+}
+
+static inline void
+rndr_popbuf(struct sd_markdown *rndr, int type)
+{
+	rndr->work_bufs[type].size--;
+}
+
+/* rndr_nesting • current nesting level, checked against max_nesting */
+/*	the work buffers in use, and those write-through containers would
+ *	have used, so both styles of callbacks hit the limit alike */
+static inline size_t
+rndr_nesting(struct sd_markdown *rndr)
+{
+	return rndr->work_bufs[BUFFER_SPAN].size +
+		rndr->work_bufs[BUFFER_BLOCK].size + rndr->through_nesting;
+}
+
+static inline struct line_array *
+rndr_newlines(struct sd_markdown *rndr)
+{
+	struct line_array *lines = NULL;
+	struct stack *pool = &rndr->line_bufs;
+
+	if (pool->size < pool->asize &&
+		pool->item[pool->size] != NULL) {
+		lines = (struct line_array *)pool->item[pool->size++];
+		lines->size = 0;
+	} else {
+		lines = (struct line_array *)calloc(1, sizeof(struct line_array));
+		stack_push(pool, lines);
+	}
+
+	return lines;
+}
+
+static inline void
+rndr_poplines(struct sd_markdown *rndr)
+{
+	rndr->line_bufs.size--;
+}
+
+/* block starts, keyed on the first non-space char of a line */
+enum {
+	BLOCK_ATX = (1 << 0),	/* '#', unindented */
+	BLOCK_HTML = (1 << 1),	/* '<', unindented */
+	BLOCK_SETEXT = (1 << 2),	/* '=' or '-', unindented */
+	BLOCK_RULE = (1 << 3),	/* '*', '-' or '_' */
+	BLOCK_FENCE = (1 << 4),	/* '`' or '~' */
+	BLOCK_QUOTE = (1 << 5),	/* '>' */
+	BLOCK_ULI = (1 << 6),	/* '*', '+' or '-' */
+	BLOCK_OLI = (1 << 7),	/* digits */
+
+	/* the ones still allowed after up to 3 spaces */
+	BLOCK_INDENTED = BLOCK_RULE | BLOCK_FENCE | BLOCK_QUOTE | BLOCK_ULI | BLOCK_OLI,
+};
+
+static const uint8_t BLOCK_STARTS[] = {
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   1,   0,   0,   0,   0,   0,   0,  72,  64,   0,  76,   0,   0,
+	128, 128, 128, 128, 128, 128, 128, 128, 128, 128,   0,   0,   2,   4,  32,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   8,
+	 16,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  16,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+/* block_starts • BLOCK_* constructs that may begin with c after indent spaces */
+static inline unsigned int
+block_starts(uint8_t c, size_t indent)
+{
+	if (indent == 0)
+		return BLOCK_STARTS[c];
+
+	if (indent < 4)
+		return BLOCK_STARTS[c] & BLOCK_INDENTED;
+
+	return 0;
+}
+
+/* line_init • fills a line and caches its indentation */
+static inline void
+line_init(struct sd_line *line, uint8_t *data, size_t size)
+{
+	size_t i = 0;
+
+	while (i < size && data[i] == ' ')
+		i++;
+
+	line->data = data;
+	line->size = size;
+	line->indent = i;
+	line->blank = (i >= size || data[i] == '\n');
+	line->starts = line->blank ? 0 : block_starts(data[i], i);
+}
+
+/* lines_add • appends a line to the array */
+static int
+lines_add(struct line_array *lines, uint8_t *data, size_t size)
+{
+	struct sd_line *line;
+
+	if (lines->size >= lines->asize) {
+		size_t asize = lines->asize ? lines->asize * 2 : 64;
+		struct sd_line *item = (struct sd_line *)realloc(lines->item, asize * sizeof(struct sd_line));
+
+		if (!item)
+			return -1;
+
+		lines->item = item;
+		lines->asize = asize;
+	}
+
+	line = &lines->item[lines->size++];
+	line_init(line, data, size);
+
+	return 0;
+}
+
+/* rndr_flush_text • renders the pending text run; every inline construct
+ * calls it right before writing to ob, so that declined triggers simply
+ * stay part of the surrounding run */
+static inline void
+rndr_flush_text(struct sd_buf *ob, struct sd_markdown *rndr)
+{
+	struct sd_buf *text = &rndr->pending_text;
+
+	if (text->size == 0)
+		return;
+
+	if (rndr->cb.normal_text)
+		CB_NORMAL_TEXT(rndr, ob, text);
+	else
+		sd_bufput(ob, text->data, text->size);
+
+	text->size = 0;
+}
+
+/* rndr_rewind_text • takes back the last bytes of plain text, which an
+ * autolink has claimed as part of the link */
+static inline void
+rndr_rewind_text(struct sd_buf *ob, struct sd_markdown *rndr, size_t rewind)
+{
+	if (rewind <= rndr->pending_text.size) {
+		rndr->pending_text.size -= rewind;
+		rndr_flush_text(ob, rndr);
+	} else {
+		rndr_flush_text(ob, rndr);
+		ob->size -= rewind;
+	}
+}
+
+static void
+unscape_text(struct sd_buf *ob, struct sd_buf *src)
+{
+	size_t i = 0, org;
+	while (i < src->size) {
+		org = i;
+		while (i < src->size && src->data[i] != '\\')
+			i++;
+
+		if (i > org)
+			sd_bufput(ob, src->data + org, i - org);
+
+		if (i + 1 >= src->size)
+			break;
+
+		sd_bufputc(ob, src->data[i + 1]);
+		i += 2;
+	}
+}
+
+static unsigned int
+hash_link_ref(const uint8_t *link_ref, size_t length)
+{
+	size_t i;
+	unsigned int hash = 0;
+
+	for (i = 0; i < length; ++i)
+		hash = tolower(link_ref[i]) + (hash << 6) + (hash << 16) - hash;
+
+	return hash;
+}
+
+static struct link_ref *
+add_link_ref(
+	struct link_ref **references,
+	const uint8_t *name, size_t name_size)
+{
+	struct link_ref *ref = (struct link_ref *)calloc(1, sizeof(struct link_ref));
+
+	if (!ref)
+		return NULL;
+
+	ref->id = hash_link_ref(name, name_size);
+	ref->next = references[ref->id % REF_TABLE_SIZE];
+
+	references[ref->id % REF_TABLE_SIZE] = ref;
+	return ref;
+}
+
+static struct link_ref *
+find_link_ref_id(struct link_ref **references, unsigned int id)
+{
+	struct link_ref *ref = references[id % REF_TABLE_SIZE];
+
+	while (ref != NULL) {
+		if (ref->id == id)
+			return ref;
+
+		ref = ref->next;
+	}
+
+	return NULL;
+}
+
+/* rndr_findref • looks a reference up, noting its id in the top-level
+ * block being parsed for the fragment cache, found or not */
+static struct link_ref *
+rndr_findref(struct sd_markdown *rndr, uint8_t *name, size_t length)
+{
+	unsigned int id = hash_link_ref(name, length);
+	struct frag_block *fb = &rndr->frag;
+
+	if (fb->open) {
+		if (fb->nids == fb->asize) {
+			size_t asize = fb->asize ? fb->asize * 2 : 8;
+			unsigned int *ids = (unsigned int *)realloc(fb->ids, asize * sizeof(unsigned int));
+
+			if (ids) {
+				fb->ids = ids;
+				fb->asize = asize;
+			}
+		}
+
+		/* a block that can't say what it depends on is not stored */
+		if (fb->nids < fb->asize)
+			fb->ids[fb->nids++] = id;
+		else
+			fb->unsure++;
+	}
+
+	return find_link_ref_id(rndr->refs, id);
+}
+
+static void
+free_link_refs(struct link_ref **references)
+{
+	size_t i;
+
+	for (i = 0; i < REF_TABLE_SIZE; ++i) {
+		struct link_ref *r = references[i];
+		struct link_ref *next;
+
+		while (r) {
+			next = r->next;
+			sd_bufrelease(r->link);
+			sd_bufrelease(r->title);
+			free(r);
+			r = next;
+		}
+	}
+}
+
+/*
+ * Check whether a char is a Markdown space.
+
+ * Right now we only consider spaces the actual
+ * space and a newline: tabs and carriage returns
+ * are filtered out during the preprocessing phase.
+ *
+ * If we wanted to actually be UTF-8 compliant, we
+ * should instead extract an Unicode codepoint from
+ * this character and check for space properties.
+ */
+static inline int
+_isspace(int c)
+{
+	return c == ' ' || c == '\n';
+}
+
+/****************************
+ * INLINE PARSING FUNCTIONS *
+ ****************************/
+
+/* is_mail_autolink • looks for the address part of a mail autolink and '>' */
+/* this is less strict than the original markdown e-mail address matching */
+static size_t
+is_mail_autolink(uint8_t *data, size_t size)
+{
+	size_t i = 0, nb = 0;
+
+	/* address is assumed to be: [-@._a-zA-Z0-9]+ with exactly one '@' */
+	for (i = 0; i < size; ++i) {
+		if (isalnum(data[i]))
+			continue;
+
+		switch (data[i]) {
+			case '@':
+				nb++;
+
+			case '-':
+			case '.':
+			case '_':
+				break;
+
+			case '>':
+				return (nb == 1) ? i + 1 : 0;
+
+			default:
+				return 0;
+		}
+	}
+
+	return 0;
+}
+
+/* tag_length • returns the length of the given tag, or 0 is it's not valid */
+static size_t
+tag_length(uint8_t *data, size_t size, enum mkd_autolink *autolink)
+{
+	size_t i, j;
+
+	/* a valid tag can't be shorter than 3 chars */
+	if (size < 3) return 0;
+
+	/* begins with a '<' optionally followed by '/', followed by letter or number */
+	if (data[0] != '<') return 0;
+	i = (data[1] == '/') ? 2 : 1;
+
+	if (!isalnum(data[i]))
+		return 0;
+
+	/* scheme test */
+	*autolink = MKDA_NOT_AUTOLINK;
+
+	/* try to find the beginning of an URI */
+	while (i < size && (isalnum(data[i]) || data[i] == '.' || data[i] == '+' || data[i] == '-'))
+		i++;
+
+	if (i > 1 && data[i] == '@') {
+		if ((j = is_mail_autolink(data + i, size - i)) != 0) {
+			*autolink = MKDA_EMAIL;
+			return i + j;
+		}
+	}
+
+	if (i > 2 && data[i] == ':') {
+		*autolink = MKDA_NORMAL;
+		i++;
+	}
+
+	/* completing autolink test: no whitespace or ' or " */
+	if (i >= size)
+		*autolink = MKDA_NOT_AUTOLINK;
+
+	else if (*autolink) {
+		j = i;
+
+		while (i < size) {
+			if (data[i] == '\\') i += 2;
+			else if (data[i] == '>' || data[i] == '\'' ||
+					data[i] == '"' || data[i] == ' ' || data[i] == '\n')
+					break;
+			else i++;
+		}
+
+		if (i >= size) return 0;
+		if (i > j && data[i] == '>') return i + 1;
+		/* one of the forbidden chars has been found */
+		*autolink = MKDA_NOT_AUTOLINK;
+	}
+
+	/* looking for sometinhg looking like a tag end */
+	while (i < size && data[i] != '>') i++;
+	if (i >= size) return 0;
+	return i + 1;
+}
+
+/* is_autolink_candidate • cheap look-around for the autolink triggers */
+/*	rejects the ':', '@' and 'w' hits that the autolink parsers would */
+/*	decline anyway, so that they don't break the current text run */
+static inline int
+is_autolink_candidate(struct sd_markdown *rndr, uint8_t action, uint8_t *data, size_t offset, size_t size)
+{
+	switch (action) {
+	case MD_CHAR_AUTOLINK_URL: /* "scheme://" */
+		return rndr->cb.autolink && !rndr->in_link_body &&
+			offset > 0 && autolink_is(data[offset - 1], AUTOLINK_ALPHA) &&
+			offset + 3 < size && data[offset + 1] == '/' && data[offset + 2] == '/';
+
+	case MD_CHAR_AUTOLINK_EMAIL: /* "local@domain" */
+		return rndr->cb.autolink && !rndr->in_link_body &&
+			offset > 0 && offset + 1 < size &&
+			autolink_is(data[offset - 1], AUTOLINK_EMAIL) &&
+			autolink_is(data[offset + 1], AUTOLINK_EMAIL);
+
+	case MD_CHAR_AUTOLINK_WWW: /* "www." after a boundary */
+		return rndr->cb.link && !rndr->in_link_body &&
+			offset + 3 < size &&
+			data[offset + 1] == 'w' && data[offset + 2] == 'w' && data[offset + 3] == '.' &&
+			(offset == 0 || autolink_is(data[offset - 1], AUTOLINK_PUNCT | AUTOLINK_SPACE));
+
+	default:
+		return 1;
+	}
+}
+
+/* parse_inline • parses inline markdown elements */
+static void
+parse_inline(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+{
+	size_t i = 0, end = 0;
+	uint8_t action = 0;
+	struct sd_buf *text = &rndr->pending_text;
+	struct sd_buf outer_text, *outer_ob;
+
+	/* the text of the caller comes before the content of its construct:
+	 * normal_text sees the runs in document order (smartypants keeps its
+	 * quote state across them) */
+	if (text->size)
+		rndr_flush_text(rndr->pending_ob, rndr);
+
+	/* beyond max_nesting the content is kept as plain text, like the
+	 * blocks of parse_block_text */
+	if (rndr_nesting(rndr) > rndr->max_nesting) {
+		struct sd_buf plain = {0};
+
+		plain.data = data;
+		plain.size = size;
+
+		if (rndr->cb.normal_text)
+			CB_NORMAL_TEXT(rndr, ob, &plain);
+		else
+			sd_bufput(ob, data, size);
+		return;
+	}
+
+	/* constructs parse their content into their own buffer, so keep the
+	 * run of the caller aside meanwhile */
+	outer_text = *text;
+	outer_ob = rndr->pending_ob;
+	text->data = data;
+	text->size = 0;
+	rndr->pending_ob = ob;
+
+	while (i < size) {
+		/* extending the pending run over inactive chars */
+		while ((end = class_scan(&rndr->active_class, data, end, size)) < size &&
+			!is_autolink_candidate(rndr, (action = rndr->active_char[data[end]]), data, end, size)) {
+			end++;
+		}
+
+		if (text->size == 0)
+			text->data = data + i;
+		text->size += end - i;
+
+		if (end >= size) break;
+		i = end;
+
+		end = markdown_char_ptrs[(int)action](ob, rndr, data + i, i, size - i);
+		if (!end) /* no action from the callback, the char stays in the run */
+			end = i + 1;
+		else {
+			rndr_flush_text(ob, rndr);
+			i += end;
+			end = i;
+		}
+	}
+
+	rndr_flush_text(ob, rndr);
+	*text = outer_text;
+	rndr->pending_ob = outer_ob;
+}
+
+/* find_emph_char • looks for the next emph uint8_t, skipping other constructs */
+static size_t
+find_emph_char(uint8_t *data, size_t size, uint8_t c)
+{
+	size_t i = 1;
+
+	while (i < size) {
+		while (i < size && data[i] != c && data[i] != '`' && data[i] != '[')
+			i++;
+
+		if (i == size)
+			return 0;
+
+		if (data[i] == c)
+			return i;
+
+		/* not counting escaped chars */
+		if (i && data[i - 1] == '\\') {
+			i++; continue;
+		}
+
+		if (data[i] == '`') {
+			size_t span_nb = 0, bt;
+			size_t tmp_i = 0;
+
+			/* counting the number of opening backticks */
+			while (i < size && data[i] == '`') {
+				i++; span_nb++;
+			}
+
+			if (i >= size) return 0;
+
+			/* finding the matching closing sequence */
+			bt = 0;
+			while (i < size && bt < span_nb) {
+				if (!tmp_i && data[i] == c) tmp_i = i;
+				if (data[i] == '`') bt++;
+				else bt = 0;
+				i++;
+			}
+
+			if (i >= size) return tmp_i;
+		}
+		/* skipping a link */
+		else if (data[i] == '[') {
+			size_t tmp_i = 0;
+			uint8_t cc;
+
+			i++;
+			while (i < size && data[i] != ']') {
+				if (!tmp_i && data[i] == c) tmp_i = i;
+				i++;
+			}
+
+			i++;
+			while (i < size && (data[i] == ' ' || data[i] == '\n'))
+				i++;
+
+			if (i >= size)
+				return tmp_i;
+
+			switch (data[i]) {
+			case '[':
+				cc = ']'; break;
+
+			case '(':
+				cc = ')'; break;
+
+			default:
+				if (tmp_i)
+					return tmp_i;
+				else
+					continue;
+			}
+
+			i++;
+			while (i < size && data[i] != cc) {
+				if (!tmp_i && data[i] == c) tmp_i = i;
+				i++;
+			}
+
+			if (i >= size)
+				return tmp_i;
+
+			i++;
+		}
+	}
+
+	return 0;
+}
+
+/* parse_emph1 • parsing single emphase */
+/* closed by a symbol not preceded by whitespace and not followed by symbol */
+static size_t
+parse_emph1(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, uint8_t c)
+{
+	size_t i = 0, len;
+	struct sd_buf *work = 0;
+	int r;
+
+	if (!rndr->cb.emphasis) return 0;
+
+	/* skipping one symbol if coming from emph3 */
+	if (size > 1 && data[0] == c && data[1] == c) i = 1;
+
+	while (i < size) {
+		len = find_emph_char(data + i, size - i, c);
+		if (!len) return 0;
+		i += len;
+		if (i >= size) return 0;
+
+		if (data[i] == c && !_isspace(data[i - 1])) {
+
+			if (rndr->ext_flags & MKDEXT_NO_INTRA_EMPHASIS) {
+				if (i + 1 < size && isalnum(data[i + 1]))
+					continue;
+			}
+
+			work = rndr_newbuf(rndr, BUFFER_SPAN);
+			parse_inline(work, rndr, data, i);
+			rndr_flush_text(ob, rndr);
+			r = CB_EMPHASIS(rndr, ob, work);
+			rndr_popbuf(rndr, BUFFER_SPAN);
+			return r ? i + 1 : 0;
+		}
+	}
+
+	return 0;
+}
+
+/* parse_emph2 • parsing single emphase */
+static size_t
+parse_emph2(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, uint8_t c)
+{
+	int (*render_method)(struct sd_buf *ob, const struct sd_buf *text, void *opaque);
+	size_t i = 0, len;
+	struct sd_buf *work = 0;
+	int r;
+
+	render_method = (c == '~') ? rndr->cb.strikethrough : rndr->cb.double_emphasis;
+
+	if (!render_method)
+		return 0;
+
+	while (i < size) {
+		len = find_emph_char(data + i, size - i, c);
+		if (!len) return 0;
+		i += len;
+
+		if (i + 1 < size && data[i] == c && data[i + 1] == c && i && !_isspace(data[i - 1])) {
+			work = rndr_newbuf(rndr, BUFFER_SPAN);
+			parse_inline(work, rndr, data, i);
+			rndr_flush_text(ob, rndr);
+			r = render_method(ob, work, rndr->opaque);
+			rndr_popbuf(rndr, BUFFER_SPAN);
+			return r ? i + 2 : 0;
+		}
+		i++;
+	}
+	return 0;
+}
+
+/* parse_emph3 • parsing single emphase */
+/* finds the first closing tag, and delegates to the other emph */
+static size_t
+parse_emph3(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, uint8_t c)
+{
+	size_t i = 0, len;
+	int r;
+
+	while (i < size) {
+		len = find_emph_char(data + i, size - i, c);
+		if (!len) return 0;
+		i += len;
+
+		/* skip whitespace preceded symbols */
+		if (data[i] != c || _isspace(data[i - 1]))
+			continue;
+
+		if (i + 2 < size && data[i + 1] == c && data[i + 2] == c && rndr->cb.triple_emphasis) {
+			/* triple symbol found */
+			struct sd_buf *work = rndr_newbuf(rndr, BUFFER_SPAN);
+
+			parse_inline(work, rndr, data, i);
+			rndr_flush_text(ob, rndr);
+			r = CB_TRIPLE_EMPHASIS(rndr, ob, work);
+			rndr_popbuf(rndr, BUFFER_SPAN);
+			return r ? i + 3 : 0;
+
+		} else if (i + 1 < size && data[i + 1] == c) {
+			/* double symbol found, handing over to emph1 */
+			len = parse_emph1(ob, rndr, data - 2, size + 2, c);
+			if (!len) return 0;
+			else return len - 2;
+
+		} else {
+			/* single symbol found, handing over to emph2 */
+			len = parse_emph2(ob, rndr, data - 1, size + 1, c);
+			if (!len) return 0;
+			else return len - 1;
+		}
+	}
+	return 0;
+}
+
+/* char_emphasis • single and double emphasis parsing */
+static size_t
+char_emphasis(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	uint8_t c = data[0];
+	size_t ret;
+
+	if (rndr->ext_flags & MKDEXT_NO_INTRA_EMPHASIS) {
+		if (offset > 0 && !_isspace(data[-1]) && data[-1] != '>')
+			return 0;
+	}
+
+	if (size > 2 && data[1] != c) {
+		/* whitespace cannot follow an opening emphasis;
+		 * strikethrough only takes two characters '~~' */
+		if (c == '~' || _isspace(data[1]) || (ret = parse_emph1(ob, rndr, data + 1, size - 1, c)) == 0)
+			return 0;
+
+		return ret + 1;
+	}
+
+	if (size > 3 && data[1] == c && data[2] != c) {
+		if (_isspace(data[2]) || (ret = parse_emph2(ob, rndr, data + 2, size - 2, c)) == 0)
+			return 0;
+
+		return ret + 2;
+	}
+
+	if (size > 4 && data[1] == c && data[2] == c && data[3] != c) {
+		if (c == '~' || _isspace(data[3]) || (ret = parse_emph3(ob, rndr, data + 3, size - 3, c)) == 0)
+			return 0;
+
+		return ret + 3;
+	}
+
+	return 0;
+}
+
+
+/* char_linebreak • '\n' preceded by two spaces (assuming linebreak != 0) */
+static size_t
+char_linebreak(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	if (offset < 2 || data[-1] != ' ' || data[-2] != ' ')
+		return 0;
+
+	/* removing the last space from ob and rendering */
+	rndr_flush_text(ob, rndr);
+	while (ob->size && ob->data[ob->size - 1] == ' ')
+		ob->size--;
+
+	return CB_LINEBREAK(rndr, ob) ? 1 : 0;
+}
+
+
+/* char_codespan • '`' parsing a code span (assuming codespan != 0) */
+static size_t
+char_codespan(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	size_t end, nb = 0, i, f_begin, f_end;
+
+	/* counting the number of backticks in the delimiter */
+	while (nb < size && data[nb] == '`')
+		nb++;
+
+	/* finding the next delimiter */
+	i = 0;
+	for (end = nb; end < size && i < nb; end++) {
+		if (data[end] == '`') i++;
+		else i = 0;
+	}
+
+	if (i < nb && end >= size)
+		return 0; /* no matching delimiter */
+
+	/* trimming outside whitespaces */
+	f_begin = nb;
+	while (f_begin < end && data[f_begin] == ' ')
+		f_begin++;
+
+	f_end = end - nb;
+	while (f_end > nb && data[f_end-1] == ' ')
+		f_end--;
+
+	/* real code span */
+	rndr_flush_text(ob, rndr);
+	if (f_begin < f_end) {
+		struct sd_buf work = {0};
+        work.data = data + f_begin;
+        work.size = f_end - f_begin;
+		if (!CB_CODESPAN(rndr, ob, &work))
+			end = 0;
+	} else {
+		if (!CB_CODESPAN(rndr, ob, 0))
+			end = 0;
+	}
+
+	return end;
+}
+
+
+/* char_escape • '\\' backslash escape */
+static size_t
+char_escape(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	static const char *escape_chars = "\\`*_{}[]()#+-.!:|&<>^~";
+	struct sd_buf work = { 0, 0, 0, 0 };
+
+	if (size > 1) {
+		if (strchr(escape_chars, data[1]) == NULL)
+			return 0;
+
+		rndr_flush_text(ob, rndr);
+		if (rndr->cb.normal_text) {
+			work.data = data + 1;
+			work.size = 1;
+			CB_NORMAL_TEXT(rndr, ob, &work);
+		}
+		else sd_bufputc(ob, data[1]);
+	} else if (size == 1) {
+		rndr_flush_text(ob, rndr);
+		sd_bufputc(ob, data[0]);
+	}
+
+	return 2;
+}
+
+/* char_entity • '&' escaped when it doesn't belong to an entity */
+/* valid entities are assumed to be anything matching &#?[A-Za-z0-9]+; */
+static size_t
+char_entity(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	size_t end = 1;
+	struct sd_buf work = { 0, 0, 0, 0 };
+
+	if (end < size && data[end] == '#')
+		end++;
+
+	while (end < size && isalnum(data[end]))
+		end++;
+
+	if (end < size && data[end] == ';')
+		end++; /* real entity */
+	else
+		return 0; /* lone '&' */
+
+	rndr_flush_text(ob, rndr);
+	if (rndr->cb.entity) {
+		work.data = data;
+		work.size = end;
+		CB_ENTITY(rndr, ob, &work);
+	}
+	else sd_bufput(ob, data, end);
+
+	return end;
+}
+
+/* char_langle_tag • '<' when tags or autolinks are allowed */
+static size_t
+char_langle_tag(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	enum mkd_autolink altype = MKDA_NOT_AUTOLINK;
+	size_t end = tag_length(data, size, &altype);
+	struct sd_buf work = {0};
+    work.data = data;
+    work.size = end;
+	int ret = 0;
+
+	if (end > 2) {
+		if (rndr->cb.autolink && altype != MKDA_NOT_AUTOLINK) {
+			struct sd_buf *u_link = rndr_newbuf(rndr, BUFFER_SPAN);
+			work.data = data + 1;
+			work.size = end - 2;
+			unscape_text(u_link, &work);
+			rndr_flush_text(ob, rndr);
+			ret = CB_AUTOLINK(rndr, ob, u_link, altype);
+			rndr_popbuf(rndr, BUFFER_SPAN);
+		}
+		else if (rndr->cb.raw_html_tag) {
+			rndr_flush_text(ob, rndr);
+			ret = CB_RAW_HTML_TAG(rndr, ob, &work);
+		}
+	}
+
+	if (!ret) return 0;
+	else return end;
+}
+
+static size_t
+char_autolink_www(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	struct sd_buf *link, *link_url, *link_text;
+	size_t link_len, rewind;
+
+	if (!rndr->cb.link || rndr->in_link_body)
+		return 0;
+
+	link = rndr_newbuf(rndr, BUFFER_SPAN);
+
+	if ((link_len = sd_autolink__www(&rewind, link, data, offset, size, 0)) > 0) {
+		link_url = rndr_newbuf(rndr, BUFFER_SPAN);
+		SD_BUFPUTSL(link_url, "http://");
+		sd_bufput(link_url, link->data, link->size);
+
+		rndr_rewind_text(ob, rndr, rewind);
+		if (rndr->cb.normal_text) {
+			link_text = rndr_newbuf(rndr, BUFFER_SPAN);
+			CB_NORMAL_TEXT(rndr, link_text, link);
+			CB_LINK(rndr, ob, link_url, NULL, link_text);
+			rndr_popbuf(rndr, BUFFER_SPAN);
+		} else {
+			CB_LINK(rndr, ob, link_url, NULL, link);
+		}
+		rndr_popbuf(rndr, BUFFER_SPAN);
+	}
+
+	rndr_popbuf(rndr, BUFFER_SPAN);
+	return link_len;
+}
+
+static size_t
+char_autolink_email(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	struct sd_buf *link;
+	size_t link_len, rewind;
+
+	if (!rndr->cb.autolink || rndr->in_link_body)
+		return 0;
+
+	link = rndr_newbuf(rndr, BUFFER_SPAN);
+
+	if ((link_len = sd_autolink__email(&rewind, link, data, offset, size, 0)) > 0) {
+		rndr_rewind_text(ob, rndr, rewind);
+		CB_AUTOLINK(rndr, ob, link, MKDA_EMAIL);
+	}
+
+	rndr_popbuf(rndr, BUFFER_SPAN);
+	return link_len;
+}
+
+static size_t
+char_autolink_url(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	struct sd_buf *link;
+	size_t link_len, rewind;
+
+	if (!rndr->cb.autolink || rndr->in_link_body)
+		return 0;
+
+	link = rndr_newbuf(rndr, BUFFER_SPAN);
+
+	if ((link_len = sd_autolink__url(&rewind, link, data, offset, size, 0)) > 0) {
+		rndr_rewind_text(ob, rndr, rewind);
+		CB_AUTOLINK(rndr, ob, link, MKDA_NORMAL);
+	}
+
+	rndr_popbuf(rndr, BUFFER_SPAN);
+	return link_len;
+}
+
+/* char_link • '[': parsing a link or an image */
+static size_t
+char_link(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	int is_img = (offset && data[-1] == '!'), level;
+	size_t i = 1, txt_e, link_b = 0, link_e = 0, title_b = 0, title_e = 0;
+	struct sd_buf *content = 0;
+	struct sd_buf *link = 0;
+	struct sd_buf *title = 0;
+	struct sd_buf *u_link = 0;
+	size_t org_work_size = rndr->work_bufs[BUFFER_SPAN].size;
+	int text_has_nl = 0, ret = 0;
+	int in_title = 0, qtype = 0;
+
+	/* checking whether the correct renderer exists */
+	if ((is_img && !rndr->cb.image) || (!is_img && !rndr->cb.link))
+		goto cleanup;
+
+	/* looking for the matching closing bracket */
+	for (level = 1; i < size; i++) {
+		if (data[i] == '\n')
+			text_has_nl = 1;
+
+		else if (data[i - 1] == '\\')
+			continue;
+
+		else if (data[i] == '[')
+			level++;
+
+		else if (data[i] == ']') {
+			level--;
+			if (level <= 0)
+				break;
+		}
+	}
+
+	if (i >= size)
+		goto cleanup;
+
+	txt_e = i;
+	i++;
+
+	/* skip any amount of whitespace or newline */
+	/* (this is much more laxist than original markdown syntax) */
+	while (i < size && _isspace(data[i]))
+		i++;
+
+	/* inline style link */
+	if (i < size && data[i] == '(') {
+		/* skipping initial whitespace */
+		i++;
+
+		while (i < size && _isspace(data[i]))
+			i++;
+
+		link_b = i;
+
+		/* looking for link end: ' " ) */
+		while (i < size) {
+			if (data[i] == '\\') i += 2;
+			else if (data[i] == ')') break;
+			else if (i >= 1 && _isspace(data[i-1]) && (data[i] == '\'' || data[i] == '"')) break;
+			else i++;
+		}
+
+		if (i >= size) goto cleanup;
+		link_e = i;
+
+		/* looking for title end if present */
+		if (data[i] == '\'' || data[i] == '"') {
+			qtype = data[i];
+			in_title = 1;
+			i++;
+			title_b = i;
+
+			while (i < size) {
+				if (data[i] == '\\') i += 2;
+				else if (data[i] == qtype) {in_title = 0; i++;}
+				else if ((data[i] == ')') && !in_title) break;
+				else i++;
+			}
+
+			if (i >= size) goto cleanup;
+
+			/* skipping whitespaces after title */
+			title_e = i - 1;
+			while (title_e > title_b && _isspace(data[title_e]))
+				title_e--;
+
+			/* checking for closing quote presence */
+			if (data[title_e] != '\'' &&  data[title_e] != '"') {
+				title_b = title_e = 0;
+				link_e = i;
+			}
+		}
+
+		/* remove whitespace at the end of the link */
+		while (link_e > link_b && _isspace(data[link_e - 1]))
+			link_e--;
+
+		/* remove optional angle brackets around the link */
+		if (data[link_b] == '<') link_b++;
+		if (data[link_e - 1] == '>') link_e--;
+
+		/* building escaped link and title */
+		if (link_e > link_b) {
+			link = rndr_newbuf(rndr, BUFFER_SPAN);
+			sd_bufput(link, data + link_b, link_e - link_b);
+		}
+
+		if (title_e > title_b) {
+			title = rndr_newbuf(rndr, BUFFER_SPAN);
+			sd_bufput(title, data + title_b, title_e - title_b);
+		}
+
+		i++;
+	}
+
+	/* reference style link */
+	else if (i < size && data[i] == '[') {
+		struct sd_buf id = { 0, 0, 0, 0 };
+		struct link_ref *lr;
+
+		/* looking for the id */
+		i++;
+		link_b = i;
+		while (i < size && data[i] != ']') i++;
+		if (i >= size) goto cleanup;
+		link_e = i;
+
+		/* finding the link_ref */
+		if (link_b == link_e) {
+			if (text_has_nl) {
+				struct sd_buf *b = rndr_newbuf(rndr, BUFFER_SPAN);
+				size_t j;
+
+				for (j = 1; j < txt_e; j++) {
+					if (data[j] != '\n')
+						sd_bufputc(b, data[j]);
+					else if (data[j - 1] != ' ')
+						sd_bufputc(b, ' ');
+				}
+
+				id.data = b->data;
+				id.size = b->size;
+			} else {
+				id.data = data + 1;
+				id.size = txt_e - 1;
+			}
+		} else {
+			id.data = data + link_b;
+			id.size = link_e - link_b;
+		}
+
+		lr = rndr_findref(rndr, id.data, id.size);
+		if (!lr)
+			goto cleanup;
+
+		/* keeping link and title from link_ref */
+		link = lr->link;
+		title = lr->title;
+		i++;
+	}
+
+	/* shortcut reference style link */
+	else {
+		struct sd_buf id = { 0, 0, 0, 0 };
+		struct link_ref *lr;
+
+		/* crafting the id */
+		if (text_has_nl) {
+			struct sd_buf *b = rndr_newbuf(rndr, BUFFER_SPAN);
+			size_t j;
+
+			for (j = 1; j < txt_e; j++) {
+				if (data[j] != '\n')
+					sd_bufputc(b, data[j]);
+				else if (data[j - 1] != ' ')
+					sd_bufputc(b, ' ');
+			}
+
+			id.data = b->data;
+			id.size = b->size;
+		} else {
+			id.data = data + 1;
+			id.size = txt_e - 1;
+		}
+
+		/* finding the link_ref */
+		lr = rndr_findref(rndr, id.data, id.size);
+		if (!lr)
+			goto cleanup;
+
+		/* keeping link and title from link_ref */
+		link = lr->link;
+		title = lr->title;
+
+		/* rewinding the whitespace */
+		i = txt_e + 1;
+	}
+
+	/* building content: img alt is escaped, link content is parsed */
+	if (txt_e > 1) {
+		content = rndr_newbuf(rndr, BUFFER_SPAN);
+		if (is_img) {
+			sd_bufput(content, data + 1, txt_e - 1);
+		} else {
+			/* disable autolinking when parsing inline the
+			 * content of a link */
+			rndr->in_link_body = 1;
+			parse_inline(content, rndr, data + 1, txt_e - 1);
+			rndr->in_link_body = 0;
+		}
+	}
+
+	if (link) {
+		u_link = rndr_newbuf(rndr, BUFFER_SPAN);
+		unscape_text(u_link, link);
+	}
+
+	/* calling the relevant rendering function */
+	if (is_img) {
+		/* the '!' ends the pending text, unless it was already written */
+		if (rndr->pending_text.size)
+			rndr->pending_text.size--;
+		else if (ob->size && ob->data[ob->size - 1] == '!')
+			ob->size -= 1;
+
+		rndr_flush_text(ob, rndr);
+		ret = CB_IMAGE(rndr, ob, u_link, title, content);
+	} else {
+		rndr_flush_text(ob, rndr);
+		ret = CB_LINK(rndr, ob, u_link, title, content);
+	}
+
+	/* cleanup */
+cleanup:
+	rndr->work_bufs[BUFFER_SPAN].size = (int)org_work_size;
+	return ret ? i : 0;
+}
+
+static size_t
+char_superscript(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+{
+	size_t sup_start, sup_len;
+	struct sd_buf *sup;
+
+	if (!rndr->cb.superscript)
+		return 0;
+
+	if (size < 2)
+		return 0;
+
+	if (data[1] == '(') {
+		sup_start = sup_len = 2;
+
+		while (sup_len < size && data[sup_len] != ')' && data[sup_len - 1] != '\\')
+			sup_len++;
+
+		if (sup_len == size)
+			return 0;
+	} else {
+		sup_start = sup_len = 1;
+
+		while (sup_len < size && !_isspace(data[sup_len]))
+			sup_len++;
+	}
+
+	if (sup_len - sup_start == 0)
+		return (sup_start == 2) ? 3 : 0;
+
+	sup = rndr_newbuf(rndr, BUFFER_SPAN);
+	parse_inline(sup, rndr, data + sup_start, sup_len - sup_start);
+	rndr_flush_text(ob, rndr);
+	CB_SUPERSCRIPT(rndr, ob, sup);
+	rndr_popbuf(rndr, BUFFER_SPAN);
+
+	return (sup_start == 2) ? sup_len + 1 : sup_len;
+}
+
+/*********************************
+ * BLOCK-LEVEL PARSING FUNCTIONS *
+ *********************************/
+
+/* is_empty • returns the line length when it is empty, 0 otherwise */
+static size_t
+is_empty(uint8_t *data, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size && data[i] != '\n'; i++)
+		if (data[i] != ' ')
+			return 0;
+
+	return i + 1;
+}
+
+/* is_hrule • returns whether a line is a horizontal rule */
+static int
+is_hrule(uint8_t *data, size_t size)
+{
+	size_t i = 0, n = 0;
+	uint8_t c;
+
+	/* skipping initial spaces */
+	if (size < 3) return 0;
+	if (data[0] == ' ') { i++;
+	if (data[1] == ' ') { i++;
+	if (data[2] == ' ') { i++; } } }
+
+	/* looking at the hrule uint8_t */
+	if (i + 2 >= size
+	|| (data[i] != '*' && data[i] != '-' && data[i] != '_'))
+		return 0;
+	c = data[i];
+
+	/* the whole line must be the char or whitespace */
+	while (i < size && data[i] != '\n') {
+		if (data[i] == c) n++;
+		else if (data[i] != ' ')
+			return 0;
+
+		i++;
+	}
+
+	return n >= 3;
+}
+
+/* check if a line begins with a code fence; return the
+ * width of the code fence */
+static size_t
+prefix_codefence(uint8_t *data, size_t size)
+{
+	size_t i = 0, n = 0;
+	uint8_t c;
+
+	/* skipping initial spaces */
+	if (size < 3) return 0;
+	if (data[0] == ' ') { i++;
+	if (data[1] == ' ') { i++;
+	if (data[2] == ' ') { i++; } } }
+
+	/* looking at the hrule uint8_t */
+	if (i + 2 >= size || !(data[i] == '~' || data[i] == '`'))
+		return 0;
+
+	c = data[i];
+
+	/* the whole line must be the uint8_t or whitespace */
+	while (i < size && data[i] == c) {
+		n++; i++;
+	}
+
+	if (n < 3)
+		return 0;
+
+	return i;
+}
+
+/* check if a line is a code fence; return its size if it is */
+static size_t
+is_codefence(uint8_t *data, size_t size, struct sd_buf *syntax)
+{
+	size_t i = 0, syn_len = 0;
+	uint8_t *syn_start;
+
+	i = prefix_codefence(data, size);
+	if (i == 0)
+		return 0;
+
+	while (i < size && data[i] == ' ')
+		i++;
+
+	syn_start = data + i;
+
+	if (i < size && data[i] == '{') {
+		i++; syn_start++;
+
+		while (i < size && data[i] != '}' && data[i] != '\n') {
+			syn_len++; i++;
+		}
+
+		if (i == size || data[i] != '}')
+			return 0;
+
+		/* strip all whitespace at the beginning and the end
+		 * of the {} block */
+		while (syn_len > 0 && _isspace(syn_start[0])) {
+			syn_start++; syn_len--;
+		}
+
+		while (syn_len > 0 && _isspace(syn_start[syn_len - 1]))
+			syn_len--;
+
+		i++;
+	} else {
+		while (i < size && !_isspace(data[i])) {
+			syn_len++; i++;
+		}
+	}
+
+	if (syntax) {
+		syntax->data = syn_start;
+		syntax->size = syn_len;
+	}
+
+	while (i < size && data[i] != '\n') {
+		if (!_isspace(data[i]))
+			return 0;
+
+		i++;
+	}
+
+	return i + 1;
+}
+
+/* is_atxheader • returns whether the line is a hash-prefixed header */
+static int
+is_atxheader(struct sd_markdown *rndr, uint8_t *data, size_t size)
+{
+	if (data[0] != '#')
+		return 0;
+
+	if (rndr->ext_flags & MKDEXT_SPACE_HEADERS) {
+		size_t level = 0;
+
+		while (level < size && level < 6 && data[level] == '#')
+			level++;
+
+		if (level < size && data[level] != ' ')
+			return 0;
+	}
+
+	return 1;
+}
+
+/* is_headerline • returns whether the line is a setext-style hdr underline */
+static int
+is_headerline(uint8_t *data, size_t size)
+{
+	size_t i = 0;
+
+	/* test of level 1 header */
+	if (data[i] == '=') {
+		for (i = 1; i < size && data[i] == '='; i++);
+		while (i < size && data[i] == ' ') i++;
+		return (i >= size || data[i] == '\n') ? 1 : 0; }
+
+	/* test of level 2 header */
+	if (data[i] == '-') {
+		for (i = 1; i < size && data[i] == '-'; i++);
+		while (i < size && data[i] == ' ') i++;
+		return (i >= size || data[i] == '\n') ? 2 : 0; }
+
+	return 0;
+}
+
+/* prefix_quote • returns blockquote prefix length */
+static size_t
+prefix_quote(uint8_t *data, size_t size)
+{
+	size_t i = 0;
+	if (i < size && data[i] == ' ') i++;
+	if (i < size && data[i] == ' ') i++;
+	if (i < size && data[i] == ' ') i++;
+
+	if (i < size && data[i] == '>') {
+		if (i + 1 < size && data[i + 1] == ' ')
+			return i + 2;
+
+		return i + 1;
+	}
+
+	return 0;
+}
+
+/* prefix_code • returns prefix length for block code*/
+static size_t
+prefix_code(uint8_t *data, size_t size)
+{
+	if (size > 3 && data[0] == ' ' && data[1] == ' '
+		&& data[2] == ' ' && data[3] == ' ') return 4;
+
+	return 0;
+}
+
+
+/* prefix_oli • returns ordered list item prefix */
+/*	next is the following line, if any: a setext underline there wins */
+static size_t
+prefix_oli(uint8_t *data, size_t size, const struct sd_line *next)
+{
+	size_t i = 0;
+
+	if (i < size && data[i] == ' ') i++;
+	if (i < size && data[i] == ' ') i++;
+	if (i < size && data[i] == ' ') i++;
+
+	if (i >= size || data[i] < '0' || data[i] > '9')
+		return 0;
+
+	while (i < size && data[i] >= '0' && data[i] <= '9')
+		i++;
+
+	if (i + 1 >= size || data[i] != '.' || data[i + 1] != ' ')
+		return 0;
+
+	if (next && is_headerline(next->data, next->size))
+		return 0;
+
+	return i + 2;
+}
+
+/* prefix_uli • returns ordered list item prefix */
+/*	next is the following line, if any: a setext underline there wins */
+static size_t
+prefix_uli(uint8_t *data, size_t size, const struct sd_line *next)
+{
+	size_t i = 0;
+
+	if (i < size && data[i] == ' ') i++;
+	if (i < size && data[i] == ' ') i++;
+	if (i < size && data[i] == ' ') i++;
+
+	if (i + 1 >= size ||
+		(data[i] != '*' && data[i] != '+' && data[i] != '-') ||
+		data[i + 1] != ' ')
+		return 0;
+
+	if (next && is_headerline(next->data, next->size))
+		return 0;
+
+	return i + 2;
+}
+
+/* next_line • returns the line following lines[i], NULL on the last one */
+static inline const struct sd_line *
+next_line(const struct sd_line *lines, size_t nlines, size_t i)
+{
+	return (i + 1 < nlines) ? &lines[i + 1] : NULL;
+}
+
+/* lines_text • the text of consecutive lines, trailing '\n' included */
+/*	borrowed when the lines are adjacent in memory, which they are unless
+ *	a container stripped its prefixes; gathered into work otherwise */
+static void
+lines_text(struct sd_buf *text, struct sd_buf *work, const struct sd_line *lines, size_t nlines)
+{
+	size_t i;
+
+	text->data = nlines ? lines[0].data : NULL;
+	text->size = 0;
+
+	for (i = 0; i < nlines && lines[i].data == text->data + text->size; ++i)
+		text->size += lines[i].size;
+
+	if (i == nlines)
+		return;
+
+	work->size = 0;
+	sd_bufput(work, text->data, text->size);
+
+	for (; i < nlines; ++i)
+		sd_bufput(work, lines[i].data, lines[i].size);
+
+	text->data = work->data;
+	text->size = work->size;
+}
+
+
+/* rndr_reserveframes • makes room for n more block frames */
+static int
+rndr_reserveframes(struct sd_markdown *rndr, size_t n)
+{
+	struct frame_array *frames = &rndr->block_frames;
+	struct block_frame *item;
+	size_t asize = frames->asize ? frames->asize : 16;
+
+	if (frames->size + n <= frames->asize)
+		return 1;
+
+	while (asize < frames->size + n)
+		asize *= 2;
+
+	item = (struct block_frame *)realloc(frames->item, asize * sizeof(struct block_frame));
+	if (!item)
+		return 0;
+
+	frames->item = item;
+	frames->asize = asize;
+	return 1;
+}
+
+/* rndr_pushframe • opens a container, in room made by rndr_reserveframes */
+static struct block_frame *
+rndr_pushframe(struct sd_markdown *rndr, int kind, struct sd_buf *ob)
+{
+	struct frame_array *frames = &rndr->block_frames;
+	struct block_frame *frame;
+
+	assert(frames->size < frames->asize);
+
+	frame = &frames->item[frames->size++];
+	memset(frame, 0x0, sizeof(struct block_frame));
+	frame->kind = kind;
+	frame->ob = ob;
+
+	return frame;
+}
+
+/* fan_ob • output of a fan at its innermost open container */
+static inline struct sd_buf *
+fan_ob(struct sd_markdown *fan)
+{
+	return (struct sd_buf *)fan->fan_obs.item[fan->fan_obs.size - 1];
+}
+
+/* frame_through • whether the callbacks write a container through */
+static int
+frame_through(const struct sd_callbacks *cb, int kind)
+{
+	switch (kind) {
+	case FRAME_QUOTE:
+		return cb->blockquote_begin && cb->blockquote_end;
+	case FRAME_LIST:
+		return cb->list_begin && cb->list_end;
+	case FRAME_ITEM:
+		return cb->listitem_begin && cb->listitem_end;
+	}
+
+	return 0;
+}
+
+/* fan_open • opens the container the parser just opened in every fan */
+/*	an item also counts the work buffer the parser took for its text,
+ *	so the fans reach max_nesting where the parser does */
+static void
+fan_open(struct sd_markdown *rndr, int kind, int flags)
+{
+	size_t k;
+
+	for (k = 0; k < rndr->nfans; ++k) {
+		struct sd_markdown *fan = rndr->fans[k].md;
+		struct sd_buf *ob = fan_ob(fan);
+
+		if (kind == FRAME_ITEM)
+			fan->through_nesting++;
+
+		if (!frame_through(&fan->cb, kind))
+			ob = rndr_newbuf(fan, kind == FRAME_ITEM ? BUFFER_SPAN : BUFFER_BLOCK);
+		else {
+			fan->through_nesting++;
+
+			if (kind == FRAME_QUOTE)
+				CB_BLOCKQUOTE_BEGIN(fan, ob);
+			else if (kind == FRAME_LIST)
+				CB_LIST_BEGIN(fan, ob, flags);
+			else
+				CB_LISTITEM_BEGIN(fan, ob, flags);
+		}
+
+		stack_push(&fan->fan_obs, ob);
+	}
+}
+
+/* fan_close • renders the container the parser is closing in every fan */
+static void
+fan_close(struct sd_markdown *rndr, int kind, int flags)
+{
+	size_t k;
+
+	for (k = 0; k < rndr->nfans; ++k) {
+		struct sd_markdown *fan = rndr->fans[k].md;
+		struct sd_buf *ob = (struct sd_buf *)stack_pop(&fan->fan_obs);
+		struct sd_buf *parent = fan_ob(fan);
+		const struct sd_callbacks *cb = &fan->cb;
+
+		if (kind == FRAME_ITEM)
+			fan->through_nesting--;
+
+		if (frame_through(cb, kind)) {
+			fan->through_nesting--;
+
+			if (kind == FRAME_QUOTE)
+				CB_BLOCKQUOTE_END(fan, ob);
+			else if (kind == FRAME_LIST)
+				CB_LIST_END(fan, ob, flags);
+			else
+				CB_LISTITEM_END(fan, ob, flags);
+			continue;
+		}
+
+		if (kind == FRAME_QUOTE && cb->blockquote)
+			CB_BLOCKQUOTE(fan, parent, ob);
+		else if (kind == FRAME_LIST && cb->list)
+			CB_LIST(fan, parent, ob, flags);
+		else if (kind == FRAME_ITEM && cb->listitem)
+			CB_LISTITEM(fan, parent, ob, flags);
+
+		rndr_popbuf(fan, kind == FRAME_ITEM ? BUFFER_SPAN : BUFFER_BLOCK);
+	}
+}
+
+/* parse_block_text • renders lines as a paragraph of plain text */
+/*	used for the contents of containers nested beyond max_nesting */
+static void
+parse_block_text(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
+{
+	struct sd_buf text = {0};
+	struct sd_buf *tmp;
+
+	while (nlines && lines[0].blank) {
+		lines++;
+		nlines--;
+	}
+
+	while (nlines && lines[nlines - 1].blank)
+		nlines--;
+
+	if (!nlines || !rndr->cb.paragraph)
+		return;
+
+	tmp = rndr_newbuf(rndr, BUFFER_BLOCK);
+
+	lines_text(&text, rndr->line_text, lines, nlines);
+	text.size--; /* trailing newline */
+
+	if (rndr->cb.normal_text)
+		CB_NORMAL_TEXT(rndr, tmp, &text);
+	else
+		sd_bufput(tmp, text.data, text.size);
+
+	CB_PARAGRAPH(rndr, ob, tmp);
+	rndr_popbuf(rndr, BUFFER_BLOCK);
+}
+
+/* block_sequence • gives the top frame its next sequence of blocks */
+/*	containers nested beyond max_nesting get their lines as plain text;
+ *	otherwise room is made for the list and item frames the sequence
+ *	may open, so no frame moves while the sequence is parsed */
+static void
+block_sequence(struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
+{
+	struct block_frame *frame;
+	int deeper = rndr_nesting(rndr) <= rndr->max_nesting;
+
+	if (deeper)
+		deeper = rndr_reserveframes(rndr, 2);
+
+	frame = &rndr->block_frames.item[rndr->block_frames.size - 1];
+	frame->lines = lines;
+	frame->nlines = nlines;
+	frame->beg = 0;
+
+	if (!deeper) {
+		size_t k;
+
+		parse_block_text(frame->ob, rndr, lines, nlines);
+		frame->beg = nlines;
+
+		for (k = 0; k < rndr->nfans; ++k)
+			parse_block_text(fan_ob(rndr->fans[k].md), rndr->fans[k].md, lines, nlines);
+	}
+}
+
+
+/* parse_blockquote • opens the frame of a blockquote fragment */
+/*	the lines it takes are skipped in the parent when it closes */
+static void
+parse_blockquote(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
+{
+	size_t i, pre;
+	struct sd_buf *out = 0;
+	struct line_array *inner;
+	struct block_frame *frame;
+	int through = rndr->cb.blockquote_begin && rndr->cb.blockquote_end;
+
+	if (through) {
+		CB_BLOCKQUOTE_BEGIN(rndr, ob);
+		rndr->through_nesting++;
+		out = ob;
+	} else
+		out = rndr_newbuf(rndr, BUFFER_BLOCK);
+
+	inner = rndr_newlines(rndr);
+
+	for (i = 0; i < nlines; ++i) {
+		uint8_t *data = lines[i].data;
+		size_t size = lines[i].size;
+
+		pre = prefix_quote(data, size);
+
+		if (pre) {
+			data += pre; /* skipping prefix */
+			size -= pre;
+		}
+
+		/* empty line followed by non-quote line */
+		else if (lines[i].blank && (i + 1 >= nlines ||
+				(prefix_quote(lines[i + 1].data, lines[i + 1].size) == 0 &&
+				!lines[i + 1].blank))) {
+			i++; /* the empty line goes with the quote */
+			break;
+		}
+
+		/* the quote is parsed from views past the '>' prefixes,
+		 * the source itself is left untouched */
+		lines_add(inner, data, size);
+	}
+
+	frame = rndr_pushframe(rndr, FRAME_QUOTE, out);
+	frame->used = i;
+	frame->through = through;
+	fan_open(rndr, FRAME_QUOTE, 0);
+
+	block_sequence(rndr, inner->item, inner->size);
+}
+
+/* close_blockquote • renders a parsed blockquote into its parent */
+static void
+close_blockquote(struct sd_markdown *rndr, struct block_frame *frame, struct block_frame *parent)
+{
+	parent->beg += frame->used;
+	rndr_poplines(rndr);
+	fan_close(rndr, FRAME_QUOTE, 0);
+
+	if (frame->through) {
+		CB_BLOCKQUOTE_END(rndr, frame->ob);
+		rndr->through_nesting--;
+		return;
+	}
+
+	if (rndr->cb.blockquote)
+		CB_BLOCKQUOTE(rndr, parent->ob, frame->ob);
+
+	rndr_popbuf(rndr, BUFFER_BLOCK);
+}
+
+static size_t
+parse_htmlblock(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines, int do_render);
+
+/* parse_paragraph • handles parsing of a regular paragraph */
+/*	returns the number of lines consumed */
+static size_t
+parse_paragraph(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
+{
+	size_t i = 0, end = 0;
+	int level = 0;
+	struct sd_buf work = {0};
+
+	while (i < nlines) {
+		struct sd_line *line = &lines[i];
+
+		end = i + 1;
+
+		if (line->blank)
+			break;
+
+		/* plain text lines can't start anything, skip the probes */
+		if (!line->starts) {
+			i = end;
+			continue;
+		}
+
+		if ((line->starts & BLOCK_SETEXT) &&
+			(level = is_headerline(line->data, line->size)) != 0)
+			break;
+
+		if (((line->starts & BLOCK_ATX) && is_atxheader(rndr, line->data, line->size)) ||
+			((line->starts & BLOCK_RULE) && is_hrule(line->data, line->size)) ||
+			(line->starts & BLOCK_QUOTE)) {
+			end = i;
+			break;
+		}
+
+		/*
+		 * Early termination of a paragraph with the same logic
+		 * as Markdown 1.0.0. If this logic is applied, the
+		 * Markdown 1.0.3 test suite won't pass cleanly
+		 *
+		 * :: If the first character in a new line is not a letter,
+		 * let's check to see if there's some kind of block starting
+		 * here
+		 */
+		if ((rndr->ext_flags & MKDEXT_LAX_SPACING) && !isalnum(line->data[0])) {
+			const struct sd_line *next = next_line(lines, nlines, i);
+
+			if (((line->starts & BLOCK_OLI) && prefix_oli(line->data, line->size, next)) ||
+				((line->starts & BLOCK_ULI) && prefix_uli(line->data, line->size, next))) {
+				end = i;
+				break;
+			}
+
+			/* see if an html block starts here */
+			if ((line->starts & BLOCK_HTML) && rndr->cb.blockhtml &&
+				parse_htmlblock(ob, rndr, line, nlines - i, 0)) {
+				end = i;
+				break;
+			}
+
+			/* see if a code fence starts here */
+			if ((rndr->ext_flags & MKDEXT_FENCED_CODE) != 0 &&
+				(line->starts & BLOCK_FENCE) &&
+				is_codefence(line->data, line->size, NULL) != 0) {
+				end = i;
+				break;
+			}
+		}
+
+		i = end;
+	}
+
+	/* the text of a block without a callback is not even parsed */
+	if (!level) {
+		if (rndr->cb.paragraph) {
+			struct sd_buf *tmp = rndr_newbuf(rndr, BUFFER_BLOCK);
+
+			lines_text(&work, rndr->line_text, lines, i);
+			if (work.size)
+				work.size--; /* trailing newline */
+
+			parse_inline(tmp, rndr, work.data, work.size);
+			CB_PARAGRAPH(rndr, ob, tmp);
+			rndr_popbuf(rndr, BUFFER_BLOCK);
+		}
+	} else {
+		struct sd_buf *header_work;
+
+		/* the last line before the underline is the header,
+		 * anything above it is a paragraph of its own */
+		if (i > 1 && rndr->cb.paragraph) {
+			struct sd_buf *tmp = rndr_newbuf(rndr, BUFFER_BLOCK);
+
+			lines_text(&work, rndr->line_text, lines, i - 1);
+			parse_inline(tmp, rndr, work.data, work.size - 1);
+			CB_PARAGRAPH(rndr, ob, tmp);
+			rndr_popbuf(rndr, BUFFER_BLOCK);
+		}
+
+		if (i > 0) {
+			work.data = lines[i - 1].data;
+			work.size = lines[i - 1].size - 1;
+		}
+
+		if (rndr->cb.header) {
+			header_work = rndr_newbuf(rndr, BUFFER_SPAN);
+			parse_inline(header_work, rndr, work.data, work.size);
+			CB_HEADER(rndr, ob, header_work, (int)level);
+			rndr_popbuf(rndr, BUFFER_SPAN);
+		}
+	}
+
+	return end;
+}
+
+/* parse_fencedcode • handles parsing of a block-level code fragment */
+/*	returns the number of lines consumed */
+static size_t
+parse_fencedcode(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
+{
+	size_t i, k;
+	struct sd_buf *work = 0;
+	struct sd_buf text = { 0, 0, 0, 0 };
+	struct sd_buf lang = { 0, 0, 0, 0 };
+
+	if (is_codefence(lines[0].data, lines[0].size, &lang) == 0)
+		return 0;
+
+	for (i = 1; i < nlines; ++i) {
+		struct sd_buf fence_trail = { 0, 0, 0, 0 };
+
+		if (is_codefence(lines[i].data, lines[i].size, &fence_trail) != 0 &&
+			fence_trail.size == 0)
+			break;
+	}
+
+	/* the body is borrowed from the source, unless a container stripped
+	 * the line prefixes or a blank line has spaces to drop */
+	text.data = lines[0].data + lines[0].size;
+
+	for (k = 1; k < i && lines[k].data == text.data + text.size &&
+		(!lines[k].blank || lines[k].size == 1); ++k)
+		text.size += lines[k].size;
+
+	if (k < i && rndr->cb.blockcode) {
+		work = rndr_newbuf(rndr, BUFFER_BLOCK);
+		sd_bufput(work, text.data, text.size);
+
+		for (; k < i; ++k) {
+			if (lines[k].blank)
+				sd_bufputc(work, '\n');
+			else sd_bufput(work, lines[k].data, lines[k].size);
+		}
+
+		text.data = work->data;
+		text.size = work->size;
+	}
+
+	if (rndr->cb.blockcode)
+		CB_BLOCKCODE(rndr, ob, &text, lang.size ? &lang : NULL);
+
+	if (work)
+		rndr_popbuf(rndr, BUFFER_BLOCK);
+
+	/* the closing fence, if any */
+	return i < nlines ? i + 1 : i;
+}
+
+/* parse_blockcode • handles parsing of an indented code block */
+/*	returns the number of lines consumed */
+static size_t
+parse_blockcode(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
+{
+	size_t i, pre;
+	struct sd_buf *work = 0;
+
+	/* without a callback, only the extent of the block matters */
+	if (!rndr->cb.blockcode) {
+		for (i = 0; i < nlines; ++i)
+			if (!lines[i].blank && !prefix_code(lines[i].data, lines[i].size))
+				break;
+
+		return i;
+	}
+
+	work = rndr_newbuf(rndr, BUFFER_BLOCK);
+
+	for (i = 0; i < nlines; ++i) {
+		pre = prefix_code(lines[i].data, lines[i].size);
+
+		/* non-empty non-prefixed line breaks the pre */
+		if (!pre && !lines[i].blank)
+			break;
+
+		/* verbatim copy to the working buffer,
+			escaping entities */
+		if (lines[i].blank)
+			sd_bufputc(work, '\n');
+		else sd_bufput(work, lines[i].data + pre, lines[i].size - pre);
+	}
+
+	while (work->size && work->data[work->size - 1] == '\n')
+		work->size -= 1;
+
+	sd_bufputc(work, '\n');
+
+	CB_BLOCKCODE(rndr, ob, work, NULL);
+
+	rndr_popbuf(rndr, BUFFER_BLOCK);
+	return i;
+}
+
+/* parse_listitem • opens the frame of a single list item */
+/*	returns the number of lines it takes, 0 when no item starts here */
+static size_t
+parse_listitem(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines, int *flags)
+{
+	struct sd_buf *work = 0, *inter = 0;
+	struct sd_buf text = {0};
+	struct line_array *inner;
+	struct block_frame *frame;
+	size_t beg, k, pre, sublist = 0, orgpre, i;
+	int in_empty = 0, has_inside_empty = 0, in_fence = 0;
+	uint8_t *data = lines[0].data;
+
+	/* keeping track of the first indentation prefix */
+	orgpre = lines[0].indent < 3 ? lines[0].indent : 3;
+
+	beg = prefix_uli(data, lines[0].size, next_line(lines, nlines, 0));
+	if (!beg)
+		beg = prefix_oli(data, lines[0].size, next_line(lines, nlines, 0));
+
+	if (!beg)
+		return 0;
+
+	/* getting working buffers, the contents of a write-through item go
+	 * straight to ob once its lines are known */
+	work = rndr_newbuf(rndr, BUFFER_SPAN);
+	if (rndr->cb.listitem_begin && rndr->cb.listitem_end) {
+		rndr->through_nesting++;
+		inter = ob;
+	} else
+		inter = rndr_newbuf(rndr, BUFFER_SPAN);
+	inner = rndr_newlines(rndr);
+
+	/* the item is made of views over the source lines, stripped of the
+	 * marker or of their indentation; nothing is copied until a leaf
+	 * needs contiguous text */
+	lines_add(inner, data + beg, lines[0].size - beg);
+
+	/* process the following lines */
+	for (k = 1; k < nlines; ++k) {
+		size_t has_next_uli = 0, has_next_oli = 0;
+		size_t size = lines[k].size;
+		unsigned int starts;
+
+		data = lines[k].data;
+
+		/* process an empty line */
+		if (lines[k].blank) {
+			in_empty = 1;
+			continue;
+		}
+
+		/* calculating the indentation */
+		i = lines[k].indent < 4 ? lines[k].indent : 4;
+
+		pre = i;
+		starts = block_starts(data[lines[k].indent], lines[k].indent - i);
+
+		if ((rndr->ext_flags & MKDEXT_FENCED_CODE) && (starts & BLOCK_FENCE)) {
+			if (is_codefence(data + i, size - i, NULL) != 0)
+				in_fence = !in_fence;
+		}
+
+		/* Only check for new list items if we are **not** inside
+		 * a fenced code block */
+		if (!in_fence) {
+			if (starts & BLOCK_ULI)
+				has_next_uli = prefix_uli(data + i, size - i, NULL);
+			if (starts & BLOCK_OLI)
+				has_next_oli = prefix_oli(data + i, size - i, NULL);
+		}
+
+		/* checking for ul/ol switch */
+		if (in_empty && (
+			((*flags & MKD_LIST_ORDERED) && has_next_uli) ||
+			(!(*flags & MKD_LIST_ORDERED) && has_next_oli))){
+			*flags |= MKD_LI_END;
+			break; /* the following item must have same list type */
+		}
+
+		/* checking for a new item */
+		if ((has_next_uli && !is_hrule(data + i, size - i)) || has_next_oli) {
+			if (in_empty)
+				has_inside_empty = 1;
+
+			if (pre == orgpre) /* the following item must have */
+				break;             /* the same indentation */
+
+			if (!sublist)
+				sublist = inner->size;
+		}
+		/* joining only indented stuff after empty lines;
+		 * note that now we only require 1 space of indentation
+		 * to continue a list */
+		else if (in_empty && pre == 0) {
+			*flags |= MKD_LI_END;
+			break;
+		}
+		else if (in_empty) {
+			/* the empty lines collapse into one: the newline
+			 * ending the previous (blank) line */
+			lines_add(inner, lines[k - 1].data + lines[k - 1].size - 1, 1);
+			has_inside_empty = 1;
+		}
+
+		in_empty = 0;
+
+		/* adding the line without prefix */
+		lines_add(inner, data + i, size - i);
+	}
+
+	/* render of li contents */
+	if (has_inside_empty)
+		*flags |= MKD_LI_BLOCK;
+
+	frame = rndr_pushframe(rndr, FRAME_ITEM, inter);
+	frame->through = (inter == ob);
+
+	if (frame->through)
+		CB_LISTITEM_BEGIN(rndr, ob, *flags);
+
+	fan_open(rndr, FRAME_ITEM, *flags);
+
+	if (!sublist || sublist >= inner->size)
+		sublist = inner->size;
+
+	if (*flags & MKD_LI_BLOCK) {
+		/* block li: the sublist, if any, is a sequence of its own */
+		frame->tail = inner->item + sublist;
+		frame->ntail = inner->size - sublist;
+		block_sequence(rndr, inner->item, sublist);
+	} else {
+		/* inline li, followed by its sublist; the text is only
+		 * parsed for the parsers that render the item */
+		if (rndr->cb.listitem || frame->through) {
+			lines_text(&text, work, inner->item, sublist);
+			parse_inline(inter, rndr, text.data, text.size);
+		}
+
+		for (i = 0; i < rndr->nfans; ++i) {
+			struct sd_markdown *fan = rndr->fans[i].md;
+
+			if (fan->cb.listitem || frame_through(&fan->cb, FRAME_ITEM)) {
+				if (!text.data)
+					lines_text(&text, work, inner->item, sublist);
+
+				parse_inline(fan_ob(fan), fan, text.data, text.size);
+			}
+		}
+
+		block_sequence(rndr, inner->item + sublist, inner->size - sublist);
+	}
+
+	return k;
+}
+
+/* close_listitem • renders a parsed list item into its list */
+static void
+close_listitem(struct sd_markdown *rndr, struct block_frame *frame, struct block_frame *list)
+{
+	rndr_poplines(rndr);
+	fan_close(rndr, FRAME_ITEM, list->flags);
+
+	if (frame->through) {
+		CB_LISTITEM_END(rndr, frame->ob, list->flags);
+		rndr->through_nesting--;
+	} else {
+		if (rndr->cb.listitem)
+			CB_LISTITEM(rndr, list->ob, frame->ob, list->flags);
+
+		rndr_popbuf(rndr, BUFFER_SPAN);
+	}
+
+	rndr_popbuf(rndr, BUFFER_SPAN);
+}
+
+
+/* parse_list • opens the frame of an ordered or unordered list block */
+/*	the lines it takes are skipped in the parent when it closes */
+static void
+parse_list(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines, int flags)
+{
+	struct block_frame *frame;
+	int through = rndr->cb.list_begin && rndr->cb.list_end;
+
+	if (through) {
+		CB_LIST_BEGIN(rndr, ob, flags);
+		rndr->through_nesting++;
+	} else
+		ob = rndr_newbuf(rndr, BUFFER_BLOCK);
+
+	frame = rndr_pushframe(rndr, FRAME_LIST, ob);
+	frame->lines = lines;
+	frame->nlines = nlines;
+	frame->flags = flags;
+	frame->through = through;
+	fan_open(rndr, FRAME_LIST, flags);
+}
+
+/* list_next • opens the next item of the list on top of the frames */
+/*	returns 0 when the list is over */
+static int
+list_next(struct sd_markdown *rndr, struct block_frame *frame)
+{
+	size_t j, at = rndr->block_frames.size - 1;
+
+	if (frame->beg >= frame->nlines || (frame->flags & MKD_LI_END))
+		return 0;
+
+	j = parse_listitem(frame->ob, rndr, frame->lines + frame->beg,
+		frame->nlines - frame->beg, &frame->flags);
+
+	/* the item may have moved the frames */
+	rndr->block_frames.item[at].beg += j;
+	return j != 0;
+}
+
+/* close_list • renders a parsed list into its parent */
+static void
+close_list(struct sd_markdown *rndr, struct block_frame *frame, struct block_frame *parent)
+{
+	parent->beg += frame->beg;
+	fan_close(rndr, FRAME_LIST, frame->flags);
+
+	if (frame->through) {
+		CB_LIST_END(rndr, frame->ob, frame->flags);
+		rndr->through_nesting--;
+		return;
+	}
+
+	if (rndr->cb.list)
+		CB_LIST(rndr, parent->ob, frame->ob, frame->flags);
+
+	rndr_popbuf(rndr, BUFFER_BLOCK);
+}
+
+/* parse_atxheader • parsing of atx-style headers */
+static void
+parse_atxheader(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+{
+	size_t level = 0;
+	size_t i, end;
 
-			switch (data[i]) {
-			case '[':
-				cc = ']'; break;
+	while (level < size && level < 6 && data[level] == '#')
+		level++;
 
-			case '(':
-				cc = ')'; break;
+	for (i = level; i < size && data[i] == ' '; i++);
 
-			default:
-				if (tmp_i)
-					return tmp_i;
-				else
-					continue;
-			}
+	for (end = i; end < size && data[end] != '\n'; end++);
 
-			i++;
-			while (i < size && data[i] != cc) {
-				if (!tmp_i && data[i] == c) tmp_i = i;
-				i++;
+	while (end && data[end - 1] == '#')
+		end--;
+
+	while (end && data[end - 1] == ' ')
+		end--;
+
+	if (end > i && rndr->cb.header) {
+		struct sd_buf *work = rndr_newbuf(rndr, BUFFER_SPAN);
+
+		parse_inline(work, rndr, data + i, end - i);
+		CB_HEADER(rndr, ob, work, (int)level);
+		rndr_popbuf(rndr, BUFFER_SPAN);
+	}
+}
+
+
+/* html_close_cmp • qsort() order of the closing tag index */
+static int
+html_close_cmp(const void *a, const void *b)
+{
+	const struct html_close *x = (const struct html_close *)a, *y = (const struct html_close *)b;
+
+	if (x->tag != y->tag)
+		return (uintptr_t)x->tag < (uintptr_t)y->tag ? -1 : 1;
+
+	if (x->pos != y->pos)
+		return x->pos < y->pos ? -1 : 1;
+
+	return 0;
+}
+
+/* html_close_build • indexes every </tag> followed by a blank end of line */
+static void
+html_close_build(struct html_close_index *idx)
+{
+	uint8_t *p = idx->text, *end = idx->text + idx->text_size;
+
+	idx->size = 0;
+	idx->built = 1;
+
+	while (p + 1 < end && (p = (uint8_t *)memchr(p, '<', end - p - 1)) != NULL) {
+		uint8_t *name = p + 2, *gt = name;
+		const char *tag;
+
+		if (p[1] != '/') {
+			p++;
+			continue;
+		}
+
+		/* block tag names are at most 10 chars long */
+		while (gt < end && gt - name <= 10 && *gt != '>' && *gt != '\n')
+			gt++;
+
+		if (gt < end && *gt == '>' &&
+			(tag = find_block_tag((char *)name, (unsigned int)(gt - name))) != NULL &&
+			is_empty(gt + 1, end - gt - 1)) {
+
+			if (idx->size == idx->asize) {
+				size_t asize = idx->asize ? idx->asize * 2 : 16;
+				struct html_close *item = (struct html_close *)realloc(idx->item, asize * sizeof(struct html_close));
+
+				if (!item)
+					break;
+
+				idx->item = item;
+				idx->asize = asize;
 			}
 
-			if (i >= size)
-				return tmp_i;
+			idx->item[idx->size].tag = tag;
+			idx->item[idx->size].pos = p;
+			idx->size++;
+		}
 
-			i++;
+		p = name;
+	}
+
+	if (idx->size == 0)
+		return;
+
+	qsort(idx->item, idx->size, sizeof(struct html_close), html_close_cmp);
+}
+
+/* htmlblock_end • looks for the line closing the block opened by curtag */
+/*	returns the number of lines of the block, 0 if not found */
+static size_t
+htmlblock_end(const char *curtag,
+	struct sd_markdown *rndr,
+	struct sd_line *lines,
+	size_t nlines,
+	int start_of_line)
+{
+	struct html_close_index *idx = &rndr->html_closes;
+	uint8_t *from = lines[0].data + 1;
+	uint8_t *to = lines[nlines - 1].data + lines[nlines - 1].size;
+	size_t lo = 0, hi, c, k = 0;
+
+	if (!idx->built)
+		html_close_build(idx);
+
+	/* first candidate: (curtag, from) in index order */
+	hi = idx->size;
+	while (lo < hi) {
+		struct html_close key;
+		size_t mid = lo + (hi - lo) / 2;
+
+		key.tag = curtag;
+		key.pos = from;
+
+		if (html_close_cmp(&idx->item[mid], &key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* candidates come in document order, and so do the lines */
+	for (c = lo; c < idx->size && idx->item[c].tag == curtag; ++c) {
+		uint8_t *pos = idx->item[c].pos;
+
+		if (pos >= to)
+			break;
+
+		/* the last line starting at or before the tag */
+		lo = k;
+		hi = nlines;
+		while (hi - lo > 1) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (lines[mid].data <= pos)
+				lo = mid;
+			else
+				hi = mid;
 		}
+		k = lo;
+
+		/* skipping tags hidden in a container prefix */
+		if (pos < lines[k].data || pos >= lines[k].data + lines[k].size)
+			continue;
+
+		/* If we are only looking for unindented tags, skip the tag
+		 * if it doesn't start the line.
+		 *
+		 * The only exception to this is if the tag is still on the
+		 * initial line; in that case it still counts as a closing
+		 * tag
+		 */
+		if (start_of_line && k > 0 && pos != lines[k].data)
+			continue;
+
+		/* the closing line, and a following blank line if any */
+		return (k + 1 < nlines && lines[k + 1].blank) ? k + 2 : k + 1;
 	}
 
 	return 0;
 }
 
-/* parse_emph1 • parsing single emphase */
-/* closed by a symbol not preceded by whitespace and not followed by symbol */
+
+/* parse_htmlblock • parsing of inline HTML block */
+/*	returns the number of lines consumed */
 static size_t
-parse_emph1(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, uint8_t c)
+parse_htmlblock(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines, int do_render)
 {
-	size_t i = 0, len;
-	struct sd_buf *work = 0;
-	int r;
+	size_t i, k, tag_end = 0;
+	const char *curtag = NULL;
+	uint8_t *data = lines[0].data;
+	size_t size = lines[0].size;
+	struct sd_buf work = {0};
 
-	if (!rndr->cb.emphasis) return 0;
+	/* identification of the opening tag */
+	if (size < 2 || data[0] != '<')
+		return 0;
 
-	/* skipping one symbol if coming from emph3 */
-	if (size > 1 && data[0] == c && data[1] == c) i = 1;
+	i = 1;
+	while (i < size && data[i] != '>' && data[i] != ' ' && data[i] != '\n')
+		i++;
 
-	while (i < size) {
-		len = find_emph_char(data + i, size - i, c);
-		if (!len) return 0;
-		i += len;
-		if (i >= size) return 0;
+	if (i < size && data[i] != '\n')
+		curtag = find_block_tag((char *)data + 1, (int)i - 1);
 
-		if (data[i] == c && !_isspace(data[i - 1])) {
+	/* handling of special cases */
+	if (!curtag) {
 
-			if (rndr->ext_flags & MKDEXT_NO_INTRA_EMPHASIS) {
-				if (i + 1 < size && isalnum(data[i + 1]))
-					continue;
+		/* HTML comment, laxist form */
+		if ((size > 5 || nlines > 1) && data[1] == '!' && data[2] == '-' && data[3] == '-') {
+			for (k = 0, i = 5; k < nlines; ++k, i = 2) {
+				data = lines[k].data;
+				size = lines[k].size;
+
+				while (i < size && !(data[i - 2] == '-' && data[i - 1] == '-' && data[i] == '>'))
+					i++;
+
+				if (i < size)
+					break;
+			}
+
+			if (k < nlines && is_empty(data + i + 1, size - i - 1))
+				tag_end = k + 1;
+		}
+
+		/* HR, which is the only self-closing block tag considered */
+		else if ((size > 4 || nlines > 1) && (data[1] == 'h' || data[1] == 'H') && (data[2] == 'r' || data[2] == 'R')) {
+			for (k = 0, i = 3; k < nlines; ++k, i = 0) {
+				data = lines[k].data;
+				size = lines[k].size;
+
+				while (i < size && data[i] != '>')
+					i++;
+
+				if (i < size)
+					break;
 			}
 
-			work = rndr_newbuf(rndr, BUFFER_SPAN);
-			parse_inline(work, rndr, data, i);
-			r = rndr->cb.emphasis(ob, work, rndr->opaque);
-			rndr_popbuf(rndr, BUFFER_SPAN);
-			return r ? i + 1 : 0;
+			if (k < nlines && is_empty(data + i + 1, size - i - 1))
+				tag_end = k + 1;
+		}
+
+		else
+			return 0;
+	}
+
+	else {
+		/* looking for an unindented matching closing tag */
+		/*	followed by a blank line */
+		tag_end = htmlblock_end(curtag, rndr, lines, nlines, 1);
+
+		/* if not found, trying a second pass looking for indented match */
+		/* but not if tag is "ins" or "del" (following original Markdown.pl) */
+		if (!tag_end && strcmp(curtag, "ins") != 0 && strcmp(curtag, "del") != 0) {
+			tag_end = htmlblock_end(curtag, rndr, lines, nlines, 0);
+			rndr->frag.unsure++; /* decided by all the text past it */
+		}
+	}
+
+	/* a block left open, or the answer to a probe, depends on the text
+	 * past the block the probe is made from */
+	if (!tag_end || !do_render)
+		rndr->frag.unsure++;
+
+	if (!tag_end)
+		return 0;
+
+	/* the end of the block has been found */
+	if (do_render && rndr->cb.blockhtml) {
+		lines_text(&work, rndr->line_text, lines, tag_end);
+		CB_BLOCKHTML(rndr, ob, &work);
+	}
+
+	return tag_end;
+}
+
+static void
+parse_table_row(
+	struct sd_buf *ob,
+	struct sd_markdown *rndr,
+	uint8_t *data,
+	size_t size,
+	size_t columns,
+	int *col_data,
+	int header_flag)
+{
+	size_t i = 0, col;
+	struct sd_buf *row_work = 0;
+	uint8_t *pipe;
+
+	if (!rndr->cb.table_cell || !rndr->cb.table_row)
+		return;
+
+	row_work = rndr_newbuf(rndr, BUFFER_SPAN);
+
+	if (i < size && data[i] == '|')
+		i++;
+
+	for (col = 0; col < columns && i < size; ++col) {
+		size_t cell_start, cell_end;
+		struct sd_buf *cell_work;
+
+		cell_work = rndr_newbuf(rndr, BUFFER_SPAN);
+
+		while (i < size && _isspace(data[i]))
+			i++;
+
+		cell_start = i;
+
+		pipe = (uint8_t *)memchr(data + i, '|', size - i);
+		i = pipe ? (size_t)(pipe - data) : size;
+
+		cell_end = i - 1;
+
+		while (cell_end > cell_start && _isspace(data[cell_end]))
+			cell_end--;
+
+		parse_inline(cell_work, rndr, data + cell_start, 1 + cell_end - cell_start);
+		CB_TABLE_CELL(rndr, row_work, cell_work, col_data[col] | header_flag);
+
+		rndr_popbuf(rndr, BUFFER_SPAN);
+		i++;
+	}
+
+	for (; col < columns; ++col) {
+		struct sd_buf empty_cell = { 0, 0, 0, 0 };
+		CB_TABLE_CELL(rndr, row_work, &empty_cell, col_data[col] | header_flag);
+	}
+
+	CB_TABLE_ROW(rndr, ob, row_work);
+
+	rndr_popbuf(rndr, BUFFER_SPAN);
+}
+
+/* parse_table_header • parses the header and underline lines */
+/*	returns the number of lines consumed (2), 0 if this is no table */
+static size_t
+parse_table_header(
+	struct sd_buf *ob,
+	struct sd_markdown *rndr,
+	struct sd_line *lines,
+	size_t nlines,
+	size_t *columns,
+	int **column_data)
+{
+	int pipes;
+	size_t i = 0, col, header_end, under_end;
+	uint8_t *data = lines[0].data, *end = data + lines[0].size - 1, *p;
+
+	pipes = 0;
+	for (p = data; (p = (uint8_t *)memchr(p, '|', end - p)) != NULL; p++)
+		pipes++;
+
+	if (pipes == 0)
+		return 0;
+
+	header_end = lines[0].size - 1;
+
+	while (header_end > 0 && _isspace(data[header_end - 1]))
+		header_end--;
+
+	if (data[0] == '|')
+		pipes--;
+
+	if (header_end && data[header_end - 1] == '|')
+		pipes--;
+
+	*columns = pipes + 1;
+
+	/* the column flags live in per-render scratch */
+	if (rndr->table_cols_asize < *columns) {
+		int *cols = (int *)realloc(rndr->table_cols, *columns * sizeof(int));
+
+		if (!cols)
+			return 0;
+
+		rndr->table_cols = cols;
+		rndr->table_cols_asize = *columns;
+	}
+
+	*column_data = rndr->table_cols;
+	memset(*column_data, 0x0, *columns * sizeof(int));
+
+	/* Parse the header underline */
+	under_end = 0;
+	if (nlines > 1) {
+		data = lines[1].data;
+		under_end = lines[1].size - 1;
+	}
+
+	i = 0;
+	if (i < under_end && data[i] == '|')
+		i++;
+
+	for (col = 0; col < *columns && i < under_end; ++col) {
+		size_t dashes = 0;
+
+		while (i < under_end && data[i] == ' ')
+			i++;
+
+		if (data[i] == ':') {
+			i++; (*column_data)[col] |= MKD_TABLE_ALIGN_L;
+			dashes++;
 		}
-	}
 
-	return 0;
-}
+		while (i < under_end && data[i] == '-') {
+			i++; dashes++;
+		}
 
-/* parse_emph2 • parsing single emphase */
-static size_t
-parse_emph2(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, uint8_t c)
-{
-	int (*render_method)(struct sd_buf *ob, const struct sd_buf *text, void *opaque);
-	size_t i = 0, len;
-	struct sd_buf *work = 0;
-	int r;
+		if (i < under_end && data[i] == ':') {
+			i++; (*column_data)[col] |= MKD_TABLE_ALIGN_R;
+			dashes++;
+		}
 
-	render_method = (c == '~') ? rndr->cb.strikethrough : rndr->cb.double_emphasis;
+		while (i < under_end && data[i] == ' ')
+			i++;
 
-	if (!render_method)
-		return 0;
+		if (i < under_end && data[i] != '|')
+			break;
 
-	while (i < size) {
-		len = find_emph_char(data + i, size - i, c);
-		if (!len) return 0;
-		i += len;
+		if (dashes < 3)
+			break;
 
-		if (i + 1 < size && data[i] == c && data[i + 1] == c && i && !_isspace(data[i - 1])) {
-			work = rndr_newbuf(rndr, BUFFER_SPAN);
-			parse_inline(work, rndr, data, i);
-			r = render_method(ob, work, rndr->opaque);
-			rndr_popbuf(rndr, BUFFER_SPAN);
-			return r ? i + 2 : 0;
-		}
 		i++;
 	}
-	return 0;
+
+	if (col < *columns)
+		return 0;
+
+	/* no header buffer when the table is not rendered */
+	if (ob)
+		parse_table_row(
+			ob, rndr, lines[0].data,
+			header_end,
+			*columns,
+			*column_data,
+			MKD_TABLE_HEADER
+		);
+
+	return nlines > 1 ? 2 : 1;
 }
 
-/* parse_emph3 • parsing single emphase */
-/* finds the first closing tag, and delegates to the other emph */
+/* parse_table • parsing of a table, returns the number of lines consumed */
+/*	with cb.table_begin, the rows go straight to ob instead of being
+ *	collected into a body buffer for cb.table; with neither, the rows
+ *	are only counted */
 static size_t
-parse_emph3(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, uint8_t c)
+parse_table(
+	struct sd_buf *ob,
+	struct sd_markdown *rndr,
+	struct sd_line *lines,
+	size_t nlines)
 {
-	size_t i = 0, len;
-	int r;
+	size_t i;
 
-	while (i < size) {
-		len = find_emph_char(data + i, size - i, c);
-		if (!len) return 0;
-		i += len;
+	struct sd_buf *header_work = 0;
+	struct sd_buf *body_work = 0;
+	struct sd_buf *rows;
 
-		/* skip whitespace preceded symbols */
-		if (data[i] != c || _isspace(data[i - 1]))
-			continue;
+	size_t columns;
+	int *col_data = NULL;
 
-		if (i + 2 < size && data[i + 1] == c && data[i + 2] == c && rndr->cb.triple_emphasis) {
-			/* triple symbol found */
-			struct sd_buf *work = rndr_newbuf(rndr, BUFFER_SPAN);
+	int streaming = rndr->cb.table_begin != NULL;
+	int render = streaming || rndr->cb.table;
 
-			parse_inline(work, rndr, data, i);
-			r = rndr->cb.triple_emphasis(ob, work, rndr->opaque);
-			rndr_popbuf(rndr, BUFFER_SPAN);
-			return r ? i + 3 : 0;
+	if (render)
+		header_work = rndr_newbuf(rndr, BUFFER_SPAN);
+	if (render && !streaming)
+		body_work = rndr_newbuf(rndr, BUFFER_BLOCK);
 
-		} else if (i + 1 < size && data[i + 1] == c) {
-			/* double symbol found, handing over to emph1 */
-			len = parse_emph1(ob, rndr, data - 2, size + 2, c);
-			if (!len) return 0;
-			else return len - 2;
+	i = parse_table_header(header_work, rndr, lines, nlines, &columns, &col_data);
+	if (i > 0) {
+		if (streaming)
+			CB_TABLE_BEGIN(rndr, ob, header_work);
 
-		} else {
-			/* single symbol found, handing over to emph2 */
-			len = parse_emph2(ob, rndr, data - 1, size + 1, c);
-			if (!len) return 0;
-			else return len - 1;
-		}
-	}
-	return 0;
-}
+		rows = streaming ? ob : body_work;
 
-/* char_emphasis • single and double emphasis parsing */
-static size_t
-char_emphasis(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	uint8_t c = data[0];
-	size_t ret;
+		for (; i < nlines; ++i) {
+			uint8_t *data = lines[i].data;
+			size_t size = lines[i].size - 1;
 
-	if (rndr->ext_flags & MKDEXT_NO_INTRA_EMPHASIS) {
-		if (offset > 0 && !_isspace(data[-1]) && data[-1] != '>')
-			return 0;
-	}
+			if (memchr(data, '|', size) == NULL)
+				break;
 
-	if (size > 2 && data[1] != c) {
-		/* whitespace cannot follow an opening emphasis;
-		 * strikethrough only takes two characters '~~' */
-		if (c == '~' || _isspace(data[1]) || (ret = parse_emph1(ob, rndr, data + 1, size - 1, c)) == 0)
-			return 0;
+			if (!render)
+				continue;
 
-		return ret + 1;
+			parse_table_row(
+				rows,
+				rndr,
+				data,
+				size,
+				columns,
+				col_data, 0
+			);
+		}
+
+		if (streaming) {
+			if (rndr->cb.table_end)
+				CB_TABLE_END(rndr, ob);
+		} else if (rndr->cb.table)
+			CB_TABLE(rndr, ob, header_work, body_work);
 	}
 
-	if (size > 3 && data[1] == c && data[2] != c) {
-		if (_isspace(data[2]) || (ret = parse_emph2(ob, rndr, data + 2, size - 2, c)) == 0)
-			return 0;
+	if (body_work)
+		rndr_popbuf(rndr, BUFFER_BLOCK);
+	if (header_work)
+		rndr_popbuf(rndr, BUFFER_SPAN);
+	return i;
+}
 
-		return ret + 2;
-	}
+/* leaf blocks, as handed to the fans */
+enum {
+	LEAF_NONE,
+	LEAF_ATX,
+	LEAF_HTML,
+	LEAF_RULE,
+	LEAF_FENCE,
+	LEAF_TABLE,
+	LEAF_CODE,
+	LEAF_PARAGRAPH,
+};
 
-	if (size > 4 && data[1] == c && data[2] == c && data[3] != c) {
-		if (c == '~' || _isspace(data[3]) || (ret = parse_emph3(ob, rndr, data + 3, size - 3, c)) == 0)
-			return 0;
+/* fan_leaf • renders the leaf block the parser just took in every fan */
+/*	the fans get the lines the parser took, no more, so they agree on
+ *	where the block ends even where their callbacks would not */
+static void
+fan_leaf(struct sd_markdown *rndr, int leaf, struct sd_line *lines, size_t nlines)
+{
+	size_t k;
 
-		return ret + 3;
-	}
+	for (k = 0; k < rndr->nfans; ++k) {
+		struct sd_markdown *fan = rndr->fans[k].md;
+		struct sd_buf *ob = fan_ob(fan);
 
-	return 0;
-}
+		switch (leaf) {
+		case LEAF_ATX:
+			parse_atxheader(ob, fan, lines[0].data, lines[0].size);
+			break;
 
+		case LEAF_HTML:
+			if (fan->cb.blockhtml) {
+				struct sd_buf work = {0};
 
-/* char_linebreak • '\n' preceded by two spaces (assuming linebreak != 0) */
-static size_t
-char_linebreak(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	if (offset < 2 || data[-1] != ' ' || data[-2] != ' ')
-		return 0;
+				lines_text(&work, fan->line_text, lines, nlines);
+				CB_BLOCKHTML(fan, ob, &work);
+			}
+			break;
 
-	/* removing the last space from ob and rendering */
-	while (ob->size && ob->data[ob->size - 1] == ' ')
-		ob->size--;
+		case LEAF_RULE:
+			if (fan->cb.hrule)
+				CB_HRULE(fan, ob);
+			break;
 
-	return rndr->cb.linebreak(ob, rndr->opaque) ? 1 : 0;
-}
+		case LEAF_FENCE:
+			parse_fencedcode(ob, fan, lines, nlines);
+			break;
 
+		case LEAF_TABLE:
+			parse_table(ob, fan, lines, nlines);
+			break;
 
-/* char_codespan • '`' parsing a code span (assuming codespan != 0) */
-static size_t
-char_codespan(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	size_t end, nb = 0, i, f_begin, f_end;
+		case LEAF_CODE:
+			parse_blockcode(ob, fan, lines, nlines);
+			break;
 
-	/* counting the number of backticks in the delimiter */
-	while (nb < size && data[nb] == '`')
-		nb++;
+		case LEAF_PARAGRAPH:
+			parse_paragraph(ob, fan, lines, nlines);
+			break;
+		}
+	}
+}
 
-	/* finding the next delimiter */
-	i = 0;
-	for (end = nb; end < size && i < nb; end++) {
-		if (data[end] == '`') i++;
-		else i = 0;
+/* parse_block_one • parses the next block of the frame on top */
+/*	blockquotes and lists push a frame of their own and are parsed
+ *	from the loop in parse_block, rather than recursively */
+static void
+parse_block_one(struct sd_markdown *rndr, struct block_frame *frame)
+{
+	struct sd_buf *ob = frame->ob;
+	struct sd_line *line = &frame->lines[frame->beg];
+	size_t rest = frame->nlines - frame->beg, i = 0;
+	const struct sd_line *next = next_line(frame->lines, frame->nlines, frame->beg);
+	int leaf = LEAF_NONE;
+
+	unsigned int starts = line->starts;
+
+	/* the classification of the line gates every candidate, so
+	 * only the constructs it can actually open get probed */
+	if ((starts & BLOCK_ATX) && is_atxheader(rndr, line->data, line->size)) {
+		parse_atxheader(ob, rndr, line->data, line->size);
+		leaf = LEAF_ATX;
+		i = 1;
 	}
 
-	if (i < nb && end >= size)
-		return 0; /* no matching delimiter */
+	else if ((starts & BLOCK_HTML) && rndr->cb.blockhtml &&
+			(i = parse_htmlblock(ob, rndr, line, rest, 1)) != 0)
+		leaf = LEAF_HTML;
 
-	/* trimming outside whitespaces */
-	f_begin = nb;
-	while (f_begin < end && data[f_begin] == ' ')
-		f_begin++;
+	else if (line->blank)
+		i = 1;
 
-	f_end = end - nb;
-	while (f_end > nb && data[f_end-1] == ' ')
-		f_end--;
+	else if ((starts & BLOCK_RULE) && is_hrule(line->data, line->size)) {
+		if (rndr->cb.hrule)
+			CB_HRULE(rndr, ob);
 
-	/* real code span */
-	if (f_begin < f_end) {
-		struct sd_buf work = {0};
-        work.data = data + f_begin;
-        work.size = f_end - f_begin;
-		if (!rndr->cb.codespan(ob, &work, rndr->opaque))
-			end = 0;
-	} else {
-		if (!rndr->cb.codespan(ob, 0, rndr->opaque))
-			end = 0;
+		leaf = LEAF_RULE;
+		i = 1;
 	}
 
-	return end;
-}
-
+	else if ((rndr->ext_flags & MKDEXT_FENCED_CODE) != 0 && (starts & BLOCK_FENCE) &&
+		(i = parse_fencedcode(ob, rndr, line, rest)) != 0)
+		leaf = LEAF_FENCE;
 
-/* char_escape • '\\' backslash escape */
-static size_t
-char_escape(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	static const char *escape_chars = "\\`*_{}[]()#+-.!:|&<>^~";
-	struct sd_buf work = { 0, 0, 0, 0 };
+	else if ((rndr->ext_flags & MKDEXT_TABLES) != 0 &&
+		memchr(line->data, '|', line->size) != NULL &&
+		(i = parse_table(ob, rndr, line, rest)) != 0)
+		leaf = LEAF_TABLE;
 
-	if (size > 1) {
-		if (strchr(escape_chars, data[1]) == NULL)
-			return 0;
+	else if (starts & BLOCK_QUOTE)
+		parse_blockquote(ob, rndr, line, rest);
 
-		if (rndr->cb.normal_text) {
-			work.data = data + 1;
-			work.size = 1;
-			rndr->cb.normal_text(ob, &work, rndr->opaque);
-		}
-		else sd_bufputc(ob, data[1]);
-	} else if (size == 1) {
-		sd_bufputc(ob, data[0]);
+	else if (line->indent >= 4) {
+		i = parse_blockcode(ob, rndr, line, rest);
+		leaf = LEAF_CODE;
 	}
 
-	return 2;
-}
+	else if ((starts & BLOCK_ULI) && prefix_uli(line->data, line->size, next))
+		parse_list(ob, rndr, line, rest, 0);
 
-/* char_entity • '&' escaped when it doesn't belong to an entity */
-/* valid entities are assumed to be anything matching &#?[A-Za-z0-9]+; */
-static size_t
-char_entity(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	size_t end = 1;
-	struct sd_buf work = { 0, 0, 0, 0 };
+	else if ((starts & BLOCK_OLI) && prefix_oli(line->data, line->size, next))
+		parse_list(ob, rndr, line, rest, MKD_LIST_ORDERED);
 
-	if (end < size && data[end] == '#')
-		end++;
+	else {
+		i = parse_paragraph(ob, rndr, line, rest);
+		leaf = LEAF_PARAGRAPH;
+	}
 
-	while (end < size && isalnum(data[end]))
-		end++;
+	/* a container pushed frames of its own, and may have moved this one */
+	if (i == 0)
+		return;
 
-	if (end < size && data[end] == ';')
-		end++; /* real entity */
-	else
-		return 0; /* lone '&' */
+	frame->beg += i;
 
-	if (rndr->cb.entity) {
-		work.data = data;
-		work.size = end;
-		rndr->cb.entity(ob, &work, rndr->opaque);
-	}
-	else sd_bufput(ob, data, end);
+	if (leaf != LEAF_NONE && rndr->nfans)
+		fan_leaf(rndr, leaf, line, i);
 
-	return end;
+	if (frame->kind == FRAME_ROOT)
+		rndr->frag.leaf = leaf;
 }
 
-/* char_langle_tag • '<' when tags or autolinks are allowed */
-static size_t
-char_langle_tag(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+#ifndef SD_NO_CACHE
+static int
+frag_next(struct sd_markdown *rndr, struct block_frame *root);
+#endif
+
+/* parse_block • parsing of a sequence of blocks */
+/*	the containers are kept on rndr->block_frames rather than on the C
+ *	stack, so the depth of a document costs heap, not stack */
+static void
+parse_block(struct sd_buf *ob, struct sd_markdown *rndr, struct sd_line *lines, size_t nlines)
 {
-	enum mkd_autolink altype = MKDA_NOT_AUTOLINK;
-	size_t end = tag_length(data, size, &altype);
-	struct sd_buf work = {0};
-    work.data = data;
-    work.size = end;
-	int ret = 0;
+	struct frame_array *frames = &rndr->block_frames;
+	size_t base = frames->size;
+
+	if (!rndr_reserveframes(rndr, 1))
+		return;
+
+	rndr_pushframe(rndr, FRAME_ROOT, ob);
+	block_sequence(rndr, lines, nlines);
+
+	while (frames->size > base) {
+		struct block_frame *frame = &frames->item[frames->size - 1];
+
+#ifndef SD_NO_CACHE
+		/* between two top-level blocks, when rendering through a cache */
+		if (rndr->frag.cache && frame->kind == FRAME_ROOT && frag_next(rndr, frame))
+			continue;
+#endif
 
-	if (end > 2) {
-		if (rndr->cb.autolink && altype != MKDA_NOT_AUTOLINK) {
-			struct sd_buf *u_link = rndr_newbuf(rndr, BUFFER_SPAN);
-			work.data = data + 1;
-			work.size = end - 2;
-			unscape_text(u_link, &work);
-			ret = rndr->cb.autolink(ob, u_link, altype, rndr->opaque);
-			rndr_popbuf(rndr, BUFFER_SPAN);
+		if (frame->kind == FRAME_LIST) {
+			if (list_next(rndr, frame))
+				continue;
 		}
-		else if (rndr->cb.raw_html_tag)
-			ret = rndr->cb.raw_html_tag(ob, &work, rndr->opaque);
-	}
 
-	if (!ret) return 0;
-	else return end;
-}
+		else if (frame->beg < frame->nlines) {
+			parse_block_one(rndr, frame);
+			continue;
+		}
 
-static size_t
-char_autolink_www(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	struct sd_buf *link, *link_url, *link_text;
-	size_t link_len, rewind;
+		/* block li: the sublist comes after the item's own blocks */
+		else if (frame->ntail) {
+			struct sd_line *tail = frame->tail;
+			size_t ntail = frame->ntail;
 
-	if (!rndr->cb.link || rndr->in_link_body)
-		return 0;
+			frame->ntail = 0;
+			block_sequence(rndr, tail, ntail);
+			continue;
+		}
 
-	link = rndr_newbuf(rndr, BUFFER_SPAN);
+		/* all the contents are parsed: closing the container */
+		switch (frame->kind) {
+		case FRAME_QUOTE:
+			close_blockquote(rndr, frame, frame - 1);
+			break;
 
-	if ((link_len = sd_autolink__www(&rewind, link, data, offset, size, 0)) > 0) {
-		link_url = rndr_newbuf(rndr, BUFFER_SPAN);
-		SD_BUFPUTSL(link_url, "http://");
-		sd_bufput(link_url, link->data, link->size);
+		case FRAME_LIST:
+			close_list(rndr, frame, frame - 1);
+			break;
 
-		ob->size -= rewind;
-		if (rndr->cb.normal_text) {
-			link_text = rndr_newbuf(rndr, BUFFER_SPAN);
-			rndr->cb.normal_text(link_text, link, rndr->opaque);
-			rndr->cb.link(ob, link_url, NULL, link_text, rndr->opaque);
-			rndr_popbuf(rndr, BUFFER_SPAN);
-		} else {
-			rndr->cb.link(ob, link_url, NULL, link, rndr->opaque);
+		case FRAME_ITEM:
+			close_listitem(rndr, frame, frame - 1);
+			break;
 		}
-		rndr_popbuf(rndr, BUFFER_SPAN);
-	}
 
-	rndr_popbuf(rndr, BUFFER_SPAN);
-	return link_len;
+		frames->size--;
+	}
 }
 
-static size_t
-char_autolink_email(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+
+/*********************
+ * REFERENCE PARSING *
+ *********************/
+
+/* is_ref • returns whether a line is a reference or not */
+static int
+is_ref(const uint8_t *data, size_t beg, size_t end, size_t *last, struct link_ref **refs)
 {
-	struct sd_buf *link;
-	size_t link_len, rewind;
+/*	int n; */
+	size_t i = 0;
+	size_t id_offset, id_end;
+	size_t link_offset, link_end;
+	size_t title_offset, title_end;
+	size_t line_end;
 
-	if (!rndr->cb.autolink || rndr->in_link_body)
-		return 0;
+	/* up to 3 optional leading spaces */
+	if (beg + 3 >= end) return 0;
+	if (data[beg] == ' ') { i = 1;
+	if (data[beg + 1] == ' ') { i = 2;
+	if (data[beg + 2] == ' ') { i = 3;
+	if (data[beg + 3] == ' ') return 0; } } }
+	i += beg;
 
-	link = rndr_newbuf(rndr, BUFFER_SPAN);
+	/* id part: anything but a newline between brackets */
+	if (data[i] != '[') return 0;
+	i++;
+	id_offset = i;
+	while (i < end && data[i] != '\n' && data[i] != '\r' && data[i] != ']')
+		i++;
+	if (i >= end || data[i] != ']') return 0;
+	id_end = i;
 
-	if ((link_len = sd_autolink__email(&rewind, link, data, offset, size, 0)) > 0) {
-		ob->size -= rewind;
-		rndr->cb.autolink(ob, link, MKDA_EMAIL, rndr->opaque);
-	}
+	/* spacer: colon (space | tab)* newline? (space | tab)* */
+	i++;
+	if (i >= end || data[i] != ':') return 0;
+	i++;
+	while (i < end && data[i] == ' ') i++;
+	if (i < end && (data[i] == '\n' || data[i] == '\r')) {
+		i++;
+		if (i < end && data[i] == '\r' && data[i - 1] == '\n') i++; }
+	while (i < end && data[i] == ' ') i++;
+	if (i >= end) return 0;
 
-	rndr_popbuf(rndr, BUFFER_SPAN);
-	return link_len;
-}
+	/* link: whitespace-free sequence, optionally between angle brackets */
+	if (data[i] == '<')
+		i++;
 
-static size_t
-char_autolink_url(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	struct sd_buf *link;
-	size_t link_len, rewind;
+	link_offset = i;
 
-	if (!rndr->cb.autolink || rndr->in_link_body)
+	while (i < end && data[i] != ' ' && data[i] != '\n' && data[i] != '\r')
+		i++;
+
+	if (data[i - 1] == '>') link_end = i - 1;
+	else link_end = i;
+
+	/* optional spacer: (space | tab)* (newline | '\'' | '"' | '(' ) */
+	while (i < end && data[i] == ' ') i++;
+	if (i < end && data[i] != '\n' && data[i] != '\r'
+			&& data[i] != '\'' && data[i] != '"' && data[i] != '(')
 		return 0;
+	line_end = 0;
+	/* computing end-of-line */
+	if (i >= end || data[i] == '\r' || data[i] == '\n') line_end = i;
+	if (i + 1 < end && data[i] == '\n' && data[i + 1] == '\r')
+		line_end = i + 1;
 
-	link = rndr_newbuf(rndr, BUFFER_SPAN);
+	/* optional (space|tab)* spacer after a newline */
+	if (line_end) {
+		i = line_end + 1;
+		while (i < end && data[i] == ' ') i++; }
 
-	if ((link_len = sd_autolink__url(&rewind, link, data, offset, size, 0)) > 0) {
-		ob->size -= rewind;
-		rndr->cb.autolink(ob, link, MKDA_NORMAL, rndr->opaque);
+	/* optional title: any non-newline sequence enclosed in '"()
+					alone on its line */
+	title_offset = title_end = 0;
+	if (i + 1 < end
+	&& (data[i] == '\'' || data[i] == '"' || data[i] == '(')) {
+		i++;
+		title_offset = i;
+		/* looking for EOL */
+		while (i < end && data[i] != '\n' && data[i] != '\r') i++;
+		if (i + 1 < end && data[i] == '\n' && data[i + 1] == '\r')
+			title_end = i + 1;
+		else	title_end = i;
+		/* stepping back */
+		i -= 1;
+		while (i > title_offset && data[i] == ' ')
+			i -= 1;
+		if (i > title_offset
+		&& (data[i] == '\'' || data[i] == '"' || data[i] == ')')) {
+			line_end = title_end;
+			title_end = i; } }
+
+	if (!line_end || link_end == link_offset)
+		return 0; /* garbage after the link empty link */
+
+	/* a valid ref has been found, filling-in return structures */
+	if (last)
+		*last = line_end;
+
+	if (refs) {
+		struct link_ref *ref;
+
+		ref = add_link_ref(refs, data + id_offset, id_end - id_offset);
+		if (!ref)
+			return 0;
+
+		ref->link = sd_bufnew(link_end - link_offset);
+		sd_bufput(ref->link, data + link_offset, link_end - link_offset);
+
+		if (title_end > title_offset) {
+			ref->title = sd_bufnew(title_end - title_offset);
+			sd_bufput(ref->title, data + title_offset, title_end - title_offset);
+		}
 	}
 
-	rndr_popbuf(rndr, BUFFER_SPAN);
-	return link_len;
+	return 1;
 }
 
-/* char_link • '[': parsing a link or an image */
-static size_t
-char_link(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
+static void expand_tabs(struct sd_buf *ob, const uint8_t *line, size_t size)
 {
-	int is_img = (offset && data[-1] == '!'), level;
-	size_t i = 1, txt_e, link_b = 0, link_e = 0, title_b = 0, title_e = 0;
-	struct sd_buf *content = 0;
-	struct sd_buf *link = 0;
-	struct sd_buf *title = 0;
-	struct sd_buf *u_link = 0;
-	size_t org_work_size = rndr->work_bufs[BUFFER_SPAN].size;
-	int text_has_nl = 0, ret = 0;
-	int in_title = 0, qtype = 0;
+	size_t  i = 0, tab = 0;
 
-	/* checking whether the correct renderer exists */
-	if ((is_img && !rndr->cb.image) || (!is_img && !rndr->cb.link))
-		goto cleanup;
+	while (i < size) {
+		size_t org = i;
 
-	/* looking for the matching closing bracket */
-	for (level = 1; i < size; i++) {
-		if (data[i] == '\n')
-			text_has_nl = 1;
+		while (i < size && line[i] != '\t') {
+			i++; tab++;
+		}
 
-		else if (data[i - 1] == '\\')
-			continue;
+		if (i > org)
+			sd_bufput(ob, line + org, i - org);
 
-		else if (data[i] == '[')
-			level++;
+		if (i >= size)
+			break;
 
-		else if (data[i] == ']') {
-			level--;
-			if (level <= 0)
-				break;
-		}
+		do {
+			sd_bufputc(ob, ' '); tab++;
+		} while (tab % 4);
+
+		i++;
 	}
+}
 
-	if (i >= size)
-		goto cleanup;
+/**************
+ * PLAIN TEXT *
+ **************/
 
-	txt_e = i;
-	i++;
+/* is_plain_text • whether a document is nothing but plain paragraphs */
+/*	no line may open a block or be a reference, no char may start an
+ *	inline construct, and the text must not need tab expansion or
+ *	newline folding; anything doubtful sends the document to the parser */
+static int
+is_plain_text(struct sd_markdown *md, const uint8_t *data, size_t size)
+{
+	size_t i = 0;
 
-	/* skip any amount of whitespace or newline */
-	/* (this is much more laxist than original markdown syntax) */
-	while (i < size && _isspace(data[i]))
-		i++;
+	while (i < size) {
+		size_t indent = 0;
 
-	/* inline style link */
-	if (i < size && data[i] == '(') {
-		/* skipping initial whitespace */
-		i++;
+		/* the start of a line can only be a paragraph's */
+		while (i < size && data[i] == ' ') {
+			i++; indent++;
+		}
 
-		while (i < size && _isspace(data[i]))
-			i++;
+		if (i < size && data[i] != '\n' &&
+			(indent >= 4 || block_starts(data[i], indent) != 0))
+			return 0;
 
-		link_b = i;
+		/* the rest of the line, a class scan to each char worth a look */
+		for (; i < size; ++i) {
+			uint8_t c;
 
-		/* looking for link end: ' " ) */
-		while (i < size) {
-			if (data[i] == '\\') i += 2;
-			else if (data[i] == ')') break;
-			else if (i >= 1 && _isspace(data[i-1]) && (data[i] == '\'' || data[i] == '"')) break;
-			else i++;
-		}
+			if ((i = class_scan(&md->plain_class, data, i, size)) >= size)
+				break;
 
-		if (i >= size) goto cleanup;
-		link_e = i;
+			c = data[i];
 
-		/* looking for title end if present */
-		if (data[i] == '\'' || data[i] == '"') {
-			qtype = data[i];
-			in_title = 1;
-			i++;
-			title_b = i;
+			if (c == '\n') {
+				if (md->active_char['\n'] && i >= 2 && data[i - 1] == ' ' && data[i - 2] == ' ')
+					return 0;
 
-			while (i < size) {
-				if (data[i] == '\\') i += 2;
-				else if (data[i] == qtype) {in_title = 0; i++;}
-				else if ((data[i] == ')') && !in_title) break;
-				else i++;
+				i++;
+				break;
 			}
 
-			if (i >= size) goto cleanup;
+			/* the autolink triggers, unless they can't start a link */
+			if (c == ':' && !(i + 2 < size && data[i + 1] == '/' && data[i + 2] == '/'))
+				continue;
 
-			/* skipping whitespaces after title */
-			title_e = i - 1;
-			while (title_e > title_b && _isspace(data[title_e]))
-				title_e--;
+			if (c == '@' && !(i + 1 < size && autolink_is(data[i + 1], AUTOLINK_EMAIL)))
+				continue;
 
-			/* checking for closing quote presence */
-			if (data[title_e] != '\'' &&  data[title_e] != '"') {
-				title_b = title_e = 0;
-				link_e = i;
-			}
+			if (c == 'w' && !(i + 3 < size && data[i + 1] == 'w' && data[i + 2] == 'w' && data[i + 3] == '.'))
+				continue;
+
+			return 0;
 		}
+	}
 
-		/* remove whitespace at the end of the link */
-		while (link_e > link_b && _isspace(data[link_e - 1]))
-			link_e--;
+	return 1;
+}
 
-		/* remove optional angle brackets around the link */
-		if (data[link_b] == '<') link_b++;
-		if (data[link_e - 1] == '>') link_e--;
+/* plain_paragraph • renders a paragraph of plain text */
+/*	the same callbacks the parser would make for it */
+static void
+plain_paragraph(struct sd_buf *ob, struct sd_markdown *md, const uint8_t *data, size_t size)
+{
+	struct sd_buf text = { 0, 0, 0, 0 };
+	struct sd_buf *tmp = rndr_newbuf(md, BUFFER_BLOCK);
 
-		/* building escaped link and title */
-		if (link_e > link_b) {
-			link = rndr_newbuf(rndr, BUFFER_SPAN);
-			sd_bufput(link, data + link_b, link_e - link_b);
-		}
+	text.data = (uint8_t *)data;
+	text.size = size;
 
-		if (title_e > title_b) {
-			title = rndr_newbuf(rndr, BUFFER_SPAN);
-			sd_bufput(title, data + title_b, title_e - title_b);
-		}
+	if (md->cb.normal_text)
+		CB_NORMAL_TEXT(md, tmp, &text);
+	else
+		sd_bufput(tmp, text.data, text.size);
 
-		i++;
-	}
+	if (md->cb.paragraph)
+		CB_PARAGRAPH(md, ob, tmp);
 
-	/* reference style link */
-	else if (i < size && data[i] == '[') {
-		struct sd_buf id = { 0, 0, 0, 0 };
-		struct link_ref *lr;
+	rndr_popbuf(md, BUFFER_BLOCK);
+}
 
-		/* looking for the id */
-		i++;
-		link_b = i;
-		while (i < size && data[i] != ']') i++;
-		if (i >= size) goto cleanup;
-		link_e = i;
+/* render_plain • renders a document vetted by is_plain_text */
+/*	each run of non-blank lines is a paragraph */
+static void
+render_plain(struct sd_buf *ob, struct sd_markdown *md, const uint8_t *data, size_t size)
+{
+	size_t beg = 0, start = 0, stop = 0;
+	int in_para = 0;
 
-		/* finding the link_ref */
-		if (link_b == link_e) {
-			if (text_has_nl) {
-				struct sd_buf *b = rndr_newbuf(rndr, BUFFER_SPAN);
-				size_t j;
+	while (beg < size) {
+		const uint8_t *nl = (const uint8_t *)memchr(data + beg, '\n', size - beg);
+		size_t end = nl ? (size_t)(nl - data) : size;
+		size_t i = beg;
 
-				for (j = 1; j < txt_e; j++) {
-					if (data[j] != '\n')
-						sd_bufputc(b, data[j]);
-					else if (data[j - 1] != ' ')
-						sd_bufputc(b, ' ');
-				}
+		while (i < end && data[i] == ' ')
+			i++;
 
-				id.data = b->data;
-				id.size = b->size;
-			} else {
-				id.data = data + 1;
-				id.size = txt_e - 1;
-			}
-		} else {
-			id.data = data + link_b;
-			id.size = link_e - link_b;
+		if (i < end) {
+			if (!in_para)
+				start = beg;
+
+			in_para = 1;
+			stop = end;
 		}
 
-		lr = find_link_ref(rndr->refs, id.data, id.size);
-		if (!lr)
-			goto cleanup;
+		else if (in_para) {
+			plain_paragraph(ob, md, data + start, stop - start);
+			in_para = 0;
+		}
 
-		/* keeping link and title from link_ref */
-		link = lr->link;
-		title = lr->title;
-		i++;
+		beg = end + 1;
 	}
 
-	/* shortcut reference style link */
-	else {
-		struct sd_buf id = { 0, 0, 0, 0 };
-		struct link_ref *lr;
+	if (in_para)
+		plain_paragraph(ob, md, data + start, stop - start);
+}
 
-		/* crafting the id */
-		if (text_has_nl) {
-			struct sd_buf *b = rndr_newbuf(rndr, BUFFER_SPAN);
-			size_t j;
 
-			for (j = 1; j < txt_e; j++) {
-				if (data[j] != '\n')
-					sd_bufputc(b, data[j]);
-				else if (data[j - 1] != ' ')
-					sd_bufputc(b, ' ');
-			}
+/**********************
+ * EXPORTED FUNCTIONS *
+ **********************/
 
-			id.data = b->data;
-			id.size = b->size;
-		} else {
-			id.data = data + 1;
-			id.size = txt_e - 1;
-		}
+struct sd_markdown *
+sd_markdown_new(
+	unsigned int extensions,
+	size_t max_nesting,
+	const struct sd_callbacks *callbacks,
+	void *opaque)
+{
+	struct sd_markdown *md = NULL;
+	size_t i;
 
-		/* finding the link_ref */
-		lr = find_link_ref(rndr->refs, id.data, id.size);
-		if (!lr)
-			goto cleanup;
+	assert(max_nesting > 0 && callbacks);
 
-		/* keeping link and title from link_ref */
-		link = lr->link;
-		title = lr->title;
+	md = (struct sd_markdown *)malloc(sizeof(struct sd_markdown));
+	if (!md)
+		return NULL;
 
-		/* rewinding the whitespace */
-		i = txt_e + 1;
-	}
+	memcpy(&md->cb, callbacks, sizeof(struct sd_callbacks));
 
-	/* building content: img alt is escaped, link content is parsed */
-	if (txt_e > 1) {
-		content = rndr_newbuf(rndr, BUFFER_SPAN);
-		if (is_img) {
-			sd_bufput(content, data + 1, txt_e - 1);
-		} else {
-			/* disable autolinking when parsing inline the
-			 * content of a link */
-			rndr->in_link_body = 1;
-			parse_inline(content, rndr, data + 1, txt_e - 1);
-			rndr->in_link_body = 0;
-		}
-	}
+	stack_init(&md->work_bufs[BUFFER_BLOCK], 4);
+	stack_init(&md->work_bufs[BUFFER_SPAN], 8);
+	stack_init(&md->line_bufs, 4);
+	memset(&md->block_frames, 0x0, sizeof(struct frame_array));
+	md->line_text = sd_bufnew(256);
+	memset(&md->html_closes, 0x0, sizeof(struct html_close_index));
+	md->table_cols = NULL;
+	md->table_cols_asize = 0;
 
-	if (link) {
-		u_link = rndr_newbuf(rndr, BUFFER_SPAN);
-		unscape_text(u_link, link);
+	memset(md->active_char, 0x0, 256);
+
+	if (md->cb.emphasis || md->cb.double_emphasis || md->cb.triple_emphasis) {
+		md->active_char['*'] = MD_CHAR_EMPHASIS;
+		md->active_char['_'] = MD_CHAR_EMPHASIS;
+		if (extensions & MKDEXT_STRIKETHROUGH)
+			md->active_char['~'] = MD_CHAR_EMPHASIS;
 	}
 
-	/* calling the relevant rendering function */
-	if (is_img) {
-		if (ob->size && ob->data[ob->size - 1] == '!')
-			ob->size -= 1;
+	if (md->cb.codespan)
+		md->active_char['`'] = MD_CHAR_CODESPAN;
 
-		ret = rndr->cb.image(ob, u_link, title, content, rndr->opaque);
-	} else {
-		ret = rndr->cb.link(ob, u_link, title, content, rndr->opaque);
-	}
+	if (md->cb.linebreak)
+		md->active_char['\n'] = MD_CHAR_LINEBREAK;
 
-	/* cleanup */
-cleanup:
-	rndr->work_bufs[BUFFER_SPAN].size = (int)org_work_size;
-	return ret ? i : 0;
-}
+	if (md->cb.image || md->cb.link)
+		md->active_char['['] = MD_CHAR_LINK;
 
-static size_t
-char_superscript(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t offset, size_t size)
-{
-	size_t sup_start, sup_len;
-	struct sd_buf *sup;
+	md->active_char['<'] = MD_CHAR_LANGLE;
+	md->active_char['\\'] = MD_CHAR_ESCAPE;
+	md->active_char['&'] = MD_CHAR_ENTITITY;
 
-	if (!rndr->cb.superscript)
-		return 0;
+	if (extensions & MKDEXT_AUTOLINK) {
+		md->active_char[':'] = MD_CHAR_AUTOLINK_URL;
+		md->active_char['@'] = MD_CHAR_AUTOLINK_EMAIL;
+		md->active_char['w'] = MD_CHAR_AUTOLINK_WWW;
+	}
 
-	if (size < 2)
-		return 0;
+	if (extensions & MKDEXT_SUPERSCRIPT)
+		md->active_char['^'] = MD_CHAR_SUPERSCRIPT;
 
-	if (data[1] == '(') {
-		sup_start = sup_len = 2;
+	byte_class_init(&md->active_class, (const char *)md->active_char, 0);
 
-		while (sup_len < size && data[sup_len] != ')' && data[sup_len - 1] != '\\')
-			sup_len++;
+	for (i = 0; i < 256; ++i)
+		md->plain_stop[i] = md->active_char[i] != 0;
 
-		if (sup_len == size)
-			return 0;
-	} else {
-		sup_start = sup_len = 1;
+	md->plain_stop['\n'] = 1;
+	md->plain_stop['\r'] = 1;
+	md->plain_stop['\t'] = 1;
+	md->plain_stop['['] = 1; /* references */
 
-		while (sup_len < size && !_isspace(data[sup_len]))
-			sup_len++;
-	}
+	if (extensions & MKDEXT_TABLES)
+		md->plain_stop['|'] = 1;
 
-	if (sup_len - sup_start == 0)
-		return (sup_start == 2) ? 3 : 0;
+	byte_class_init(&md->plain_class, (const char *)md->plain_stop, 0);
 
-	sup = rndr_newbuf(rndr, BUFFER_SPAN);
-	parse_inline(sup, rndr, data + sup_start, sup_len - sup_start);
-	rndr->cb.superscript(ob, sup, rndr->opaque);
-	rndr_popbuf(rndr, BUFFER_SPAN);
+	/* Extension data */
+	md->ext_flags = extensions;
+	md->opaque = opaque;
+	md->max_nesting = max_nesting;
+	md->through_nesting = 0;
+	md->in_link_body = 0;
+	memset(&md->pending_text, 0x0, sizeof(struct sd_buf));
+	md->pending_ob = NULL;
+	md->fans = NULL;
+	md->nfans = 0;
+	stack_init(&md->fan_obs, 4);
+	memset(&md->frag, 0x0, sizeof(struct frag_block));
 
-	return (sup_start == 2) ? sup_len + 1 : sup_len;
+	return md;
 }
 
-/*********************************
- * BLOCK-LEVEL PARSING FUNCTIONS *
- *********************************/
+void
+sd_markdown_render(struct sd_buf *ob, const uint8_t *document, size_t doc_size, struct sd_markdown *md)
+{
+	sd_markdown_render_fanout(ob, document, doc_size, md, NULL, 0);
+}
 
-/* is_empty • returns the line length when it is empty, 0 otherwise */
-static size_t
-is_empty(uint8_t *data, size_t size)
+/* sd_markdown_render_fanout • renders a document with md and every fan */
+/*	md finds the blocks and the link references; each block is then
+ *	rendered by md and by the fans, each with its own callbacks, into
+ *	its own output buffer */
+void
+sd_markdown_render_fanout(struct sd_buf *ob, const uint8_t *document, size_t doc_size,
+	struct sd_markdown *md, const struct sd_fanout *fans, size_t nfans)
 {
-	size_t i;
+#define MARKDOWN_GROW(x) ((x) + ((x) >> 1))
+	static const uint8_t UTF8_BOM[] = {0xEF, 0xBB, 0xBF};
 
-	for (i = 0; i < size && data[i] != '\n'; i++)
-		if (data[i] != ' ')
-			return 0;
+	struct sd_buf *text;
+	struct line_array *lines;
+	size_t beg, end, k;
+	int plain;
 
-	return i + 1;
-}
+	beg = 0;
 
-/* is_hrule • returns whether a line is a horizontal rule */
-static int
-is_hrule(uint8_t *data, size_t size)
-{
-	size_t i = 0, n = 0;
-	uint8_t c;
+	/* Skip a possible UTF-8 BOM, even though the Unicode standard
+	 * discourages having these in UTF-8 documents */
+	if (doc_size >= 3 && memcmp(document, UTF8_BOM, 3) == 0)
+		beg += 3;
 
-	/* skipping initial spaces */
-	if (size < 3) return 0;
-	if (data[0] == ' ') { i++;
-	if (data[1] == ' ') { i++;
-	if (data[2] == ' ') { i++; } } }
+	/* plain paragraphs go straight to the callbacks, when they are
+	 * plain to every parser */
+	plain = is_plain_text(md, document + beg, doc_size - beg);
+	for (k = 0; plain && k < nfans; ++k)
+		plain = is_plain_text(fans[k].md, document + beg, doc_size - beg);
 
-	/* looking at the hrule uint8_t */
-	if (i + 2 >= size
-	|| (data[i] != '*' && data[i] != '-' && data[i] != '_'))
-		return 0;
-	c = data[i];
+	if (plain) {
+		sd_bufgrow(ob, MARKDOWN_GROW(doc_size - beg));
 
-	/* the whole line must be the char or whitespace */
-	while (i < size && data[i] != '\n') {
-		if (data[i] == c) n++;
-		else if (data[i] != ' ')
-			return 0;
+		for (k = 0; k <= nfans; ++k) {
+			struct sd_markdown *rndr = k ? fans[k - 1].md : md;
+			struct sd_buf *out = k ? fans[k - 1].ob : ob;
+
+			if (rndr->cb.doc_header)
+				CB_DOC_HEADER(rndr, out);
+
+			/* a plain document is nothing but paragraphs */
+			if (rndr->cb.paragraph)
+				render_plain(out, rndr, document + beg, doc_size - beg);
 
-		i++;
+			if (rndr->cb.doc_footer)
+				CB_DOC_FOOTER(rndr, out);
+		}
+
+		return;
 	}
 
-	return n >= 3;
-}
+	text = sd_bufnew(64);
+	if (!text)
+		return;
 
-/* check if a line begins with a code fence; return the
- * width of the code fence */
-static size_t
-prefix_codefence(uint8_t *data, size_t size)
-{
-	size_t i = 0, n = 0;
-	uint8_t c;
+	/* Preallocate enough space for our buffer to avoid expanding while copying */
+	sd_bufgrow(text, doc_size);
 
-	/* skipping initial spaces */
-	if (size < 3) return 0;
-	if (data[0] == ' ') { i++;
-	if (data[1] == ' ') { i++;
-	if (data[2] == ' ') { i++; } } }
+	/* reset the references table */
+	memset(&md->refs, 0x0, REF_TABLE_SIZE * sizeof(void *));
 
-	/* looking at the hrule uint8_t */
-	if (i + 2 >= size || !(data[i] == '~' || data[i] == '`'))
-		return 0;
+	/* first pass: looking for references, copying everything else */
+	while (beg < doc_size) /* iterating over lines */
+		if (is_ref(document, beg, doc_size, &end, md->refs))
+			beg = end;
+		else { /* skipping to the next line */
+			end = beg;
+			while (end < doc_size && document[end] != '\n' && document[end] != '\r')
+				end++;
 
-	c = data[i];
+			/* adding the line body if present */
+			if (end > beg)
+				expand_tabs(text, document + beg, end - beg);
 
-	/* the whole line must be the uint8_t or whitespace */
-	while (i < size && data[i] == c) {
-		n++; i++;
-	}
+			while (end < doc_size && (document[end] == '\n' || document[end] == '\r')) {
+				/* add one \n per newline */
+				if (document[end] == '\n' || (end + 1 < doc_size && document[end + 1] != '\n'))
+					sd_bufputc(text, '\n');
+				end++;
+			}
 
-	if (n < 3)
-		return 0;
+			beg = end;
+		}
 
-	return i;
-}
+	/* pre-grow the output buffer to minimize allocations */
+	sd_bufgrow(ob, MARKDOWN_GROW(text->size));
 
-/* check if a line is a code fence; return its size if it is */
-static size_t
-is_codefence(uint8_t *data, size_t size, struct sd_buf *syntax)
-{
-	size_t i = 0, syn_len = 0;
-	uint8_t *syn_start;
+	/* the fans resolve links against the references found here */
+	md->fans = fans;
+	md->nfans = nfans;
 
-	i = prefix_codefence(data, size);
-	if (i == 0)
-		return 0;
+	for (k = 0; k < nfans; ++k) {
+		struct sd_markdown *fan = fans[k].md;
 
-	while (i < size && data[i] == ' ')
-		i++;
+		assert(fan != md && fan->fan_obs.size == 0);
 
-	syn_start = data + i;
+		memcpy(fan->refs, md->refs, REF_TABLE_SIZE * sizeof(void *));
+		stack_push(&fan->fan_obs, fans[k].ob);
+	}
 
-	if (i < size && data[i] == '{') {
-		i++; syn_start++;
+	/* second pass: actual rendering */
+	if (md->cb.doc_header)
+		CB_DOC_HEADER(md, ob);
 
-		while (i < size && data[i] != '}' && data[i] != '\n') {
-			syn_len++; i++;
-		}
+	for (k = 0; k < nfans; ++k)
+		if (fans[k].md->cb.doc_header)
+			CB_DOC_HEADER(fans[k].md, fans[k].ob);
 
-		if (i == size || data[i] != '}')
-			return 0;
+	if (text->size) {
+		/* adding a final newline if not already present */
+		if (text->data[text->size - 1] != '\n' &&  text->data[text->size - 1] != '\r')
+			sd_bufputc(text, '\n');
 
-		/* strip all whitespace at the beginning and the end
-		 * of the {} block */
-		while (syn_len > 0 && _isspace(syn_start[0])) {
-			syn_start++; syn_len--;
+		/* the closing tag index is built on demand */
+		md->html_closes.text = text->data;
+		md->html_closes.text_size = text->size;
+		md->html_closes.built = 0;
+
+		for (k = 0; k < nfans; ++k) {
+			fans[k].md->html_closes.text = text->data;
+			fans[k].md->html_closes.text_size = text->size;
+			fans[k].md->html_closes.built = 0;
 		}
 
-		while (syn_len > 0 && _isspace(syn_start[syn_len - 1]))
-			syn_len--;
+		/* indexing the lines once for the whole block parser */
+		lines = rndr_newlines(md);
+		beg = 0;
+		while (beg < text->size) {
+			uint8_t *nl = (uint8_t *)memchr(text->data + beg, '\n', text->size - beg);
 
-		i++;
-	} else {
-		while (i < size && !_isspace(data[i])) {
-			syn_len++; i++;
+			end = (size_t)(nl - text->data) + 1;
+			lines_add(lines, text->data + beg, end - beg);
+			beg = end;
 		}
-	}
 
-	if (syntax) {
-		syntax->data = syn_start;
-		syntax->size = syn_len;
+		parse_block(ob, md, lines->item, lines->size);
+		rndr_poplines(md);
 	}
 
-	while (i < size && data[i] != '\n') {
-		if (!_isspace(data[i]))
-			return 0;
+	if (md->cb.doc_footer)
+		CB_DOC_FOOTER(md, ob);
 
-		i++;
+	for (k = 0; k < nfans; ++k) {
+		struct sd_markdown *fan = fans[k].md;
+
+		if (fan->cb.doc_footer)
+			CB_DOC_FOOTER(fan, fans[k].ob);
+
+		memset(fan->refs, 0x0, REF_TABLE_SIZE * sizeof(void *));
+		stack_pop(&fan->fan_obs);
+
+		assert(fan->work_bufs[BUFFER_SPAN].size == 0);
+		assert(fan->work_bufs[BUFFER_BLOCK].size == 0);
+		assert(fan->through_nesting == 0);
 	}
 
-	return i + 1;
+	md->fans = NULL;
+	md->nfans = 0;
+
+	/* clean-up */
+	sd_bufrelease(text);
+	free_link_refs(md->refs);
+
+	assert(md->work_bufs[BUFFER_SPAN].size == 0);
+	assert(md->work_bufs[BUFFER_BLOCK].size == 0);
+	assert(md->line_bufs.size == 0);
+	assert(md->block_frames.size == 0);
 }
 
-/* is_atxheader • returns whether the line is a hash-prefixed header */
-static int
-is_atxheader(struct sd_markdown *rndr, uint8_t *data, size_t size)
+void
+sd_markdown_free(struct sd_markdown *md)
 {
-	if (data[0] != '#')
-		return 0;
+	size_t i;
 
-	if (rndr->ext_flags & MKDEXT_SPACE_HEADERS) {
-		size_t level = 0;
+	for (i = 0; i < (size_t)md->work_bufs[BUFFER_SPAN].asize; ++i)
+		sd_bufrelease((struct sd_buf *)md->work_bufs[BUFFER_SPAN].item[i]);
 
-		while (level < size && level < 6 && data[level] == '#')
-			level++;
+	for (i = 0; i < (size_t)md->work_bufs[BUFFER_BLOCK].asize; ++i)
+		sd_bufrelease((struct sd_buf *)md->work_bufs[BUFFER_BLOCK].item[i]);
 
-		if (level < size && data[level] != ' ')
-			return 0;
+	for (i = 0; i < (size_t)md->line_bufs.asize; ++i) {
+		struct line_array *lines = (struct line_array *)md->line_bufs.item[i];
+
+		if (lines) {
+			free(lines->item);
+			free(lines);
+		}
 	}
 
-	return 1;
+	stack_free(&md->work_bufs[BUFFER_SPAN]);
+	stack_free(&md->work_bufs[BUFFER_BLOCK]);
+	stack_free(&md->line_bufs);
+	stack_free(&md->fan_obs);
+	free(md->frag.ids);
+	free(md->block_frames.item);
+	sd_bufrelease(md->line_text);
+	free(md->html_closes.item);
+	free(md->table_cols);
+
+	free(md);
 }
 
-/* is_headerline • returns whether the line is a setext-style hdr underline */
-static int
-is_headerline(uint8_t *data, size_t size)
+void
+sd_version(int *ver_major, int *ver_minor, int *ver_revision)
 {
-	size_t i = 0;
-
-	/* test of level 1 header */
-	if (data[i] == '=') {
-		for (i = 1; i < size && data[i] == '='; i++);
-		while (i < size && data[i] == ' ') i++;
-		return (i >= size || data[i] == '\n') ? 1 : 0; }
+	*ver_major = SUNDOWN_VER_MAJOR;
+	*ver_minor = SUNDOWN_VER_MINOR;
+	*ver_revision = SUNDOWN_VER_REVISION;
+}
 
-	/* test of level 2 header */
-	if (data[i] == '-') {
-		for (i = 1; i < size && data[i] == '-'; i++);
-		while (i < size && data[i] == ' ') i++;
-		return (i >= size || data[i] == '\n') ? 2 : 0; }
+// ENDREGION: MARKDOWN.C
 
-	return 0;
-}
+// REGION: STACK.C
 
-static int
-is_next_headerline(uint8_t *data, size_t size)
+int
+stack_grow(struct stack *st, size_t new_size)
 {
-	size_t i = 0;
-
-	while (i < size && data[i] != '\n')
-		i++;
+	void **new_st;
 
-	if (++i >= size)
+	if (st->asize >= new_size)
 		return 0;
 
-	return is_headerline(data + i, size - i);
-}
+	new_st = (void **)realloc(st->item, new_size * sizeof(void *));
+	if (new_st == NULL)
+		return -1;
 
-/* prefix_quote • returns blockquote prefix length */
-static size_t
-prefix_quote(uint8_t *data, size_t size)
-{
-	size_t i = 0;
-	if (i < size && data[i] == ' ') i++;
-	if (i < size && data[i] == ' ') i++;
-	if (i < size && data[i] == ' ') i++;
+	memset(new_st + st->asize, 0x0,
+		(new_size - st->asize) * sizeof(void *));
 
-	if (i < size && data[i] == '>') {
-		if (i + 1 < size && data[i + 1] == ' ')
-			return i + 2;
+	st->item = new_st;
+	st->asize = new_size;
 
-		return i + 1;
-	}
+	if (st->size > new_size)
+		st->size = new_size;
 
 	return 0;
 }
 
-/* prefix_code • returns prefix length for block code*/
-static size_t
-prefix_code(uint8_t *data, size_t size)
+void
+stack_free(struct stack *st)
 {
-	if (size > 3 && data[0] == ' ' && data[1] == ' '
-		&& data[2] == ' ' && data[3] == ' ') return 4;
+	if (!st)
+		return;
 
-	return 0;
+	free(st->item);
+
+	st->item = NULL;
+	st->size = 0;
+	st->asize = 0;
 }
 
-/* prefix_oli • returns ordered list item prefix */
-static size_t
-prefix_oli(uint8_t *data, size_t size)
+int
+stack_init(struct stack *st, size_t initial_size)
 {
-	size_t i = 0;
-
-	if (i < size && data[i] == ' ') i++;
-	if (i < size && data[i] == ' ') i++;
-	if (i < size && data[i] == ' ') i++;
-
-	if (i >= size || data[i] < '0' || data[i] > '9')
-		return 0;
-
-	while (i < size && data[i] >= '0' && data[i] <= '9')
-		i++;
-
-	if (i + 1 >= size || data[i] != '.' || data[i + 1] != ' ')
-		return 0;
+	st->item = NULL;
+	st->size = 0;
+	st->asize = 0;
 
-	if (is_next_headerline(data + i, size - i))
-		return 0;
+	if (!initial_size)
+		initial_size = 8;
 
-	return i + 2;
+	return stack_grow(st, initial_size);
 }
 
-/* prefix_uli • returns ordered list item prefix */
-static size_t
-prefix_uli(uint8_t *data, size_t size)
+void *
+stack_pop(struct stack *st)
 {
-	size_t i = 0;
-
-	if (i < size && data[i] == ' ') i++;
-	if (i < size && data[i] == ' ') i++;
-	if (i < size && data[i] == ' ') i++;
-
-	if (i + 1 >= size ||
-		(data[i] != '*' && data[i] != '+' && data[i] != '-') ||
-		data[i + 1] != ' ')
-		return 0;
-
-	if (is_next_headerline(data + i, size - i))
-		return 0;
+	if (!st->size)
+		return NULL;
 
-	return i + 2;
+	return st->item[--st->size];
 }
 
+int
+stack_push(struct stack *st, void *item)
+{
+	if (stack_grow(st, st->size * 2) < 0)
+		return -1;
 
-/* parse_block • parsing of one block, returning next uint8_t to parse */
-static void parse_block(struct sd_buf *ob, struct sd_markdown *rndr,
-			uint8_t *data, size_t size);
-
+	st->item[st->size++] = item;
+	return 0;
+}
 
-/* parse_blockquote • handles parsing of a blockquote fragment */
-static size_t
-parse_blockquote(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+void *
+stack_top(struct stack *st)
 {
-	size_t beg, end = 0, pre, work_size = 0;
-	uint8_t *work_data = 0;
-	struct sd_buf *out = 0;
+	if (!st->size)
+		return NULL;
 
-	out = rndr_newbuf(rndr, BUFFER_BLOCK);
-	beg = 0;
-	while (beg < size) {
-		for (end = beg + 1; end < size && data[end - 1] != '\n'; end++);
+	return st->item[st->size - 1];
+}
 
-		pre = prefix_quote(data + beg, end - beg);
+// ENDREGION: STACK.C
 
-		if (pre)
-			beg += pre; /* skipping prefix */
+// REGION: CACHE.C
 
-		/* empty line followed by non-quote line */
-		else if (is_empty(data + beg, end - beg) &&
-				(end >= size || (prefix_quote(data + end, size - end) == 0 &&
-				!is_empty(data + end, size - end))))
-			break;
+#ifndef SD_NO_CACHE
 
-		if (beg < end) { /* copy into the in-place working buffer */
-			/* sd_bufput(work, data + beg, end - beg); */
-			if (!work_data)
-				work_data = data + beg;
-			else if (data + beg != work_data + work_size)
-				memmove(work_data + work_size, data + beg, end - beg);
-			work_size += end - beg;
-		}
-		beg = end;
-	}
+#ifndef SD_CACHE_STRIPES
+#define SD_CACHE_STRIPES 16
+#endif
 
-	parse_block(out, rndr, work_data, work_size);
-	if (rndr->cb.blockquote)
-		rndr->cb.blockquote(ob, out, rndr->opaque);
-	rndr_popbuf(rndr, BUFFER_BLOCK);
-	return end;
-}
+/* a waiting thread tells the CPU it is spinning between tries, and on
+ * POSIX systems gives its time slice away now and then, in case the
+ * holder of the lock was preempted */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SD_CACHE_PAUSE() __builtin_ia32_pause()
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define SD_CACHE_PAUSE() __asm__ __volatile__("yield")
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SD_CACHE_PAUSE() _mm_pause()
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+#include <intrin.h>
+#define SD_CACHE_PAUSE() __yield()
+#else
+#define SD_CACHE_PAUSE() ((void)0)
+#endif
 
-static size_t
-parse_htmlblock(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, int do_render);
+#if defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#define SD_CACHE_YIELD() sched_yield()
+#else
+#define SD_CACHE_YIELD() SD_CACHE_PAUSE()
+#endif
 
-/* parse_blockquote • handles parsing of a regular paragraph */
-static size_t
-parse_paragraph(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+/* cache_spin • one wait on a held stripe lock */
+static inline void
+cache_spin(unsigned int *spins)
 {
-	size_t i = 0, end = 0;
-	int level = 0;
-	struct sd_buf work = {0};
-    work.data = data;
-
-	while (i < size) {
-		for (end = i + 1; end < size && data[end - 1] != '\n'; end++) /* empty */;
-
-		if (is_empty(data + i, size - i))
-			break;
-
-		if ((level = is_headerline(data + i, size - i)) != 0)
-			break;
+	if (++*spins % 64)
+		SD_CACHE_PAUSE();
+	else
+		SD_CACHE_YIELD();
+}
 
-		if (is_atxheader(rndr, data + i, size - i) ||
-			is_hrule(data + i, size - i) ||
-			prefix_quote(data + i, size - i)) {
-			end = i;
-			break;
-		}
+/* the stripe locks, on a volatile long, or a C11 atomic_flag; they are
+ * only held to look an entry up or link it in, never while rendering or
+ * copying output */
+#if defined(SD_CACHE_LOCK) || defined(__GNUC__) || defined(_MSC_VER)
+typedef volatile long cache_lock;
+#else
+#include <stdatomic.h>
+typedef atomic_flag cache_lock;
+#endif
 
-		/*
-		 * Early termination of a paragraph with the same logic
-		 * as Markdown 1.0.0. If this logic is applied, the
-		 * Markdown 1.0.3 test suite won't pass cleanly
-		 *
-		 * :: If the first character in a new line is not a letter,
-		 * let's check to see if there's some kind of block starting
-		 * here
-		 */
-		if ((rndr->ext_flags & MKDEXT_LAX_SPACING) && !isalnum(data[i])) {
-			if (prefix_oli(data + i, size - i) ||
-				prefix_uli(data + i, size - i)) {
-				end = i;
-				break;
-			}
+#ifndef SD_CACHE_LOCK
+#if defined(__GNUC__)
+#define SD_CACHE_LOCK(l) do { \
+	unsigned int spins_ = 0; \
+	while (__atomic_exchange_n((l), 1, __ATOMIC_ACQUIRE)) \
+		while (__atomic_load_n((l), __ATOMIC_RELAXED)) \
+			cache_spin(&spins_); \
+} while (0)
+#define SD_CACHE_UNLOCK(l) __atomic_store_n((l), 0, __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define SD_CACHE_LOCK(l) do { \
+	unsigned int spins_ = 0; \
+	while (_InterlockedExchange((l), 1)) \
+		while (*(l)) \
+			cache_spin(&spins_); \
+} while (0)
+#define SD_CACHE_UNLOCK(l) _InterlockedExchange((l), 0)
+#else
+#define SD_CACHE_LOCK(l) do { \
+	unsigned int spins_ = 0; \
+	while (atomic_flag_test_and_set_explicit((l), memory_order_acquire)) \
+		cache_spin(&spins_); \
+} while (0)
+#define SD_CACHE_UNLOCK(l) atomic_flag_clear_explicit((l), memory_order_release)
+#endif
+#endif
 
-			/* see if an html block starts here */
-			if (data[i] == '<' && rndr->cb.blockhtml &&
-				parse_htmlblock(ob, rndr, data + i, size - i, 0)) {
-				end = i;
-				break;
-			}
+/* cache_entry • a rendered document, in its stripe's table and LRU list */
+struct cache_entry {
+	uint64_t key[2];
+	size_t doc_size;
+	size_t size;	/* of the output in data */
+	size_t refs;	/* readers copying the output out */
+	int dead;	/* evicted while read, freed by the last reader */
+	struct cache_entry *chain;	/* next in the bucket */
+	struct cache_entry *prev, *next;	/* most recently used first */
+	uint8_t data[1];	/* size bytes, allocated past the end */
+};
 
-			/* see if a code fence starts here */
-			if ((rndr->ext_flags & MKDEXT_FENCED_CODE) != 0 &&
-				is_codefence(data + i, size - i, NULL) != 0) {
-				end = i;
-				break;
-			}
-		}
+/* CACHE_ENTRY_SIZE • bytes of an entry holding n bytes of output */
+#define CACHE_ENTRY_SIZE(n) (offsetof(struct cache_entry, data) + (n))
+
+/* cache_stripe • a share of the cache, with a lock and budget of its own */
+struct cache_stripe {
+	cache_lock lock;
+	struct cache_entry **buckets;
+	size_t nbuckets;
+	size_t entries;
+	size_t bytes;
+	size_t max_bytes;
+	struct cache_entry *head, *tail;
+	uint64_t hits, misses, evictions;
+	uint64_t block_hits, block_misses;
+};
 
-		i = end;
-	}
+struct sd_cache {
+	struct cache_stripe stripes[SD_CACHE_STRIPES];
+};
 
-	work.size = i;
-	while (work.size && data[work.size - 1] == '\n')
-		work.size--;
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
 
-	if (!level) {
-		struct sd_buf *tmp = rndr_newbuf(rndr, BUFFER_BLOCK);
-		parse_inline(tmp, rndr, work.data, work.size);
-		if (rndr->cb.paragraph)
-			rndr->cb.paragraph(ob, tmp, rndr->opaque);
-		rndr_popbuf(rndr, BUFFER_BLOCK);
-	} else {
-		struct sd_buf *header_work;
+static inline uint64_t
+fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
 
-		if (work.size) {
-			size_t beg;
-			i = work.size;
-			work.size -= 1;
+/* hash128 • MurmurHash3 x64 128, with both halves seeded */
+/*	a zero-padded tail mixes to the same value as the byte by byte one */
+static void
+hash128(uint64_t out[2], const void *data, size_t size, uint64_t seed)
+{
+	static const uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+	const uint8_t *p = (const uint8_t *)data;
+	uint64_t h1 = seed, h2 = seed, k1, k2;
+	uint8_t tail[16];
+	size_t i;
 
-			while (work.size && data[work.size] != '\n')
-				work.size -= 1;
+	for (i = 0; i + 16 <= size; i += 16) {
+		memcpy(&k1, p + i, 8);
+		memcpy(&k2, p + i + 8, 8);
 
-			beg = work.size + 1;
-			while (work.size && data[work.size - 1] == '\n')
-				work.size -= 1;
+		k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
 
-			if (work.size > 0) {
-				struct sd_buf *tmp = rndr_newbuf(rndr, BUFFER_BLOCK);
-				parse_inline(tmp, rndr, work.data, work.size);
+		k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
 
-				if (rndr->cb.paragraph)
-					rndr->cb.paragraph(ob, tmp, rndr->opaque);
+	memset(tail, 0x0, sizeof(tail));
+	if (size > i)
+		memcpy(tail, p + i, size - i);
+	memcpy(&k1, tail, 8);
+	memcpy(&k2, tail + 8, 8);
 
-				rndr_popbuf(rndr, BUFFER_BLOCK);
-				work.data += beg;
-				work.size = i - beg;
-			}
-			else work.size = i;
-		}
+	k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+	k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
 
-		header_work = rndr_newbuf(rndr, BUFFER_SPAN);
-		parse_inline(header_work, rndr, work.data, work.size);
+	h1 ^= size;
+	h2 ^= size;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
 
-		if (rndr->cb.header)
-			rndr->cb.header(ob, header_work, (int)level, rndr->opaque);
+	out[0] = h1;
+	out[1] = h2;
+}
 
-		rndr_popbuf(rndr, BUFFER_SPAN);
-	}
+/* cache_setup • the hash of the callbacks, extensions and flags of md */
+static uint64_t
+cache_setup(const struct sd_markdown *md, unsigned int render_flags)
+{
+	uint64_t setup[2], flags = (uint64_t)render_flags << 32 | md->ext_flags;
 
-	return end;
+	hash128(setup, &md->cb, sizeof(struct sd_callbacks), flags);
+	return setup[0] ^ fmix64(setup[1] + md->max_nesting);
 }
 
-/* parse_fencedcode • handles parsing of a block-level code fragment */
-static size_t
-parse_fencedcode(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+/* cache_key • the hash of a render: the document, seeded with its setup */
+static void
+cache_key(uint64_t key[2], const uint8_t *document, size_t doc_size,
+	const struct sd_markdown *md, unsigned int render_flags)
 {
-	size_t beg, end;
-	struct sd_buf *work = 0;
-	struct sd_buf lang = { 0, 0, 0, 0 };
+	hash128(key, document, doc_size, cache_setup(md, render_flags));
+}
 
-	beg = is_codefence(data, size, &lang);
-	if (beg == 0) return 0;
+/* cache_find • the entry of a key in a stripe, or NULL */
+static struct cache_entry *
+cache_find(struct cache_stripe *st, const uint64_t key[2], size_t doc_size)
+{
+	struct cache_entry *e;
 
-	work = rndr_newbuf(rndr, BUFFER_BLOCK);
+	if (!st->nbuckets)
+		return NULL;
 
-	while (beg < size) {
-		size_t fence_end;
-		struct sd_buf fence_trail = { 0, 0, 0, 0 };
+	for (e = st->buckets[key[0] & (st->nbuckets - 1)]; e; e = e->chain)
+		if (e->key[0] == key[0] && e->key[1] == key[1] && e->doc_size == doc_size)
+			return e;
 
-		fence_end = is_codefence(data + beg, size - beg, &fence_trail);
-		if (fence_end != 0 && fence_trail.size == 0) {
-			beg += fence_end;
-			break;
-		}
+	return NULL;
+}
 
-		for (end = beg + 1; end < size && data[end - 1] != '\n'; end++);
+static void
+cache_unlink(struct cache_stripe *st, struct cache_entry *e)
+{
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		st->head = e->next;
 
-		if (beg < end) {
-			/* verbatim copy to the working buffer,
-				escaping entities */
-			if (is_empty(data + beg, end - beg))
-				sd_bufputc(work, '\n');
-			else sd_bufput(work, data + beg, end - beg);
-		}
-		beg = end;
-	}
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		st->tail = e->prev;
+}
 
-	if (work->size && work->data[work->size - 1] != '\n')
-		sd_bufputc(work, '\n');
+static void
+cache_push(struct cache_stripe *st, struct cache_entry *e)
+{
+	e->prev = NULL;
+	e->next = st->head;
 
-	if (rndr->cb.blockcode)
-		rndr->cb.blockcode(ob, work, lang.size ? &lang : NULL, rndr->opaque);
+	if (st->head)
+		st->head->prev = e;
+	else
+		st->tail = e;
 
-	rndr_popbuf(rndr, BUFFER_BLOCK);
-	return beg;
+	st->head = e;
 }
 
-static size_t
-parse_blockcode(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+/* cache_insert • links a new entry in, growing the table as it fills */
+static int
+cache_insert(struct cache_stripe *st, struct cache_entry *e)
 {
-	size_t beg, end, pre;
-	struct sd_buf *work = 0;
+	struct cache_entry **slot;
 
-	work = rndr_newbuf(rndr, BUFFER_BLOCK);
+	if (st->entries >= st->nbuckets) {
+		size_t i, n = st->nbuckets ? st->nbuckets * 2 : 64;
+		struct cache_entry **buckets = (struct cache_entry **)calloc(n, sizeof(struct cache_entry *));
 
-	beg = 0;
-	while (beg < size) {
-		for (end = beg + 1; end < size && data[end - 1] != '\n'; end++) {};
-		pre = prefix_code(data + beg, end - beg);
+		if (!buckets)
+			return 0;
 
-		if (pre)
-			beg += pre; /* skipping prefix */
-		else if (!is_empty(data + beg, end - beg))
-			/* non-empty non-prefixed line breaks the pre */
-			break;
+		for (i = 0; i < st->nbuckets; ++i) {
+			struct cache_entry *c = st->buckets[i], *next;
 
-		if (beg < end) {
-			/* verbatim copy to the working buffer,
-				escaping entities */
-			if (is_empty(data + beg, end - beg))
-				sd_bufputc(work, '\n');
-			else sd_bufput(work, data + beg, end - beg);
+			for (; c; c = next) {
+				next = c->chain;
+				c->chain = buckets[c->key[0] & (n - 1)];
+				buckets[c->key[0] & (n - 1)] = c;
+			}
 		}
-		beg = end;
-	}
-
-	while (work->size && work->data[work->size - 1] == '\n')
-		work->size -= 1;
 
-	sd_bufputc(work, '\n');
+		free(st->buckets);
+		st->buckets = buckets;
+		st->nbuckets = n;
+	}
 
-	if (rndr->cb.blockcode)
-		rndr->cb.blockcode(ob, work, NULL, rndr->opaque);
+	slot = &st->buckets[e->key[0] & (st->nbuckets - 1)];
+	e->chain = *slot;
+	*slot = e;
 
-	rndr_popbuf(rndr, BUFFER_BLOCK);
-	return beg;
+	cache_push(st, e);
+	st->entries++;
+	st->bytes += CACHE_ENTRY_SIZE(e->size);
+	return 1;
 }
 
-/* parse_listitem • parsing of a single list item */
-/*	assuming initial prefix is already removed */
-static size_t
-parse_listitem(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, int *flags)
+/* cache_release • unpins an entry read out of the lock */
+static void
+cache_release(struct cache_stripe *st, struct cache_entry *e)
 {
-	struct sd_buf *work = 0, *inter = 0;
-	size_t beg = 0, end, pre, sublist = 0, orgpre = 0, i;
-	int in_empty = 0, has_inside_empty = 0, in_fence = 0;
-
-	/* keeping track of the first indentation prefix */
-	while (orgpre < 3 && orgpre < size && data[orgpre] == ' ')
-		orgpre++;
-
-	beg = prefix_uli(data, size);
-	if (!beg)
-		beg = prefix_oli(data, size);
+	int dead;
 
-	if (!beg)
-		return 0;
+	SD_CACHE_LOCK(&st->lock);
+	dead = --e->refs == 0 && e->dead;
+	SD_CACHE_UNLOCK(&st->lock);
 
-	/* skipping to the beginning of the following line */
-	end = beg;
-	while (end < size && data[end - 1] != '\n')
-		end++;
+	if (dead)
+		free(e);
+}
 
-	/* getting working buffers */
-	work = rndr_newbuf(rndr, BUFFER_SPAN);
-	inter = rndr_newbuf(rndr, BUFFER_SPAN);
+/* cache_evict • drops the least recently used entries over the budget */
+/*	returns those that can be freed, chained through next; entries being
+ *	read are left to their last reader */
+static struct cache_entry *
+cache_evict(struct cache_stripe *st)
+{
+	struct cache_entry *freed = NULL;
 
-	/* putting the first line into the working buffer */
-	sd_bufput(work, data + beg, end - beg);
-	beg = end;
+	while (st->bytes > st->max_bytes && st->tail) {
+		struct cache_entry *e = st->tail, **slot;
 
-	/* process the following lines */
-	while (beg < size) {
-		size_t has_next_uli = 0, has_next_oli = 0;
+		cache_unlink(st, e);
 
-		end++;
+		slot = &st->buckets[e->key[0] & (st->nbuckets - 1)];
+		while (*slot != e)
+			slot = &(*slot)->chain;
+		*slot = e->chain;
 
-		while (end < size && data[end - 1] != '\n')
-			end++;
+		st->entries--;
+		st->bytes -= CACHE_ENTRY_SIZE(e->size);
+		st->evictions++;
 
-		/* process an empty line */
-		if (is_empty(data + beg, end - beg)) {
-			in_empty = 1;
-			beg = end;
-			continue;
+		if (e->refs)
+			e->dead = 1;
+		else {
+			e->next = freed;
+			freed = e;
 		}
+	}
 
-		/* calculating the indentation */
-		i = 0;
-		while (i < 4 && beg + i < end && data[beg + i] == ' ')
-			i++;
-
-		pre = i;
+	return freed;
+}
 
-		if (rndr->ext_flags & MKDEXT_FENCED_CODE) {
-			if (is_codefence(data + beg + i, end - beg - i, NULL) != 0)
-				in_fence = !in_fence;
-		}
+/* cache_drop • frees entries chained through next */
+static void
+cache_drop(struct cache_entry *freed)
+{
+	while (freed) {
+		struct cache_entry *next = freed->next;
 
-		/* Only check for new list items if we are **not** inside
-		 * a fenced code block */
-		if (!in_fence) {
-			has_next_uli = prefix_uli(data + beg + i, end - beg - i);
-			has_next_oli = prefix_oli(data + beg + i, end - beg - i);
-		}
+		free(freed);
+		freed = next;
+	}
+}
 
-		/* checking for ul/ol switch */
-		if (in_empty && (
-			((*flags & MKD_LIST_ORDERED) && has_next_uli) ||
-			(!(*flags & MKD_LIST_ORDERED) && has_next_oli))){
-			*flags |= MKD_LI_END;
-			break; /* the following item must have same list type */
-		}
+/* doc_size of the entries of top-level blocks, which no document matches */
+#define FRAG_ENTRY ((size_t)-1)
+
+/* frag_head • a top-level block, at the start of the data of its entry */
+/*	it is followed by the ids of the references it looked up, the state
+ *	of the renderer after it and its output */
+struct frag_head {
+	uint64_t key[2];	/* its lines and the lines past it */
+	uint64_t refs;	/* what its references resolve to */
+	size_t nlines;
+	size_t past;	/* lines past it the parser may have looked at */
+	size_t nids;
+	size_t state_size;
+	size_t out_size;
+};
 
-		/* checking for a new item */
-		if ((has_next_uli && !is_hrule(data + beg + i, end - beg - i)) || has_next_oli) {
-			if (in_empty)
-				has_inside_empty = 1;
+/* frag_key • the hash of the n lines of a block at beg, and of the past
+ * lines after them, or of as many as the text has */
+/*	the lines of the root are consecutive in the text */
+static void
+frag_key(uint64_t key[2], const struct block_frame *root, size_t beg, size_t n,
+	size_t past, uint64_t seed)
+{
+	size_t end = root->nlines - beg - n < past ? root->nlines : beg + n + past;
+	const uint8_t *from = root->lines[beg].data;
+	const uint8_t *to = root->lines[end - 1].data + root->lines[end - 1].size;
 
-			if (pre == orgpre) /* the following item must have */
-				break;             /* the same indentation */
+	hash128(key, from, (size_t)(to - from), seed ^ fmix64(n << 2 | (end - beg - n)));
+}
 
-			if (!sublist)
-				sublist = work->size;
-		}
-		/* joining only indented stuff after empty lines;
-		 * note that now we only require 1 space of indentation
-		 * to continue a list */
-		else if (in_empty && pre == 0) {
-			*flags |= MKD_LI_END;
-			break;
-		}
-		else if (in_empty) {
-			sd_bufputc(work, '\n');
-			has_inside_empty = 1;
-		}
+/* frag_refs • the hash of what reference ids resolve to */
+/*	a reference found or missing counts as much as the lines */
+static uint64_t
+frag_refs(struct link_ref **refs, const unsigned int *ids, size_t nids)
+{
+	uint64_t h = nids, part[2];
+	size_t i;
 
-		in_empty = 0;
+	for (i = 0; i < nids; ++i) {
+		struct link_ref *ref = find_link_ref_id(refs, ids[i]);
 
-		/* adding the line without prefix into the working buffer */
-		sd_bufput(work, data + beg + i, end - beg - i);
-		beg = end;
-	}
+		h = fmix64(h ^ ids[i]);
+		if (!ref)
+			continue;
 
-	/* render of li contents */
-	if (has_inside_empty)
-		*flags |= MKD_LI_BLOCK;
+		hash128(part, ref->link->data, ref->link->size, h);
+		h ^= part[0];
 
-	if (*flags & MKD_LI_BLOCK) {
-		/* intermediate render of block li */
-		if (sublist && sublist < work->size) {
-			parse_block(inter, rndr, work->data, sublist);
-			parse_block(inter, rndr, work->data + sublist, work->size - sublist);
+		if (ref->title) {
+			hash128(part, ref->title->data, ref->title->size, h);
+			h ^= part[1];
 		}
-		else
-			parse_block(inter, rndr, work->data, work->size);
-	} else {
-		/* intermediate render of inline li */
-		if (sublist && sublist < work->size) {
-			parse_inline(inter, rndr, work->data, sublist);
-			parse_block(inter, rndr, work->data + sublist, work->size - sublist);
-		}
-		else
-			parse_inline(inter, rndr, work->data, work->size);
 	}
 
-	/* render of li itself */
-	if (rndr->cb.listitem)
-		rndr->cb.listitem(ob, inter, *flags, rndr->opaque);
-
-	rndr_popbuf(rndr, BUFFER_SPAN);
-	rndr_popbuf(rndr, BUFFER_SPAN);
-	return beg;
+	return h;
 }
 
-
-/* parse_list • parsing ordered or unordered list block */
+/* frag_past • how many lines past a top-level block the parser may
+ * have looked at to find where the block ends */
 static size_t
-parse_list(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, int flags)
+frag_past(int leaf, const struct block_frame *root, size_t beg, size_t n)
 {
-	struct sd_buf *work = 0;
-	size_t i = 0, j;
-
-	work = rndr_newbuf(rndr, BUFFER_BLOCK);
+	switch (leaf) {
+	case LEAF_ATX:
+	case LEAF_RULE:
+		return 0;
 
-	while (i < size) {
-		j = parse_listitem(work, rndr, data + i, size - i, &flags);
-		i += j;
+	/* closed by a fence rather than by the end of the text */
+	case LEAF_FENCE:
+		return beg + n < root->nlines ? 0 : 2;
 
-		if (!j || (flags & MKD_LI_END))
-			break;
+	/* closed by the blank line they end with */
+	case LEAF_HTML:
+	case LEAF_PARAGRAPH:
+		return root->lines[beg + n - 1].blank ? 0 : 2;
 	}
 
-	if (rndr->cb.list)
-		rndr->cb.list(ob, work, flags, rndr->opaque);
-	rndr_popbuf(rndr, BUFFER_BLOCK);
-	return i;
+	/* the line after the block, and the one after it, which tells a
+	 * list marker from a setext underline */
+	return 2;
 }
 
-/* parse_atxheader • parsing of atx-style headers */
-static size_t
-parse_atxheader(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
+/* how many entries of blocks starting with the same line are tried */
+#define FRAG_PROBES 4
+
+/* frag_find • the entry of the block at the start of the root, pinned,
+ * or NULL */
+/*	entries of blocks starting with the same line are told apart by
+ *	their lines, the ones past them and their references. Those are
+ *	hashed out of the lock, with the candidates pinned meanwhile */
+static struct cache_entry *
+frag_find(struct cache_stripe *st, struct sd_markdown *rndr, const struct block_frame *root)
 {
-	size_t level = 0;
-	size_t i, end, skip;
+	const struct frag_block *fb = &rndr->frag;
+	struct cache_entry *probe[FRAG_PROBES], *e, *found = NULL, *freed = NULL;
+	size_t i, n = 0;
 
-	while (level < size && level < 6 && data[level] == '#')
-		level++;
+	SD_CACHE_LOCK(&st->lock);
+	e = st->nbuckets ? st->buckets[fb->line_key[0] & (st->nbuckets - 1)] : NULL;
+	for (; e && n < FRAG_PROBES; e = e->chain) {
+		const struct frag_head *head = (const struct frag_head *)e->data;
 
-	for (i = level; i < size && data[i] == ' '; i++);
+		if (e->doc_size != FRAG_ENTRY || e->key[0] != fb->line_key[0] ||
+			e->key[1] != fb->line_key[1] || head->state_size != fb->state_size ||
+			head->nlines > root->nlines - root->beg)
+			continue;
 
-	for (end = i; end < size && data[end] != '\n'; end++);
-	skip = end;
+		e->refs++;
+		probe[n++] = e;
+	}
 
-	while (end && data[end - 1] == '#')
-		end--;
+	if (!n)
+		st->block_misses++;
+	SD_CACHE_UNLOCK(&st->lock);
 
-	while (end && data[end - 1] == ' ')
-		end--;
+	if (!n)
+		return NULL;
 
-	if (end > i) {
-		struct sd_buf *work = rndr_newbuf(rndr, BUFFER_SPAN);
+	for (i = 0; i < n && !found; ++i) {
+		const struct frag_head *head = (const struct frag_head *)probe[i]->data;
+		uint64_t key[2];
 
-		parse_inline(work, rndr, data + i, end - i);
+		frag_key(key, root, root->beg, head->nlines, head->past, fb->block_seed);
+		if (key[0] == head->key[0] && key[1] == head->key[1] &&
+			frag_refs(rndr->refs, (const unsigned int *)(head + 1), head->nids) == head->refs)
+			found = probe[i];
+	}
 
-		if (rndr->cb.header)
-			rndr->cb.header(ob, work, (int)level, rndr->opaque);
+	/* the found entry stays pinned for the copy; the others may have
+	 * been evicted meanwhile, and are then freed by their last reader */
+	SD_CACHE_LOCK(&st->lock);
+	for (i = 0; i < n; ++i) {
+		e = probe[i];
 
-		rndr_popbuf(rndr, BUFFER_SPAN);
+		if (e != found && --e->refs == 0 && e->dead) {
+			e->next = freed;
+			freed = e;
+		}
 	}
 
-	return skip;
-}
+	if (found) {
+		if (!found->dead) {
+			cache_unlink(st, found);
+			cache_push(st, found);
+		}
+		st->block_hits++;
+	} else
+		st->block_misses++;
+	SD_CACHE_UNLOCK(&st->lock);
 
+	cache_drop(freed);
+	return found;
+}
 
-/* htmlblock_end • checking end of HTML block : </tag>[ \t]*\n[ \t*]\n */
-/*	returns the length on match, 0 otherwise */
-static size_t
-htmlblock_end_tag(
-	const char *tag,
-	size_t tag_len,
-	struct sd_markdown *rndr,
-	uint8_t *data,
-	size_t size)
+/* frag_splice • renders the block at the start of the root from the
+ * cache, if it is there; returns 1 when it was */
+static int
+frag_splice(struct sd_markdown *rndr, struct block_frame *root)
 {
-	size_t i, w;
+	struct frag_block *fb = &rndr->frag;
+	const struct sd_line *line = &root->lines[root->beg];
+	const struct frag_head *head;
+	const uint8_t *state;
+	struct cache_stripe *st;
+	struct cache_entry *e;
+	uint64_t part[2];
+
+	/* renderers may start a block differently after earlier output */
+	hash128(part, fb->state, fb->state_size, fb->seed ^ (root->ob->size != 0));
+	fb->block_seed = part[0];
+	hash128(fb->line_key, line->data, line->size, fb->block_seed);
 
-	/* checking if tag is a match */
-	if (tag_len + 3 >= size ||
-		strncasecmp((char *)data + 2, tag, tag_len) != 0 ||
-		data[tag_len + 2] != '>')
+	st = &fb->cache->stripes[fb->line_key[1] % SD_CACHE_STRIPES];
+
+	e = frag_find(st, rndr, root);
+	if (!e)
 		return 0;
 
-	/* checking white lines */
-	i = tag_len + 3;
-	w = 0;
-	if (i < size && (w = is_empty(data + i, size - i)) == 0)
-		return 0; /* non-blank after tag */
-	i += w;
-	w = 0;
+	head = (const struct frag_head *)e->data;
+	state = e->data + sizeof(struct frag_head) + head->nids * sizeof(unsigned int);
+
+	if (head->state_size)
+		memcpy(fb->state, state, head->state_size);
 
-	if (i < size)
-		w = is_empty(data + i, size - i);
+	sd_bufput(root->ob, state + head->state_size, head->out_size);
+	root->beg += head->nlines;
 
-	return i + w;
+	cache_release(st, e);
+	return 1;
 }
 
-static size_t
-htmlblock_end(const char *curtag,
-	struct sd_markdown *rndr,
-	uint8_t *data,
-	size_t size,
-	int start_of_line)
+/* frag_store • adds the top-level block just parsed to the cache */
+static void
+frag_store(struct sd_markdown *rndr, struct block_frame *root)
 {
-	size_t tag_size = strlen(curtag);
-	size_t i = 1, end_tag;
-	int block_lines = 0;
+	struct frag_block *fb = &rndr->frag;
+	struct cache_stripe *st = &fb->cache->stripes[fb->line_key[1] % SD_CACHE_STRIPES];
+	struct cache_entry *e, *c, *freed;
+	struct frag_head *head;
+	size_t n = root->beg - fb->beg, out_size = root->ob->size - fb->mark, size;
+	uint8_t *p;
 
-	while (i < size) {
-		i++;
-		while (i < size && !(data[i - 1] == '<' && data[i] == '/')) {
-			if (data[i] == '\n')
-				block_lines++;
+	if (fb->unsure || !n)
+		return;
 
-			i++;
-		}
+	size = sizeof(struct frag_head) + fb->nids * sizeof(unsigned int) +
+		fb->state_size + out_size;
 
-		/* If we are only looking for unindented tags, skip the tag
-		 * if it doesn't follow a newline.
-		 *
-		 * The only exception to this is if the tag is still on the
-		 * initial line; in that case it still counts as a closing
-		 * tag
-		 */
-		if (start_of_line && block_lines > 0 && data[i - 2] != '\n')
-			continue;
+	if (CACHE_ENTRY_SIZE(size) > st->max_bytes)
+		return;
 
-		if (i + 2 + tag_size >= size)
-			break;
+	e = (struct cache_entry *)malloc(CACHE_ENTRY_SIZE(size));
+	if (!e)
+		return;
 
-		end_tag = htmlblock_end_tag(curtag, tag_size, rndr, data + i - 1, size - i + 1);
-		if (end_tag)
-			return i + end_tag - 1;
+	memcpy(e->key, fb->line_key, sizeof(e->key));
+	e->doc_size = FRAG_ENTRY;
+	e->size = size;
+	e->refs = 0;
+	e->dead = 0;
+
+	head = (struct frag_head *)e->data;
+	head->nlines = n;
+	head->past = frag_past(fb->leaf, root, fb->beg, n);
+	head->nids = fb->nids;
+	head->state_size = fb->state_size;
+	head->out_size = out_size;
+	head->refs = frag_refs(rndr->refs, fb->ids, fb->nids);
+	frag_key(head->key, root, fb->beg, n, head->past, fb->block_seed);
+
+	p = (uint8_t *)(head + 1);
+	if (fb->nids)
+		memcpy(p, fb->ids, fb->nids * sizeof(unsigned int));
+	p += fb->nids * sizeof(unsigned int);
+
+	if (fb->state_size)
+		memcpy(p, fb->state, fb->state_size);
+	p += fb->state_size;
+
+	memcpy(p, root->ob->data + fb->mark, out_size);
+
+	/* another render may have stored the same block meanwhile */
+	SD_CACHE_LOCK(&st->lock);
+	for (c = st->nbuckets ? st->buckets[e->key[0] & (st->nbuckets - 1)] : NULL; c; c = c->chain) {
+		const struct frag_head *h = (const struct frag_head *)c->data;
+
+		if (c->doc_size == FRAG_ENTRY && c->key[0] == e->key[0] && c->key[1] == e->key[1] &&
+			h->key[0] == head->key[0] && h->key[1] == head->key[1] && h->refs == head->refs)
+			break;
 	}
 
-	return 0;
-}
+	if (c || !cache_insert(st, e)) {
+		e->next = NULL;
+		freed = e;
+	} else
+		freed = cache_evict(st);
+	SD_CACHE_UNLOCK(&st->lock);
 
+	cache_drop(freed);
+}
 
-/* parse_htmlblock • parsing of inline HTML block */
-static size_t
-parse_htmlblock(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size, int do_render)
+/* frag_next • stores the top-level block just parsed, then splices the
+ * next one in from the cache, or opens it for the parser */
+/*	returns 1 when it was spliced, with the root past it */
+static int
+frag_next(struct sd_markdown *rndr, struct block_frame *root)
 {
-	size_t i, j = 0, tag_end;
-	const char *curtag = NULL;
-	struct sd_buf work = {0};
-    work.data = data;
+	struct frag_block *fb = &rndr->frag;
 
-	/* identification of the opening tag */
-	if (size < 2 || data[0] != '<')
+	if (fb->open) {
+		fb->open = 0;
+		frag_store(rndr, root);
+	}
+
+	/* blank lines are not worth an entry */
+	if (root->beg >= root->nlines || root->lines[root->beg].blank)
 		return 0;
 
-	i = 1;
-	while (i < size && data[i] != '>' && data[i] != ' ')
-		i++;
+	if (frag_splice(rndr, root))
+		return 1;
 
-	if (i < size)
-		curtag = find_block_tag((char *)data + 1, (int)i - 1);
+	fb->open = 1;
+	fb->leaf = LEAF_NONE;
+	fb->beg = root->beg;
+	fb->mark = root->ob->size;
+	fb->unsure = 0;
+	fb->nids = 0;
+	fb->parsed++;
+	return 0;
+}
 
-	/* handling of special cases */
-	if (!curtag) {
+struct sd_cache *
+sd_cache_new(size_t max_bytes)
+{
+	struct sd_cache *cache = (struct sd_cache *)calloc(1, sizeof(struct sd_cache));
+	size_t i;
 
-		/* HTML comment, laxist form */
-		if (size > 5 && data[1] == '!' && data[2] == '-' && data[3] == '-') {
-			i = 5;
+	if (!cache)
+		return NULL;
 
-			while (i < size && !(data[i - 2] == '-' && data[i - 1] == '-' && data[i] == '>'))
-				i++;
+	for (i = 0; i < SD_CACHE_STRIPES; ++i) {
+		cache->stripes[i].max_bytes = max_bytes / SD_CACHE_STRIPES;
+		SD_CACHE_UNLOCK(&cache->stripes[i].lock);
+	}
 
-			i++;
+	return cache;
+}
 
-			if (i < size)
-				j = is_empty(data + i, size - i);
+void
+sd_cache_free(struct sd_cache *cache)
+{
+	size_t i;
 
-			if (j) {
-				work.size = i + j;
-				if (do_render && rndr->cb.blockhtml)
-					rndr->cb.blockhtml(ob, &work, rndr->opaque);
-				return work.size;
-			}
-		}
+	if (!cache)
+		return;
 
-		/* HR, which is the only self-closing block tag considered */
-		if (size > 4 && (data[1] == 'h' || data[1] == 'H') && (data[2] == 'r' || data[2] == 'R')) {
-			i = 3;
-			while (i < size && data[i] != '>')
-				i++;
+	for (i = 0; i < SD_CACHE_STRIPES; ++i) {
+		struct cache_entry *e = cache->stripes[i].head, *next;
 
-			if (i + 1 < size) {
-				i++;
-				j = is_empty(data + i, size - i);
-				if (j) {
-					work.size = i + j;
-					if (do_render && rndr->cb.blockhtml)
-						rndr->cb.blockhtml(ob, &work, rndr->opaque);
-					return work.size;
-				}
-			}
+		for (; e; e = next) {
+			next = e->next;
+			free(e);
 		}
 
-		/* no special case recognised */
-		return 0;
+		free(cache->stripes[i].buckets);
 	}
 
-	/* looking for an unindented matching closing tag */
-	/*	followed by a blank line */
-	tag_end = htmlblock_end(curtag, rndr, data, size, 1);
+	free(cache);
+}
 
-	/* if not found, trying a second pass looking for indented match */
-	/* but not if tag is "ins" or "del" (following original Markdown.pl) */
-	if (!tag_end && strcmp(curtag, "ins") != 0 && strcmp(curtag, "del") != 0) {
-		tag_end = htmlblock_end(curtag, rndr, data, size, 0);
-	}
+int
+sd_cache_render(struct sd_buf *ob, const uint8_t *document, size_t doc_size,
+	struct sd_markdown *md, struct sd_cache *cache, unsigned int render_flags)
+{
+	struct cache_stripe *st;
+	struct cache_entry *e, *freed;
+	uint64_t key[2];
+	size_t size;
 
-	if (!tag_end)
+	/* renderers may start differently after earlier output, as the html
+	 * one does, so only renders into an empty buffer are cached */
+	if (ob->size) {
+		sd_markdown_render(ob, document, doc_size, md);
 		return 0;
+	}
 
-	/* the end of the block has been found */
-	work.size = tag_end;
-	if (do_render && rndr->cb.blockhtml)
-		rndr->cb.blockhtml(ob, &work, rndr->opaque);
+	cache_key(key, document, doc_size, md, render_flags);
+	st = &cache->stripes[key[1] % SD_CACHE_STRIPES];
 
-	return tag_end;
-}
+	SD_CACHE_LOCK(&st->lock);
+	e = cache_find(st, key, doc_size);
+	if (e) {
+		e->refs++;
+		cache_unlink(st, e);
+		cache_push(st, e);
+		st->hits++;
+	} else
+		st->misses++;
+	SD_CACHE_UNLOCK(&st->lock);
 
-static void
-parse_table_row(
-	struct sd_buf *ob,
-	struct sd_markdown *rndr,
-	uint8_t *data,
-	size_t size,
-	size_t columns,
-	int *col_data,
-	int header_flag)
-{
-	size_t i = 0, col;
-	struct sd_buf *row_work = 0;
+	/* a hit is copied out of the lock, pinned against eviction */
+	if (e) {
+		sd_bufput(ob, e->data, e->size);
+		cache_release(st, e);
+		return 1;
+	}
 
-	if (!rndr->cb.table_cell || !rndr->cb.table_row)
-		return;
+	sd_markdown_render(ob, document, doc_size, md);
 
-	row_work = rndr_newbuf(rndr, BUFFER_SPAN);
+	size = ob->size;
+	if (CACHE_ENTRY_SIZE(size) > st->max_bytes)
+		return 0;
 
-	if (i < size && data[i] == '|')
-		i++;
+	e = (struct cache_entry *)malloc(CACHE_ENTRY_SIZE(size));
+	if (!e)
+		return 0;
 
-	for (col = 0; col < columns && i < size; ++col) {
-		size_t cell_start, cell_end;
-		struct sd_buf *cell_work;
+	memcpy(e->key, key, sizeof(e->key));
+	e->doc_size = doc_size;
+	e->size = size;
+	e->refs = 0;
+	e->dead = 0;
+	memcpy(e->data, ob->data, size);
+
+	/* another thread may have rendered it meanwhile */
+	SD_CACHE_LOCK(&st->lock);
+	if (cache_find(st, key, doc_size) || !cache_insert(st, e)) {
+		e->next = NULL;
+		freed = e;
+	} else
+		freed = cache_evict(st);
+	SD_CACHE_UNLOCK(&st->lock);
 
-		cell_work = rndr_newbuf(rndr, BUFFER_SPAN);
+	cache_drop(freed);
+	return 0;
+}
 
-		while (i < size && _isspace(data[i]))
-			i++;
+size_t
+sd_cache_render_blocks(struct sd_buf *ob, const uint8_t *document, size_t doc_size,
+	struct sd_markdown *md, struct sd_cache *cache, unsigned int render_flags,
+	void *state, size_t state_size)
+{
+	struct frag_block *fb = &md->frag;
 
-		cell_start = i;
+	fb->cache = cache;
+	fb->seed = cache_setup(md, render_flags);
+	fb->state = state_size ? state : NULL;
+	fb->state_size = state ? state_size : 0;
+	fb->open = 0;
+	fb->parsed = 0;
 
-		while (i < size && data[i] != '|')
-			i++;
+	sd_markdown_render(ob, document, doc_size, md);
 
-		cell_end = i - 1;
+	fb->cache = NULL;
+	return fb->parsed;
+}
 
-		while (cell_end > cell_start && _isspace(data[cell_end]))
-			cell_end--;
+void
+sd_cache_stats(struct sd_cache *cache, struct sd_cache_stats *stats)
+{
+	size_t i;
 
-		parse_inline(cell_work, rndr, data + cell_start, 1 + cell_end - cell_start);
-		rndr->cb.table_cell(row_work, cell_work, col_data[col] | header_flag, rndr->opaque);
+	memset(stats, 0x0, sizeof(struct sd_cache_stats));
 
-		rndr_popbuf(rndr, BUFFER_SPAN);
-		i++;
-	}
+	for (i = 0; i < SD_CACHE_STRIPES; ++i) {
+		struct cache_stripe *st = &cache->stripes[i];
 
-	for (; col < columns; ++col) {
-		struct sd_buf empty_cell = { 0, 0, 0, 0 };
-		rndr->cb.table_cell(row_work, &empty_cell, col_data[col] | header_flag, rndr->opaque);
+		SD_CACHE_LOCK(&st->lock);
+		stats->hits += st->hits;
+		stats->misses += st->misses;
+		stats->block_hits += st->block_hits;
+		stats->block_misses += st->block_misses;
+		stats->evictions += st->evictions;
+		stats->entries += st->entries;
+		stats->bytes += st->bytes;
+		SD_CACHE_UNLOCK(&st->lock);
 	}
+}
 
-	rndr->cb.table_row(ob, row_work, rndr->opaque);
+#endif // SD_NO_CACHE
 
-	rndr_popbuf(rndr, BUFFER_SPAN);
-}
+// ENDREGION: CACHE.C
 
-static size_t
-parse_table_header(
-	struct sd_buf *ob,
-	struct sd_markdown *rndr,
-	uint8_t *data,
-	size_t size,
-	size_t *columns,
-	int **column_data)
-{
-	int pipes;
-	size_t i = 0, col, header_end, under_end;
+#endif // SD_IMPLEMENTATION
 
-	pipes = 0;
-	while (i < size && data[i] != '\n')
-		if (data[i++] == '|')
-			pipes++;
+#ifndef SD_NO_HTML
 
-	if (i == size || pipes == 0)
-		return 0;
+#ifndef SD_SINGLE_HEADER
 
-	header_end = i;
+//REGION: HTML.H
 
-	while (header_end > 0 && _isspace(data[header_end - 1]))
-		header_end--;
+/* quotes left open by smartypants */
+struct smartypants_data {
+	int in_squote;
+	int in_dquote;
+	int escape;	/* the text is raw, not html: escape what is written as is */
+};
 
-	if (data[0] == '|')
-		pipes--;
+struct html_renderopt {
+	struct {
+		int header_count;
+		int current_level;
+		int level_offset;
+	} toc_data;
 
-	if (header_end && data[header_end - 1] == '|')
-		pipes--;
+	/* quote state of HTML_SMARTYPANTS */
+	struct smartypants_data smartypants;
 
-	*columns = pipes + 1;
-	*column_data = calloc(*columns, sizeof(int));
+	unsigned int flags;
 
-	/* Parse the header underline */
-	i++;
-	if (i < size && data[i] == '|')
-		i++;
+	/* extra callbacks */
+	void (*link_attributes)(struct sd_buf *ob, const struct sd_buf *url, void *self);
+
+	/* start of the contents of the last write-through container */
+	struct sd_buf *block_ob;
+	size_t block_mark;
+};
 
-	under_end = i;
-	while (under_end < size && data[under_end] != '\n')
-		under_end++;
+/* the part of html_renderopt carried from a block to the next, up to flags:
+ * the toc counters and the smartypants quotes (see sd_cache_render_blocks) */
+#define SDHTML_STATE_SIZE offsetof(struct html_renderopt, flags)
 
-	for (col = 0; col < *columns && i < under_end; ++col) {
-		size_t dashes = 0;
+typedef enum {
+	HTML_SKIP_HTML = (1 << 0),
+	HTML_SKIP_STYLE = (1 << 1),
+	HTML_SKIP_IMAGES = (1 << 2),
+	HTML_SKIP_LINKS = (1 << 3),
+	HTML_EXPAND_TABS = (1 << 4),
+	HTML_SAFELINK = (1 << 5),
+	HTML_TOC = (1 << 6),
+	HTML_HARD_WRAP = (1 << 7),
+	HTML_USE_XHTML = (1 << 8),
+	HTML_ESCAPE = (1 << 9),
+	HTML_DECODE_ENTITIES = (1 << 10),
+	HTML_VALIDATE_ENTITIES = (1 << 11),
+	HTML_SMARTYPANTS = (1 << 12),
+	HTML_STREAM_TABLES = (1 << 13),
+	HTML_WRITE_THROUGH = (1 << 14),
+} html_render_mode;
 
-		while (i < under_end && data[i] == ' ')
-			i++;
+typedef enum {
+	HTML_TAG_NONE = 0,
+	HTML_TAG_OPEN,
+	HTML_TAG_CLOSE,
+} html_tag;
 
-		if (data[i] == ':') {
-			i++; (*column_data)[col] |= MKD_TABLE_ALIGN_L;
-			dashes++;
-		}
+int
+sdhtml_is_tag(const uint8_t *tag_data, size_t tag_size, const char *tagname);
 
-		while (i < under_end && data[i] == '-') {
-			i++; dashes++;
-		}
+/*******************
+ * MAIN SDHTML API *
+ *******************/
 
-		if (i < under_end && data[i] == ':') {
-			i++; (*column_data)[col] |= MKD_TABLE_ALIGN_R;
-			dashes++;
-		}
+extern void
+sdhtml_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options_ptr, unsigned int render_flags);
 
-		while (i < under_end && data[i] == ' ')
-			i++;
+extern void
+sdhtml_toc_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options_ptr);
 
-		if (i < under_end && data[i] != '|')
-			break;
+extern void
+sdhtml_smartypants(struct sd_buf *ob, const uint8_t *text, size_t size);
 
-		if (dashes < 3)
-			break;
+//ENDREGION: HTML.H
 
-		i++;
-	}
+//REGION: HOUDINI.H
+
+#ifdef HOUDINI_USE_LOCALE
+#	define _isxdigit(c) isxdigit(c)
+#	define _isdigit(c) isdigit(c)
+#else
+/*
+ * Helper _isdigit methods -- do not trust the current locale
+ * */
+#	define _isxdigit(c) (strchr("0123456789ABCDEFabcdef", (c)) != NULL)
+#	define _isdigit(c) ((c) >= '0' && (c) <= '9')
+#endif
 
-	if (col < *columns)
-		return 0;
+/********************
+ * MAIN HOUDINI API *
+ ********************/
 
-	parse_table_row(
-		ob, rndr, data,
-		header_end,
-		*columns,
-		*column_data,
-		MKD_TABLE_HEADER
-	);
+extern void houdini_escape_html(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_escape_html0(struct sd_buf *ob, const uint8_t *src, size_t size, int secure);
+extern void houdini_unescape_html(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_escape_xml(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_escape_uri(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_escape_url(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_escape_href(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_unescape_uri(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_unescape_url(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_escape_js(struct sd_buf *ob, const uint8_t *src, size_t size);
+extern void houdini_unescape_js(struct sd_buf *ob, const uint8_t *src, size_t size);
 
-	return under_end + 1;
-}
+//ENDREGION: HOUDINI.H
 
-static size_t
-parse_table(
-	struct sd_buf *ob,
-	struct sd_markdown *rndr,
-	uint8_t *data,
-	size_t size)
-{
-	size_t i;
+#endif // SD_SINGLE_HEADER
 
-	struct sd_buf *header_work = 0;
-	struct sd_buf *body_work = 0;
+#if defined(SD_IMPLEMENTATION) && !defined(SD_SINGLE_HEADER_IMPLEMENTATION)
 
-	size_t columns;
-	int *col_data = NULL;
+// REGION: HTML.C
 
-	header_work = rndr_newbuf(rndr, BUFFER_SPAN);
-	body_work = rndr_newbuf(rndr, BUFFER_BLOCK);
+#define USE_XHTML(opt) (opt->flags & HTML_USE_XHTML)
 
-	i = parse_table_header(header_work, rndr, data, size, &columns, &col_data);
-	if (i > 0) {
+int
+sdhtml_is_tag(const uint8_t *tag_data, size_t tag_size, const char *tagname)
+{
+	size_t i;
+	int closed = 0;
 
-		while (i < size) {
-			size_t row_start;
-			int pipes = 0;
+	if (tag_size < 3 || tag_data[0] != '<')
+		return HTML_TAG_NONE;
 
-			row_start = i;
+	i = 1;
 
-			while (i < size && data[i] != '\n')
-				if (data[i++] == '|')
-					pipes++;
+	if (tag_data[i] == '/') {
+		closed = 1;
+		i++;
+	}
 
-			if (pipes == 0 || i == size) {
-				i = row_start;
-				break;
-			}
+	for (; i < tag_size; ++i, ++tagname) {
+		if (*tagname == 0)
+			break;
 
-			parse_table_row(
-				body_work,
-				rndr,
-				data + row_start,
-				i - row_start,
-				columns,
-				col_data, 0
-			);
+		if (tag_data[i] != *tagname)
+			return HTML_TAG_NONE;
+	}
 
-			i++;
-		}
+	if (i == tag_size)
+		return HTML_TAG_NONE;
 
-		if (rndr->cb.table)
-			rndr->cb.table(ob, header_work, body_work, rndr->opaque);
-	}
+	if (isspace(tag_data[i]) || tag_data[i] == '>')
+		return closed ? HTML_TAG_CLOSE : HTML_TAG_OPEN;
 
-	free(col_data);
-	rndr_popbuf(rndr, BUFFER_SPAN);
-	rndr_popbuf(rndr, BUFFER_BLOCK);
-	return i;
+	return HTML_TAG_NONE;
 }
 
-/* parse_block • parsing of one block, returning next uint8_t to parse */
-static void
-parse_block(struct sd_buf *ob, struct sd_markdown *rndr, uint8_t *data, size_t size)
-{
-	size_t beg, end, i;
-	uint8_t *txt_data;
-	beg = 0;
+/* the tags the renderer and smartypants look for */
+enum {
+	TAG_A,
+	TAG_CODE,
+	TAG_IMG,
+	TAG_KBD,
+	TAG_MATH,
+	TAG_PRE,
+	TAG_SAMP,
+	TAG_SCRIPT,
+	TAG_STYLE,
+	TAG_VAR,
+	TAG_UNKNOWN
+};
 
-	if (rndr->work_bufs[BUFFER_SPAN].size +
-		rndr->work_bufs[BUFFER_BLOCK].size > rndr->max_nesting)
-		return;
+/* html_tag_id • parses the name of "<name" or "</name" once */
+/*	returns its TAG_* and sets *kind as sdhtml_is_tag would for that
+ *	name; any other name is TAG_UNKNOWN. The names are found by a perfect
+ *	hash of the first and last letter and the length */
+static int
+html_tag_id(const uint8_t *data, size_t size, int *kind)
+{
+	static const struct { const char *name; int id; } slots[32] = {
+		{ NULL, 0 }, { NULL, 0 }, { NULL, 0 }, { "a", TAG_A },
+		{ NULL, 0 }, { NULL, 0 }, { NULL, 0 }, { "samp", TAG_SAMP },
+		{ NULL, 0 }, { NULL, 0 }, { NULL, 0 }, { "var", TAG_VAR },
+		{ "code", TAG_CODE }, { "script", TAG_SCRIPT }, { NULL, 0 }, { NULL, 0 },
+		{ NULL, 0 }, { NULL, 0 }, { "kbd", TAG_KBD }, { "img", TAG_IMG },
+		{ NULL, 0 }, { NULL, 0 }, { NULL, 0 }, { NULL, 0 },
+		{ "pre", TAG_PRE }, { "math", TAG_MATH }, { NULL, 0 }, { NULL, 0 },
+		{ NULL, 0 }, { "style", TAG_STYLE }, { NULL, 0 }, { NULL, 0 },
+	};
 
-	while (beg < size) {
-		txt_data = data + beg;
-		end = size - beg;
+	size_t i = 1, name, len;
+	unsigned int h;
+
+	*kind = HTML_TAG_NONE;
 
-		if (is_atxheader(rndr, txt_data, end))
-			beg += parse_atxheader(ob, rndr, txt_data, end);
+	if (size < 3 || data[0] != '<')
+		return TAG_UNKNOWN;
 
-		else if (data[beg] == '<' && rndr->cb.blockhtml &&
-				(i = parse_htmlblock(ob, rndr, txt_data, end, 1)) != 0)
-			beg += i;
+	if (data[1] == '/')
+		i++;
 
-		else if ((i = is_empty(txt_data, end)) != 0)
-			beg += i;
+	/* the names are all lowercase letters, and sdhtml_is_tag is case
+	 * sensitive */
+	for (name = i; i < size && data[i] >= 'a' && data[i] <= 'z'; i++);
 
-		else if (is_hrule(txt_data, end)) {
-			if (rndr->cb.hrule)
-				rndr->cb.hrule(ob, rndr->opaque);
+	len = i - name;
+	if (len == 0 || len > 6 || i == size || !(isspace(data[i]) || data[i] == '>'))
+		return TAG_UNKNOWN;
 
-			while (beg < size && data[beg] != '\n')
-				beg++;
+	h = (data[name] + data[i - 1] + len) & 31;
+	if (!slots[h].name || strncmp(slots[h].name, (const char *)data + name, len) != 0 ||
+		slots[h].name[len] != '\0')
+		return TAG_UNKNOWN;
 
-			beg++;
-		}
+	*kind = data[1] == '/' ? HTML_TAG_CLOSE : HTML_TAG_OPEN;
+	return slots[h].id;
+}
 
-		else if ((rndr->ext_flags & MKDEXT_FENCED_CODE) != 0 &&
-			(i = parse_fencedcode(ob, rndr, txt_data, end)) != 0)
-			beg += i;
+static inline void escape_html(struct sd_buf *ob, const uint8_t *source, size_t length)
+{
+	houdini_escape_html0(ob, source, length, 0);
+}
 
-		else if ((rndr->ext_flags & MKDEXT_TABLES) != 0 &&
-			(i = parse_table(ob, rndr, txt_data, end)) != 0)
-			beg += i;
+static inline void escape_href(struct sd_buf *ob, const uint8_t *source, size_t length)
+{
+	houdini_escape_href(ob, source, length);
+}
 
-		else if (prefix_quote(txt_data, end))
-			beg += parse_blockquote(ob, rndr, txt_data, end);
+/********************
+ * GENERIC RENDERER *
+ ********************/
+static int
+rndr_autolink(struct sd_buf *ob, const struct sd_buf *link, enum mkd_autolink type, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-		else if (prefix_code(txt_data, end))
-			beg += parse_blockcode(ob, rndr, txt_data, end);
+	if (!link || !link->size)
+		return 0;
 
-		else if (prefix_uli(txt_data, end))
-			beg += parse_list(ob, rndr, txt_data, end, 0);
+	if ((options->flags & HTML_SAFELINK) != 0 &&
+		!sd_autolink_issafe(link->data, link->size) &&
+		type != MKDA_EMAIL)
+		return 0;
 
-		else if (prefix_oli(txt_data, end))
-			beg += parse_list(ob, rndr, txt_data, end, MKD_LIST_ORDERED);
+	SD_BUFPUTSL(ob, "<a href=\"");
+	if (type == MKDA_EMAIL)
+		SD_BUFPUTSL(ob, "mailto:");
+	escape_href(ob, link->data, link->size);
 
-		else
-			beg += parse_paragraph(ob, rndr, txt_data, end);
+	if (options->link_attributes) {
+		sd_bufputc(ob, '\"');
+		options->link_attributes(ob, link, opaque);
+		sd_bufputc(ob, '>');
+	} else {
+		SD_BUFPUTSL(ob, "\">");
 	}
-}
 
+	/*
+	 * Pretty printing: if we get an email address as
+	 * an actual URI, e.g. `mailto:foo@bar.com`, we don't
+	 * want to print the `mailto:` prefix
+	 */
+	if (sd_bufprefix(link, "mailto:") == 0) {
+		escape_html(ob, link->data + 7, link->size - 7);
+	} else {
+		escape_html(ob, link->data, link->size);
+	}
 
+	SD_BUFPUTSL(ob, "</a>");
 
-/*********************
- * REFERENCE PARSING *
- *********************/
+	return 1;
+}
 
-/* is_ref • returns whether a line is a reference or not */
-static int
-is_ref(const uint8_t *data, size_t beg, size_t end, size_t *last, struct link_ref **refs)
+/* rndr_blocksep • separates a block from the ones before it */
+/*	the first block of a write-through container has nothing before
+ *	it, as when the container is rendered from its own buffer */
+static inline void
+rndr_blocksep(struct sd_buf *ob, void *opaque)
 {
-/*	int n; */
-	size_t i = 0;
-	size_t id_offset, id_end;
-	size_t link_offset, link_end;
-	size_t title_offset, title_end;
-	size_t line_end;
-
-	/* up to 3 optional leading spaces */
-	if (beg + 3 >= end) return 0;
-	if (data[beg] == ' ') { i = 1;
-	if (data[beg + 1] == ' ') { i = 2;
-	if (data[beg + 2] == ' ') { i = 3;
-	if (data[beg + 3] == ' ') return 0; } } }
-	i += beg;
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	/* id part: anything but a newline between brackets */
-	if (data[i] != '[') return 0;
-	i++;
-	id_offset = i;
-	while (i < end && data[i] != '\n' && data[i] != '\r' && data[i] != ']')
-		i++;
-	if (i >= end || data[i] != ']') return 0;
-	id_end = i;
+	if (ob->size > (ob == options->block_ob ? options->block_mark : 0))
+		sd_bufputc(ob, '\n');
+}
 
-	/* spacer: colon (space | tab)* newline? (space | tab)* */
-	i++;
-	if (i >= end || data[i] != ':') return 0;
-	i++;
-	while (i < end && data[i] == ' ') i++;
-	if (i < end && (data[i] == '\n' || data[i] == '\r')) {
-		i++;
-		if (i < end && data[i] == '\r' && data[i - 1] == '\n') i++; }
-	while (i < end && data[i] == ' ') i++;
-	if (i >= end) return 0;
+static void
+rndr_blockcode(struct sd_buf *ob, const struct sd_buf *text, const struct sd_buf *lang, void *opaque)
+{
+	rndr_blocksep(ob, opaque);
 
-	/* link: whitespace-free sequence, optionally between angle brackets */
-	if (data[i] == '<')
-		i++;
+	if (lang && lang->size) {
+		size_t i, cls;
+		SD_BUFPUTSL(ob, "<pre><code class=\"");
 
-	link_offset = i;
+		for (i = 0, cls = 0; i < lang->size; ++i, ++cls) {
+			while (i < lang->size && isspace(lang->data[i]))
+				i++;
 
-	while (i < end && data[i] != ' ' && data[i] != '\n' && data[i] != '\r')
-		i++;
+			if (i < lang->size) {
+				size_t org = i;
+				while (i < lang->size && !isspace(lang->data[i]))
+					i++;
 
-	if (data[i - 1] == '>') link_end = i - 1;
-	else link_end = i;
+				if (lang->data[org] == '.')
+					org++;
 
-	/* optional spacer: (space | tab)* (newline | '\'' | '"' | '(' ) */
-	while (i < end && data[i] == ' ') i++;
-	if (i < end && data[i] != '\n' && data[i] != '\r'
-			&& data[i] != '\'' && data[i] != '"' && data[i] != '(')
-		return 0;
-	line_end = 0;
-	/* computing end-of-line */
-	if (i >= end || data[i] == '\r' || data[i] == '\n') line_end = i;
-	if (i + 1 < end && data[i] == '\n' && data[i + 1] == '\r')
-		line_end = i + 1;
+				if (cls) sd_bufputc(ob, ' ');
+				escape_html(ob, lang->data + org, i - org);
+			}
+		}
 
-	/* optional (space|tab)* spacer after a newline */
-	if (line_end) {
-		i = line_end + 1;
-		while (i < end && data[i] == ' ') i++; }
+		SD_BUFPUTSL(ob, "\">");
+	} else
+		SD_BUFPUTSL(ob, "<pre><code>");
 
-	/* optional title: any non-newline sequence enclosed in '"()
-					alone on its line */
-	title_offset = title_end = 0;
-	if (i + 1 < end
-	&& (data[i] == '\'' || data[i] == '"' || data[i] == '(')) {
-		i++;
-		title_offset = i;
-		/* looking for EOL */
-		while (i < end && data[i] != '\n' && data[i] != '\r') i++;
-		if (i + 1 < end && data[i] == '\n' && data[i + 1] == '\r')
-			title_end = i + 1;
-		else	title_end = i;
-		/* stepping back */
-		i -= 1;
-		while (i > title_offset && data[i] == ' ')
-			i -= 1;
-		if (i > title_offset
-		&& (data[i] == '\'' || data[i] == '"' || data[i] == ')')) {
-			line_end = title_end;
-			title_end = i; } }
+	if (text)
+		escape_html(ob, text->data, text->size);
 
-	if (!line_end || link_end == link_offset)
-		return 0; /* garbage after the link empty link */
+	SD_BUFPUTSL(ob, "</code></pre>\n");
+}
 
-	/* a valid ref has been found, filling-in return structures */
-	if (last)
-		*last = line_end;
+static void
+rndr_blockquote(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	rndr_blocksep(ob, opaque);
+	SD_BUFPUTSL(ob, "<blockquote>\n");
+	if (text) sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</blockquote>\n");
+}
 
-	if (refs) {
-		struct link_ref *ref;
+static void
+rndr_blockquote_begin(struct sd_buf *ob, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-		ref = add_link_ref(refs, data + id_offset, id_end - id_offset);
-		if (!ref)
-			return 0;
+	rndr_blocksep(ob, opaque);
+	SD_BUFPUTSL(ob, "<blockquote>\n");
+	options->block_ob = ob;
+	options->block_mark = ob->size;
+}
 
-		ref->link = sd_bufnew(link_end - link_offset);
-		sd_bufput(ref->link, data + link_offset, link_end - link_offset);
+static void
+rndr_blockquote_end(struct sd_buf *ob, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-		if (title_end > title_offset) {
-			ref->title = sd_bufnew(title_end - title_offset);
-			sd_bufput(ref->title, data + title_offset, title_end - title_offset);
-		}
-	}
+	SD_BUFPUTSL(ob, "</blockquote>\n");
+	options->block_ob = NULL;
+}
 
+static int
+rndr_codespan(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	SD_BUFPUTSL(ob, "<code>");
+	if (text) escape_html(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</code>");
 	return 1;
 }
 
-static void expand_tabs(struct sd_buf *ob, const uint8_t *line, size_t size)
+static int
+rndr_strikethrough(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
 {
-	size_t  i = 0, tab = 0;
-
-	while (i < size) {
-		size_t org = i;
+	if (!text || !text->size)
+		return 0;
 
-		while (i < size && line[i] != '\t') {
-			i++; tab++;
-		}
+	SD_BUFPUTSL(ob, "<del>");
+	sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</del>");
+	return 1;
+}
 
-		if (i > org)
-			sd_bufput(ob, line + org, i - org);
+static int
+rndr_double_emphasis(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	if (!text || !text->size)
+		return 0;
 
-		if (i >= size)
-			break;
+	SD_BUFPUTSL(ob, "<strong>");
+	sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</strong>");
 
-		do {
-			sd_bufputc(ob, ' '); tab++;
-		} while (tab % 4);
+	return 1;
+}
 
-		i++;
-	}
+static int
+rndr_emphasis(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	if (!text || !text->size) return 0;
+	SD_BUFPUTSL(ob, "<em>");
+	if (text) sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</em>");
+	return 1;
 }
 
-/**********************
- * EXPORTED FUNCTIONS *
- **********************/
+static int
+rndr_linebreak(struct sd_buf *ob, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+	sd_bufputs(ob, USE_XHTML(options) ? "<br/>\n" : "<br>\n");
+	return 1;
+}
 
-struct sd_markdown *
-sd_markdown_new(
-	unsigned int extensions,
-	size_t max_nesting,
-	const struct sd_callbacks *callbacks,
-	void *opaque)
+static void
+rndr_header(struct sd_buf *ob, const struct sd_buf *text, int level, void *opaque)
 {
-	struct sd_markdown *md = NULL;
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	assert(max_nesting > 0 && callbacks);
+	rndr_blocksep(ob, opaque);
 
-	md = malloc(sizeof(struct sd_markdown));
-	if (!md)
-		return NULL;
+	if (options->flags & HTML_TOC)
+		sd_bufprintf(ob, "<h%d id=\"toc_%d\">", level, options->toc_data.header_count++);
+	else
+		sd_bufprintf(ob, "<h%d>", level);
 
-	memcpy(&md->cb, callbacks, sizeof(struct sd_callbacks));
+	if (text) sd_bufput(ob, text->data, text->size);
+	sd_bufprintf(ob, "</h%d>\n", level);
+}
 
-	stack_init(&md->work_bufs[BUFFER_BLOCK], 4);
-	stack_init(&md->work_bufs[BUFFER_SPAN], 8);
+static int
+rndr_link(struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *content, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	memset(md->active_char, 0x0, 256);
+	if (link != NULL && (options->flags & HTML_SAFELINK) != 0 && !sd_autolink_issafe(link->data, link->size))
+		return 0;
 
-	if (md->cb.emphasis || md->cb.double_emphasis || md->cb.triple_emphasis) {
-		md->active_char['*'] = MD_CHAR_EMPHASIS;
-		md->active_char['_'] = MD_CHAR_EMPHASIS;
-		if (extensions & MKDEXT_STRIKETHROUGH)
-			md->active_char['~'] = MD_CHAR_EMPHASIS;
-	}
+	SD_BUFPUTSL(ob, "<a href=\"");
 
-	if (md->cb.codespan)
-		md->active_char['`'] = MD_CHAR_CODESPAN;
+	if (link && link->size)
+		escape_href(ob, link->data, link->size);
 
-	if (md->cb.linebreak)
-		md->active_char['\n'] = MD_CHAR_LINEBREAK;
+	if (title && title->size) {
+		SD_BUFPUTSL(ob, "\" title=\"");
+		escape_html(ob, title->data, title->size);
+	}
 
-	if (md->cb.image || md->cb.link)
-		md->active_char['['] = MD_CHAR_LINK;
+	if (options->link_attributes) {
+		sd_bufputc(ob, '\"');
+		options->link_attributes(ob, link, opaque);
+		sd_bufputc(ob, '>');
+	} else {
+		SD_BUFPUTSL(ob, "\">");
+	}
 
-	md->active_char['<'] = MD_CHAR_LANGLE;
-	md->active_char['\\'] = MD_CHAR_ESCAPE;
-	md->active_char['&'] = MD_CHAR_ENTITITY;
+	if (content && content->size) sd_bufput(ob, content->data, content->size);
+	SD_BUFPUTSL(ob, "</a>");
+	return 1;
+}
 
-	if (extensions & MKDEXT_AUTOLINK) {
-		md->active_char[':'] = MD_CHAR_AUTOLINK_URL;
-		md->active_char['@'] = MD_CHAR_AUTOLINK_EMAIL;
-		md->active_char['w'] = MD_CHAR_AUTOLINK_WWW;
-	}
+static void
+rndr_list(struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque)
+{
+	rndr_blocksep(ob, opaque);
+	sd_bufput(ob, flags & MKD_LIST_ORDERED ? "<ol>\n" : "<ul>\n", 5);
+	if (text) sd_bufput(ob, text->data, text->size);
+	sd_bufput(ob, flags & MKD_LIST_ORDERED ? "</ol>\n" : "</ul>\n", 6);
+}
 
-	if (extensions & MKDEXT_SUPERSCRIPT)
-		md->active_char['^'] = MD_CHAR_SUPERSCRIPT;
+static void
+rndr_list_begin(struct sd_buf *ob, int flags, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	/* Extension data */
-	md->ext_flags = extensions;
-	md->opaque = opaque;
-	md->max_nesting = max_nesting;
-	md->in_link_body = 0;
+	rndr_blocksep(ob, opaque);
+	sd_bufput(ob, flags & MKD_LIST_ORDERED ? "<ol>\n" : "<ul>\n", 5);
+	options->block_ob = ob;
+	options->block_mark = ob->size;
+}
 
-	return md;
+static void
+rndr_list_end(struct sd_buf *ob, int flags, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+
+	sd_bufput(ob, flags & MKD_LIST_ORDERED ? "</ol>\n" : "</ul>\n", 6);
+	options->block_ob = NULL;
 }
 
-void
-sd_markdown_render(struct sd_buf *ob, const uint8_t *document, size_t doc_size, struct sd_markdown *md)
+static void
+rndr_listitem(struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque)
 {
-#define MARKDOWN_GROW(x) ((x) + ((x) >> 1))
-	static const char UTF8_BOM[] = {0xEF, 0xBB, 0xBF};
+	SD_BUFPUTSL(ob, "<li>");
+	if (text) {
+		size_t size = text->size;
+		while (size && text->data[size - 1] == '\n')
+			size--;
 
-	struct sd_buf *text;
-	size_t beg, end;
+		sd_bufput(ob, text->data, size);
+	}
+	SD_BUFPUTSL(ob, "</li>\n");
+}
 
-	text = sd_bufnew(64);
-	if (!text)
-		return;
+static void
+rndr_listitem_begin(struct sd_buf *ob, int flags, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	/* Preallocate enough space for our buffer to avoid expanding while copying */
-	sd_bufgrow(text, doc_size);
+	SD_BUFPUTSL(ob, "<li>");
+	options->block_ob = ob;
+	options->block_mark = ob->size;
+}
 
-	/* reset the references table */
-	memset(&md->refs, 0x0, REF_TABLE_SIZE * sizeof(void *));
+static void
+rndr_listitem_end(struct sd_buf *ob, int flags, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	/* first pass: looking for references, copying everything else */
-	beg = 0;
+	/* the trailing newlines of the contents are dropped; the '>'
+	 * of the opening tag stops the trim */
+	while (ob->size && ob->data[ob->size - 1] == '\n')
+		ob->size--;
 
-	/* Skip a possible UTF-8 BOM, even though the Unicode standard
-	 * discourages having these in UTF-8 documents */
-	if (doc_size >= 3 && memcmp(document, UTF8_BOM, 3) == 0)
-		beg += 3;
+	SD_BUFPUTSL(ob, "</li>\n");
+	options->block_ob = NULL;
+}
 
-	while (beg < doc_size) /* iterating over lines */
-		if (is_ref(document, beg, doc_size, &end, md->refs))
-			beg = end;
-		else { /* skipping to the next line */
-			end = beg;
-			while (end < doc_size && document[end] != '\n' && document[end] != '\r')
-				end++;
+static void
+rndr_paragraph(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+	size_t i = 0;
 
-			/* adding the line body if present */
-			if (end > beg)
-				expand_tabs(text, document + beg, end - beg);
+	rndr_blocksep(ob, opaque);
 
-			while (end < doc_size && (document[end] == '\n' || document[end] == '\r')) {
-				/* add one \n per newline */
-				if (document[end] == '\n' || (end + 1 < doc_size && document[end + 1] != '\n'))
-					sd_bufputc(text, '\n');
-				end++;
-			}
+	if (!text || !text->size)
+		return;
 
-			beg = end;
-		}
+	while (i < text->size && isspace(text->data[i])) i++;
 
-	/* pre-grow the output buffer to minimize allocations */
-	sd_bufgrow(ob, MARKDOWN_GROW(text->size));
+	if (i == text->size)
+		return;
 
-	/* second pass: actual rendering */
-	if (md->cb.doc_header)
-		md->cb.doc_header(ob, md->opaque);
+	SD_BUFPUTSL(ob, "<p>");
+	if (options->flags & HTML_HARD_WRAP) {
+		size_t org;
+		while (i < text->size) {
+			org = i;
+			while (i < text->size && text->data[i] != '\n')
+				i++;
 
-	if (text->size) {
-		/* adding a final newline if not already present */
-		if (text->data[text->size - 1] != '\n' &&  text->data[text->size - 1] != '\r')
-			sd_bufputc(text, '\n');
+			if (i > org)
+				sd_bufput(ob, text->data + org, i - org);
+
+			/*
+			 * do not insert a line break if this newline
+			 * is the last character on the paragraph
+			 */
+			if (i >= text->size - 1)
+				break;
 
-		parse_block(ob, md, text->data, text->size);
+			rndr_linebreak(ob, opaque);
+			i++;
+		}
+	} else {
+		sd_bufput(ob, &text->data[i], text->size - i);
 	}
+	SD_BUFPUTSL(ob, "</p>\n");
+}
 
-	if (md->cb.doc_footer)
-		md->cb.doc_footer(ob, md->opaque);
+static void
+rndr_raw_block(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	size_t org, sz;
+	if (!text) return;
+	sz = text->size;
+	while (sz > 0 && text->data[sz - 1] == '\n') sz--;
+	org = 0;
+	while (org < sz && text->data[org] == '\n') org++;
+	if (org >= sz) return;
+	rndr_blocksep(ob, opaque);
+	sd_bufput(ob, text->data + org, sz - org);
+	sd_bufputc(ob, '\n');
+}
 
-	/* clean-up */
-	sd_bufrelease(text);
-	free_link_refs(md->refs);
+static int
+rndr_triple_emphasis(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	if (!text || !text->size) return 0;
+	SD_BUFPUTSL(ob, "<strong><em>");
+	sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</em></strong>");
+	return 1;
+}
 
-	assert(md->work_bufs[BUFFER_SPAN].size == 0);
-	assert(md->work_bufs[BUFFER_BLOCK].size == 0);
+static void
+rndr_hrule(struct sd_buf *ob, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+	rndr_blocksep(ob, opaque);
+	sd_bufputs(ob, USE_XHTML(options) ? "<hr/>\n" : "<hr>\n");
 }
 
-void
-sd_markdown_free(struct sd_markdown *md)
+static int
+rndr_image(struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *alt, void *opaque)
 {
-	size_t i;
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+	if (!link || !link->size) return 0;
 
-	for (i = 0; i < (size_t)md->work_bufs[BUFFER_SPAN].asize; ++i)
-		sd_bufrelease(md->work_bufs[BUFFER_SPAN].item[i]);
+	SD_BUFPUTSL(ob, "<img src=\"");
+	escape_href(ob, link->data, link->size);
+	SD_BUFPUTSL(ob, "\" alt=\"");
 
-	for (i = 0; i < (size_t)md->work_bufs[BUFFER_BLOCK].asize; ++i)
-		sd_bufrelease(md->work_bufs[BUFFER_BLOCK].item[i]);
+	if (alt && alt->size)
+		escape_html(ob, alt->data, alt->size);
 
-	stack_free(&md->work_bufs[BUFFER_SPAN]);
-	stack_free(&md->work_bufs[BUFFER_BLOCK]);
+	if (title && title->size) {
+		SD_BUFPUTSL(ob, "\" title=\"");
+		escape_html(ob, title->data, title->size); }
 
-	free(md);
+	sd_bufputs(ob, USE_XHTML(options) ? "\"/>" : "\">");
+	return 1;
 }
 
-void
-sd_version(int *ver_major, int *ver_minor, int *ver_revision)
+static int
+rndr_raw_html(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
 {
-	*ver_major = SUNDOWN_VER_MAJOR;
-	*ver_minor = SUNDOWN_VER_MINOR;
-	*ver_revision = SUNDOWN_VER_REVISION;
-}
-
-// ENDREGION: MARKDOWN.C
-
-// REGION: STACK.C
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-int
-stack_grow(struct stack *st, size_t new_size)
-{
-	void **new_st;
+	/* HTML_ESCAPE overrides SKIP_HTML, SKIP_STYLE, SKIP_LINKS and SKIP_IMAGES
+	* It doens't see if there are any valid tags, just escape all of them. */
+	if((options->flags & HTML_ESCAPE) != 0) {
+		escape_html(ob, text->data, text->size);
+		return 1;
+	}
 
-	if (st->asize >= new_size)
-		return 0;
+	if ((options->flags & HTML_SKIP_HTML) != 0)
+		return 1;
 
-	new_st = realloc(st->item, new_size * sizeof(void *));
-	if (new_st == NULL)
-		return -1;
+	if ((options->flags & (HTML_SKIP_STYLE | HTML_SKIP_LINKS | HTML_SKIP_IMAGES)) != 0) {
+		int kind, tag = html_tag_id(text->data, text->size, &kind);
 
-	memset(new_st + st->asize, 0x0,
-		(new_size - st->asize) * sizeof(void *));
+		if ((options->flags & HTML_SKIP_STYLE) != 0 && tag == TAG_STYLE)
+			return 1;
 
-	st->item = new_st;
-	st->asize = new_size;
+		if ((options->flags & HTML_SKIP_LINKS) != 0 && tag == TAG_A)
+			return 1;
 
-	if (st->size > new_size)
-		st->size = new_size;
+		if ((options->flags & HTML_SKIP_IMAGES) != 0 && tag == TAG_IMG)
+			return 1;
+	}
 
-	return 0;
+	sd_bufput(ob, text->data, text->size);
+	return 1;
 }
 
-void
-stack_free(struct stack *st)
+static void
+rndr_table(struct sd_buf *ob, const struct sd_buf *header, const struct sd_buf *body, void *opaque)
 {
-	if (!st)
-		return;
-
-	free(st->item);
-
-	st->item = NULL;
-	st->size = 0;
-	st->asize = 0;
+	rndr_blocksep(ob, opaque);
+	SD_BUFPUTSL(ob, "<table><thead>\n");
+	if (header)
+		sd_bufput(ob, header->data, header->size);
+	SD_BUFPUTSL(ob, "</thead><tbody>\n");
+	if (body)
+		sd_bufput(ob, body->data, body->size);
+	SD_BUFPUTSL(ob, "</tbody></table>\n");
 }
 
-int
-stack_init(struct stack *st, size_t initial_size)
+static void
+rndr_table_begin(struct sd_buf *ob, const struct sd_buf *header, void *opaque)
 {
-	st->item = NULL;
-	st->size = 0;
-	st->asize = 0;
-
-	if (!initial_size)
-		initial_size = 8;
-
-	return stack_grow(st, initial_size);
+	rndr_blocksep(ob, opaque);
+	SD_BUFPUTSL(ob, "<table><thead>\n");
+	if (header)
+		sd_bufput(ob, header->data, header->size);
+	SD_BUFPUTSL(ob, "</thead><tbody>\n");
 }
 
-void *
-stack_pop(struct stack *st)
+static void
+rndr_table_end(struct sd_buf *ob, void *opaque)
 {
-	if (!st->size)
-		return NULL;
-
-	return st->item[--st->size];
+	SD_BUFPUTSL(ob, "</tbody></table>\n");
 }
 
-int
-stack_push(struct stack *st, void *item)
+static void
+rndr_tablerow(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
 {
-	if (stack_grow(st, st->size * 2) < 0)
-		return -1;
-
-	st->item[st->size++] = item;
-	return 0;
+	SD_BUFPUTSL(ob, "<tr>\n");
+	if (text)
+		sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</tr>\n");
 }
 
-void *
-stack_top(struct stack *st)
+static void
+rndr_tablecell(struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque)
 {
-	if (!st->size)
-		return NULL;
-
-	return st->item[st->size - 1];
-}
-
-// ENDREGION: STACK.C
-
-#endif // SD_IMPLEMENTATION
-
-#ifndef SD_NO_HTML
-
-//REGION: HTML.H
-
-struct html_renderopt {
-	struct {
-		int header_count;
-		int current_level;
-		int level_offset;
-	} toc_data;
-
-	unsigned int flags;
-
-	/* extra callbacks */
-	void (*link_attributes)(struct sd_buf *ob, const struct sd_buf *url, void *self);
-};
-
-typedef enum {
-	HTML_SKIP_HTML = (1 << 0),
-	HTML_SKIP_STYLE = (1 << 1),
-	HTML_SKIP_IMAGES = (1 << 2),
-	HTML_SKIP_LINKS = (1 << 3),
-	HTML_EXPAND_TABS = (1 << 4),
-	HTML_SAFELINK = (1 << 5),
-	HTML_TOC = (1 << 6),
-	HTML_HARD_WRAP = (1 << 7),
-	HTML_USE_XHTML = (1 << 8),
-	HTML_ESCAPE = (1 << 9),
-} html_render_mode;
-
-typedef enum {
-	HTML_TAG_NONE = 0,
-	HTML_TAG_OPEN,
-	HTML_TAG_CLOSE,
-} html_tag;
-
-int
-sdhtml_is_tag(const uint8_t *tag_data, size_t tag_size, const char *tagname);
+	if (flags & MKD_TABLE_HEADER) {
+		SD_BUFPUTSL(ob, "<th");
+	} else {
+		SD_BUFPUTSL(ob, "<td");
+	}
 
-/*******************
- * MAIN SDHTML API *
- *******************/
+	switch (flags & MKD_TABLE_ALIGNMASK) {
+	case MKD_TABLE_ALIGN_CENTER:
+		SD_BUFPUTSL(ob, " align=\"center\">");
+		break;
 
-extern void
-sdhtml_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options_ptr, unsigned int render_flags);
+	case MKD_TABLE_ALIGN_L:
+		SD_BUFPUTSL(ob, " align=\"left\">");
+		break;
 
-extern void
-sdhtml_toc_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options_ptr);
+	case MKD_TABLE_ALIGN_R:
+		SD_BUFPUTSL(ob, " align=\"right\">");
+		break;
 
-extern void
-sdhtml_smartypants(struct sd_buf *ob, const uint8_t *text, size_t size);
+	default:
+		SD_BUFPUTSL(ob, ">");
+	}
 
-//ENDREGION: HTML.H
+	if (text)
+		sd_bufput(ob, text->data, text->size);
 
-//REGION: HOUDINI.H
+	if (flags & MKD_TABLE_HEADER) {
+		SD_BUFPUTSL(ob, "</th>\n");
+	} else {
+		SD_BUFPUTSL(ob, "</td>\n");
+	}
+}
 
-#ifdef HOUDINI_USE_LOCALE
-#	define _isxdigit(c) isxdigit(c)
-#	define _isdigit(c) isdigit(c)
-#else
-/*
- * Helper _isdigit methods -- do not trust the current locale
- * */
-#	define _isxdigit(c) (strchr("0123456789ABCDEFabcdef", (c)) != NULL)
-#	define _isdigit(c) ((c) >= '0' && (c) <= '9')
-#endif
+static int
+rndr_superscript(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	if (!text || !text->size) return 0;
+	SD_BUFPUTSL(ob, "<sup>");
+	sd_bufput(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</sup>");
+	return 1;
+}
 
-/********************
- * MAIN HOUDINI API *
- ********************/
+static void smartypants_text(struct sd_buf *ob, struct smartypants_data *smrt, const uint8_t *text, size_t size);
 
-extern void houdini_escape_html(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_escape_html0(struct sd_buf *ob, const uint8_t *src, size_t size, int secure);
-extern void houdini_unescape_html(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_escape_xml(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_escape_uri(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_escape_url(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_escape_href(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_unescape_uri(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_unescape_url(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_escape_js(struct sd_buf *ob, const uint8_t *src, size_t size);
-extern void houdini_unescape_js(struct sd_buf *ob, const uint8_t *src, size_t size);
+static void
+rndr_normal_text(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-//ENDREGION: HOUDINI.H
+	if (!text)
+		return;
 
-#ifdef SD_IMPLEMENTATION
+	if (options->flags & HTML_SMARTYPANTS)
+		smartypants_text(ob, &options->smartypants, text->data, text->size);
+	else
+		escape_html(ob, text->data, text->size);
+}
 
-// REGION: HTML.C
+/* rndr_smartypants_reset • no quote is open at the start of a document */
+static void
+rndr_smartypants_reset(struct sd_buf *ob, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-#define USE_XHTML(opt) (opt->flags & HTML_USE_XHTML)
+	(void)ob;
 
-int
-sdhtml_is_tag(const uint8_t *tag_data, size_t tag_size, const char *tagname)
+	options->smartypants.in_squote = 0;
+	options->smartypants.in_dquote = 0;
+}
+
+/* rndr_entity • decodes (HTML_DECODE_ENTITIES) and/or checks
+ * (HTML_VALIDATE_ENTITIES) entities against the HTML5 table */
+static void
+rndr_entity(struct sd_buf *ob, const struct sd_buf *entity, void *opaque)
 {
-	size_t i;
-	int closed = 0;
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+	uint8_t utf8[SD_ENTITY_MAX_UTF8];
+	size_t len = sd_entity_decode(utf8, entity->data, entity->size);
 
-	if (tag_size < 3 || tag_data[0] != '<')
-		return HTML_TAG_NONE;
+	if (len && (options->flags & HTML_DECODE_ENTITIES))
+		escape_html(ob, utf8, len);
+	else if (!len && (options->flags & HTML_VALIDATE_ENTITIES))
+		escape_html(ob, entity->data, entity->size);
+	else
+		sd_bufput(ob, entity->data, entity->size);
+}
 
-	i = 1;
+static void
+toc_header(struct sd_buf *ob, const struct sd_buf *text, int level, void *opaque)
+{
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
 
-	if (tag_data[i] == '/') {
-		closed = 1;
-		i++;
+	/* set the level offset if this is the first header
+	 * we're parsing for the document */
+	if (options->toc_data.current_level == 0) {
+		options->toc_data.level_offset = level - 1;
 	}
+	level -= options->toc_data.level_offset;
 
-	for (; i < tag_size; ++i, ++tagname) {
-		if (*tagname == 0)
-			break;
-
-		if (tag_data[i] != *tagname)
-			return HTML_TAG_NONE;
+	if (level > options->toc_data.current_level) {
+		while (level > options->toc_data.current_level) {
+			SD_BUFPUTSL(ob, "<ul>\n<li>\n");
+			options->toc_data.current_level++;
+		}
+	} else if (level < options->toc_data.current_level) {
+		SD_BUFPUTSL(ob, "</li>\n");
+		while (level < options->toc_data.current_level) {
+			SD_BUFPUTSL(ob, "</ul>\n</li>\n");
+			options->toc_data.current_level--;
+		}
+		SD_BUFPUTSL(ob,"<li>\n");
+	} else {
+		SD_BUFPUTSL(ob,"</li>\n<li>\n");
 	}
 
-	if (i == tag_size)
-		return HTML_TAG_NONE;
-
-	if (isspace(tag_data[i]) || tag_data[i] == '>')
-		return closed ? HTML_TAG_CLOSE : HTML_TAG_OPEN;
-
-	return HTML_TAG_NONE;
+	sd_bufprintf(ob, "<a href=\"#toc_%d\">", options->toc_data.header_count++);
+	if (text)
+		escape_html(ob, text->data, text->size);
+	SD_BUFPUTSL(ob, "</a>\n");
 }
 
-static inline void escape_html(struct sd_buf *ob, const uint8_t *source, size_t length)
+static int
+toc_link(struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *content, void *opaque)
 {
-	houdini_escape_html0(ob, source, length, 0);
+	if (content && content->size)
+		sd_bufput(ob, content->data, content->size);
+	return 1;
 }
 
-static inline void escape_href(struct sd_buf *ob, const uint8_t *source, size_t length)
+static void
+toc_finalize(struct sd_buf *ob, void *opaque)
 {
-	houdini_escape_href(ob, source, length);
+	struct html_renderopt *options = (struct html_renderopt *)opaque;
+
+	while (options->toc_data.current_level > 0) {
+		SD_BUFPUTSL(ob, "</li>\n</ul>\n");
+		options->toc_data.current_level--;
+	}
 }
 
-/********************
- * GENERIC RENDERER *
- ********************/
-static int
-rndr_autolink(struct sd_buf *ob, const struct sd_buf *link, enum mkd_autolink type, void *opaque)
+void
+sdhtml_toc_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options)
 {
-	struct html_renderopt *options = opaque;
+	static const struct sd_callbacks cb_default = {
+		NULL,
+		NULL,
+		NULL,
+		toc_header,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
 
-	if (!link || !link->size)
-		return 0;
+		NULL,
+		rndr_codespan,
+		rndr_double_emphasis,
+		rndr_emphasis,
+		NULL,
+		NULL,
+		toc_link,
+		NULL,
+		rndr_triple_emphasis,
+		rndr_strikethrough,
+		rndr_superscript,
 
-	if ((options->flags & HTML_SAFELINK) != 0 &&
-		!sd_autolink_issafe(link->data, link->size) &&
-		type != MKDA_EMAIL)
-		return 0;
+		NULL,
+		NULL,
 
-	SD_BUFPUTSL(ob, "<a href=\"");
-	if (type == MKDA_EMAIL)
-		SD_BUFPUTSL(ob, "mailto:");
-	escape_href(ob, link->data, link->size);
+		NULL,
+		toc_finalize,
 
-	if (options->link_attributes) {
-		sd_bufputc(ob, '\"');
-		options->link_attributes(ob, link, opaque);
-		sd_bufputc(ob, '>');
-	} else {
-		SD_BUFPUTSL(ob, "\">");
-	}
+		NULL,
+		NULL,
 
-	/*
-	 * Pretty printing: if we get an email address as
-	 * an actual URI, e.g. `mailto:foo@bar.com`, we don't
-	 * want to print the `mailto:` prefix
-	 */
-	if (sd_bufprefix(link, "mailto:") == 0) {
-		escape_html(ob, link->data + 7, link->size - 7);
-	} else {
-		escape_html(ob, link->data, link->size);
-	}
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+	};
 
-	SD_BUFPUTSL(ob, "</a>");
+	memset(options, 0x0, sizeof(struct html_renderopt));
+	options->flags = HTML_TOC;
 
-	return 1;
+	memcpy(callbacks, &cb_default, sizeof(struct sd_callbacks));
 }
 
-static void
-rndr_blockcode(struct sd_buf *ob, const struct sd_buf *text, const struct sd_buf *lang, void *opaque)
+void
+sdhtml_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options, unsigned int render_flags)
 {
-	if (ob->size) sd_bufputc(ob, '\n');
+	static const struct sd_callbacks cb_default = {
+		rndr_blockcode,
+		rndr_blockquote,
+		rndr_raw_block,
+		rndr_header,
+		rndr_hrule,
+		rndr_list,
+		rndr_listitem,
+		rndr_paragraph,
+		rndr_table,
+		rndr_tablerow,
+		rndr_tablecell,
 
-	if (lang && lang->size) {
-		size_t i, cls;
-		SD_BUFPUTSL(ob, "<pre><code class=\"");
+		rndr_autolink,
+		rndr_codespan,
+		rndr_double_emphasis,
+		rndr_emphasis,
+		rndr_image,
+		rndr_linebreak,
+		rndr_link,
+		rndr_raw_html,
+		rndr_triple_emphasis,
+		rndr_strikethrough,
+		rndr_superscript,
 
-		for (i = 0, cls = 0; i < lang->size; ++i, ++cls) {
-			while (i < lang->size && isspace(lang->data[i]))
-				i++;
+		NULL,
+		rndr_normal_text,
 
-			if (i < lang->size) {
-				size_t org = i;
-				while (i < lang->size && !isspace(lang->data[i]))
-					i++;
+		NULL,
+		NULL,
+
+		NULL,
+		NULL,
+
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+	};
+
+	/* Prepare the options pointer */
+	memset(options, 0x0, sizeof(struct html_renderopt));
+	options->flags = render_flags;
+
+	/* Prepare the callbacks */
+	memcpy(callbacks, &cb_default, sizeof(struct sd_callbacks));
+
+	if (render_flags & (HTML_DECODE_ENTITIES | HTML_VALIDATE_ENTITIES))
+		callbacks->entity = rndr_entity;
+
+	if (render_flags & HTML_SKIP_IMAGES)
+		callbacks->image = NULL;
+
+	if (render_flags & HTML_SKIP_LINKS) {
+		callbacks->link = NULL;
+		callbacks->autolink = NULL;
+	}
+
+	if (render_flags & HTML_SKIP_HTML || render_flags & HTML_ESCAPE)
+		callbacks->blockhtml = NULL;
+
+	if (render_flags & HTML_SMARTYPANTS)
+		callbacks->doc_header = rndr_smartypants_reset;
+
+	if (render_flags & HTML_STREAM_TABLES) {
+		callbacks->table_begin = rndr_table_begin;
+		callbacks->table_end = rndr_table_end;
+	}
+
+	if (render_flags & HTML_WRITE_THROUGH) {
+		callbacks->blockquote_begin = rndr_blockquote_begin;
+		callbacks->blockquote_end = rndr_blockquote_end;
+		callbacks->list_begin = rndr_list_begin;
+		callbacks->list_end = rndr_list_end;
+		callbacks->listitem_begin = rndr_listitem_begin;
+		callbacks->listitem_end = rndr_listitem_end;
+	}
+}
+
+//ENDREGION: HTML.C
+
+//REGION HOUDINI_HTML_E.C
+
+#define ESCAPE_GROW_FACTOR(x) (((x) * 12) / 10) /* this is very scientific, yes */
 
-				if (lang->data[org] == '.')
-					org++;
+/* RUN_WINDOW • clean runs are scanned and copied this many bytes at a time,
+ * so that the copy reads them back from L1 rather than from memory */
+#define RUN_WINDOW 4096
 
-				if (cls) sd_bufputc(ob, ' ');
-				escape_html(ob, lang->data + org, i - org);
-			}
-		}
+/* run_scan • index of the first byte at or after i that a codec stops at */
+typedef size_t (*run_scan)(const void *arg, const uint8_t *src, size_t i, size_t size);
 
-		SD_BUFPUTSL(ob, "\">");
-	} else
-		SD_BUFPUTSL(ob, "<pre><code>");
+/* copy_run • copies the clean run at i to ob, returns where it ends */
+static inline size_t
+copy_run(struct sd_buf *ob, const uint8_t *src, size_t i, size_t size,
+	run_scan scan, const void *arg)
+{
+	size_t org, end;
 
-	if (text)
-		escape_html(ob, text->data, text->size);
+	do {
+		org = i;
+		end = size - i > RUN_WINDOW ? i + RUN_WINDOW : size;
+		i = scan(arg, src, i, end);
 
-	SD_BUFPUTSL(ob, "</code></pre>\n");
+		if (i > org)
+			sd_bufput(ob, src + org, i - org);
+	} while (i == end && end < size);
+
+	return i;
 }
 
-static void
-rndr_blockquote(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+/* class_run • run_scan over the byte_class in arg */
+static size_t
+class_run(const void *arg, const uint8_t *src, size_t i, size_t size)
 {
-	if (ob->size) sd_bufputc(ob, '\n');
-	SD_BUFPUTSL(ob, "<blockquote>\n");
-	if (text) sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</blockquote>\n");
+	return class_scan((const struct byte_class *)arg, src, i, size);
 }
 
-static int
-rndr_codespan(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+/* byte_run • run_scan up to the byte arg points to */
+static size_t
+byte_run(const void *arg, const uint8_t *src, size_t i, size_t size)
 {
-	SD_BUFPUTSL(ob, "<code>");
-	if (text) escape_html(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</code>");
-	return 1;
+	const uint8_t *p = (const uint8_t *)memchr(src + i, *(const uint8_t *)arg, size - i);
+	return p ? (size_t)(p - src) : size;
 }
 
-static int
-rndr_strikethrough(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	if (!text || !text->size)
-		return 0;
+/**
+ * According to the OWASP rules:
+ *
+ * & --> &amp;
+ * < --> &lt;
+ * > --> &gt;
+ * " --> &quot;
+ * ' --> &#x27;     &apos; is not recommended
+ * / --> &#x2F;     forward slash is included as it helps end an HTML entity
+ *
+ */
+static const char HTML_ESCAPE_TABLE[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 1, 0, 0, 0, 2, 3, 0, 0, 0, 0, 0, 0, 0, 4, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 6, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
 
-	SD_BUFPUTSL(ob, "<del>");
-	sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</del>");
-	return 1;
-}
+/* the escapes are padded to 8 bytes so they can be copied whole */
+static const char HTML_ESCAPES[][8] = {
+        "",
+        "&quot;",
+        "&amp;",
+        "&#39;",
+        "&#47;",
+        "&lt;",
+        "&gt;"
+};
 
-static int
-rndr_double_emphasis(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	if (!text || !text->size)
-		return 0;
+static const uint8_t HTML_ESCAPE_SIZES[] = { 0, 6, 5, 5, 5, 4, 4 };
 
-	SD_BUFPUTSL(ob, "<strong>");
-	sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</strong>");
+/* html_scan_scalar • index of the first byte at or after i that needs escaping */
+static size_t
+html_scan_scalar(const uint8_t *src, size_t i, size_t size)
+{
+	while (i + 4 <= size) {
+		if (HTML_ESCAPE_TABLE[src[i]]) return i;
+		if (HTML_ESCAPE_TABLE[src[i + 1]]) return i + 1;
+		if (HTML_ESCAPE_TABLE[src[i + 2]]) return i + 2;
+		if (HTML_ESCAPE_TABLE[src[i + 3]]) return i + 3;
+		i += 4;
+	}
 
-	return 1;
-}
+	while (i < size && HTML_ESCAPE_TABLE[src[i]] == 0)
+		i++;
 
-static int
-rndr_emphasis(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	if (!text || !text->size) return 0;
-	SD_BUFPUTSL(ob, "<em>");
-	if (text) sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</em>");
-	return 1;
+	return i;
 }
 
-static int
-rndr_linebreak(struct sd_buf *ob, void *opaque)
-{
-	struct html_renderopt *options = opaque;
-	sd_bufputs(ob, USE_XHTML(options) ? "<br/>\n" : "<br>\n");
-	return 1;
-}
+/*	the vector kernels test for '"', '/' and, folding pairs of
+ *	characters one bit apart, for '&' '\'' (x | 1 == '\'') and
+ *	'<' '>' (x | 2 == '>'); no other byte matches either fold */
 
-static void
-rndr_header(struct sd_buf *ob, const struct sd_buf *text, int level, void *opaque)
-{
-	struct html_renderopt *options = opaque;
+#ifdef SD_SIMD_X86
+static size_t
+html_scan_sse2(const uint8_t *src, size_t i, size_t size)
+{
+	const __m128i quot = _mm_set1_epi8('"'), slash = _mm_set1_epi8('/');
+	const __m128i apos = _mm_set1_epi8('\''), gt = _mm_set1_epi8('>');
+	const __m128i one = _mm_set1_epi8(1), two = _mm_set1_epi8(2);
+
+	for (; i + 16 <= size; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i m = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, quot), _mm_cmpeq_epi8(v, slash)),
+			_mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(v, one), apos),
+				_mm_cmpeq_epi8(_mm_or_si128(v, two), gt)));
+		int mask = _mm_movemask_epi8(m);
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
 
-	if (ob->size)
-		sd_bufputc(ob, '\n');
+	return html_scan_scalar(src, i, size);
+}
 
-	if (options->flags & HTML_TOC)
-		sd_bufprintf(ob, "<h%d id=\"toc_%d\">", level, options->toc_data.header_count++);
-	else
-		sd_bufprintf(ob, "<h%d>", level);
+__attribute__((target("avx2")))
+static size_t
+html_scan_avx2(const uint8_t *src, size_t i, size_t size)
+{
+	const __m256i quot = _mm256_set1_epi8('"'), slash = _mm256_set1_epi8('/');
+	const __m256i apos = _mm256_set1_epi8('\''), gt = _mm256_set1_epi8('>');
+	const __m256i one = _mm256_set1_epi8(1), two = _mm256_set1_epi8(2);
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i m = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, quot), _mm256_cmpeq_epi8(v, slash)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(v, one), apos),
+				_mm256_cmpeq_epi8(_mm256_or_si256(v, two), gt)));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
 
-	if (text) sd_bufput(ob, text->data, text->size);
-	sd_bufprintf(ob, "</h%d>\n", level);
+	/* the tail runs legacy SSE code, which stalls on dirty upper ymm halves */
+	_mm256_zeroupper();
+	return html_scan_sse2(src, i, size);
 }
+#endif
 
-static int
-rndr_link(struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *content, void *opaque)
+#ifdef SD_SIMD_NEON
+static size_t
+html_scan_neon(const uint8_t *src, size_t i, size_t size)
 {
-	struct html_renderopt *options = opaque;
-
-	if (link != NULL && (options->flags & HTML_SAFELINK) != 0 && !sd_autolink_issafe(link->data, link->size))
-		return 0;
-
-	SD_BUFPUTSL(ob, "<a href=\"");
+	const uint8x16_t quot = vdupq_n_u8('"'), slash = vdupq_n_u8('/');
+	const uint8x16_t apos = vdupq_n_u8('\''), gt = vdupq_n_u8('>');
+	const uint8x16_t one = vdupq_n_u8(1), two = vdupq_n_u8(2);
 
-	if (link && link->size)
-		escape_href(ob, link->data, link->size);
+	for (; i + 16 <= size; i += 16) {
+		uint8x16_t v = vld1q_u8(src + i);
+		uint8x16_t m = vorrq_u8(
+			vorrq_u8(vceqq_u8(v, quot), vceqq_u8(v, slash)),
+			vorrq_u8(vceqq_u8(vorrq_u8(v, one), apos),
+				vceqq_u8(vorrq_u8(v, two), gt)));
 
-	if (title && title->size) {
-		SD_BUFPUTSL(ob, "\" title=\"");
-		escape_html(ob, title->data, title->size);
+		if (vmaxvq_u8(m))
+			return html_scan_scalar(src, i, i + 16);
 	}
 
-	if (options->link_attributes) {
-		sd_bufputc(ob, '\"');
-		options->link_attributes(ob, link, opaque);
-		sd_bufputc(ob, '>');
-	} else {
-		SD_BUFPUTSL(ob, "\">");
-	}
+	return html_scan_scalar(src, i, size);
+}
+#endif
 
-	if (content && content->size) sd_bufput(ob, content->data, content->size);
-	SD_BUFPUTSL(ob, "</a>");
-	return 1;
+/* html_scan • the kernel for this CPU */
+static inline size_t
+html_scan(const uint8_t *src, size_t i, size_t size)
+{
+	switch (simd_level()) {
+#ifdef SD_SIMD_X86
+	case SIMD_AVX2: return html_scan_avx2(src, i, size);
+	case SIMD_SSE2: return html_scan_sse2(src, i, size);
+#endif
+#ifdef SD_SIMD_NEON
+	case SIMD_NEON: return html_scan_neon(src, i, size);
+#endif
+	default: return html_scan_scalar(src, i, size);
+	}
 }
 
-static void
-rndr_list(struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque)
+/* html_run • run_scan over html_scan */
+static size_t
+html_run(const void *arg, const uint8_t *src, size_t i, size_t size)
 {
-	if (ob->size) sd_bufputc(ob, '\n');
-	sd_bufput(ob, flags & MKD_LIST_ORDERED ? "<ol>\n" : "<ul>\n", 5);
-	if (text) sd_bufput(ob, text->data, text->size);
-	sd_bufput(ob, flags & MKD_LIST_ORDERED ? "</ol>\n" : "</ul>\n", 6);
+	(void)arg;
+	return html_scan(src, i, size);
 }
 
+/* escape_entities • html_scan driven escaping, the escapes are indexed
+ * by HTML_ESCAPE_TABLE */
 static void
-rndr_listitem(struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque)
+escape_entities(struct sd_buf *ob, const uint8_t *src, size_t size,
+	const char (*escapes)[8], const uint8_t *sizes, int secure)
 {
-	SD_BUFPUTSL(ob, "<li>");
-	if (text) {
-		size_t size = text->size;
-		while (size && text->data[size - 1] == '\n')
-			size--;
+	size_t i = 0;
+	uint8_t esc;
 
-		sd_bufput(ob, text->data, size);
+	sd_bufgrow(ob, ESCAPE_GROW_FACTOR(size));
+
+	while ((i = copy_run(ob, src, i, size, html_run, NULL)) < size) {
+		esc = HTML_ESCAPE_TABLE[src[i]];
+
+		/* The forward slash is only escaped in secure mode */
+		if (esc == 4 && !secure)
+			sd_bufputc(ob, '/');
+		else if (ob->size + 8 <= ob->asize || sd_bufgrow(ob, ob->size + 8) == BUF_OK) {
+			memcpy(ob->data + ob->size, escapes[esc], 8);
+			ob->size += sizes[esc];
+		}
+
+		i++;
 	}
-	SD_BUFPUTSL(ob, "</li>\n");
 }
 
-static void
-rndr_paragraph(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+void
+houdini_escape_html0(struct sd_buf *ob, const uint8_t *src, size_t size, int secure)
 {
-	struct html_renderopt *options = opaque;
-	size_t i = 0;
+	escape_entities(ob, src, size, HTML_ESCAPES, HTML_ESCAPE_SIZES, secure);
+}
 
-	if (ob->size) sd_bufputc(ob, '\n');
+void
+houdini_escape_html(struct sd_buf *ob, const uint8_t *src, size_t size)
+{
+	houdini_escape_html0(ob, src, size, 1);
+}
 
-	if (!text || !text->size)
-		return;
+//ENDREGION HOUDINI_HTML_E.C
 
-	while (i < text->size && isspace(text->data[i])) i++;
+//REGION HOUDINI_HREF_E.C
 
-	if (i == text->size)
-		return;
+static const char HREF_SAFE[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1, 
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
 
-	SD_BUFPUTSL(ob, "<p>");
-	if (options->flags & HTML_HARD_WRAP) {
-		size_t org;
-		while (i < text->size) {
-			org = i;
-			while (i < text->size && text->data[i] != '\n')
-				i++;
+/* HREF_SAFE as a byte_class, for the shuffle kernels */
+static const struct byte_class HREF_CLASS = {
+	HREF_SAFE, 1, 1,
+	{ 0x47, 0x03, 0x07, 0x03, 0x03, 0x03, 0x07, 0x07,
+	  0x03, 0x03, 0x03, 0xA3, 0xAB, 0xA3, 0xAB, 0x83 }
+};
 
-			if (i > org)
-				sd_bufput(ob, text->data + org, i - org);
+/* href_scan_scalar • index of the first byte at or after i that is not HREF_SAFE */
+static size_t
+href_scan_scalar(const uint8_t *src, size_t i, size_t size)
+{
+	while (i + 4 <= size) {
+		if (!HREF_SAFE[src[i]]) return i;
+		if (!HREF_SAFE[src[i + 1]]) return i + 1;
+		if (!HREF_SAFE[src[i + 2]]) return i + 2;
+		if (!HREF_SAFE[src[i + 3]]) return i + 3;
+		i += 4;
+	}
 
-			/*
-			 * do not insert a line break if this newline
-			 * is the last character on the paragraph
-			 */
-			if (i >= text->size - 1)
-				break;
+	while (i < size && HREF_SAFE[src[i]] != 0)
+		i++;
 
-			rndr_linebreak(ob, opaque);
-			i++;
-		}
-	} else {
-		sd_bufput(ob, &text->data[i], text->size - i);
-	}
-	SD_BUFPUTSL(ob, "</p>\n");
+	return i;
 }
 
-static void
-rndr_raw_block(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	size_t org, sz;
-	if (!text) return;
-	sz = text->size;
-	while (sz > 0 && text->data[sz - 1] == '\n') sz--;
-	org = 0;
-	while (org < sz && text->data[org] == '\n') org++;
-	if (org >= sz) return;
-	if (ob->size) sd_bufputc(ob, '\n');
-	sd_bufput(ob, text->data + org, sz - org);
-	sd_bufputc(ob, '\n');
+/*	the safe bytes are '!' to 'z', less '"' '&' '\'' '<' '>' '[' to '^'
+ *	and '`'; ranges are tested as unsigned (x - lo) <= (hi - lo), with
+ *	min and compare since there is no unsigned byte compare */
+
+#ifdef SD_SIMD_X86
+#define HREF_INRANGE_SSE2(v, lo, hi) \
+	_mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8(v, _mm_set1_epi8(lo)), \
+		_mm_set1_epi8((hi) - (lo))), _mm_sub_epi8(v, _mm_set1_epi8(lo)))
+
+static size_t
+href_scan_sse2(const uint8_t *src, size_t i, size_t size)
+{
+	for (; i + 16 <= size; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i bad = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('`'))),
+			_mm_or_si128(
+				_mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(1)), _mm_set1_epi8('\'')),
+				_mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(2)), _mm_set1_epi8('>'))));
+		__m128i safe = _mm_andnot_si128(
+			_mm_or_si128(bad, HREF_INRANGE_SSE2(v, '[', '^')),
+			HREF_INRANGE_SSE2(v, '!', 'z'));
+		int mask = _mm_movemask_epi8(safe) ^ 0xFFFF;
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return href_scan_scalar(src, i, size);
+}
+#endif
+
+#ifdef SD_SIMD_NEON
+static size_t
+href_scan_neon(const uint8_t *src, size_t i, size_t size)
+{
+	for (; i + 16 <= size; i += 16) {
+		uint8x16_t v = vld1q_u8(src + i);
+		uint8x16_t bad = vorrq_u8(
+			vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('`'))),
+			vorrq_u8(
+				vceqq_u8(vorrq_u8(v, vdupq_n_u8(1)), vdupq_n_u8('\'')),
+				vceqq_u8(vorrq_u8(v, vdupq_n_u8(2)), vdupq_n_u8('>'))));
+		uint8x16_t safe = vbicq_u8(
+			vandq_u8(vcgeq_u8(v, vdupq_n_u8('!')), vcleq_u8(v, vdupq_n_u8('z'))),
+			vorrq_u8(bad,
+				vandq_u8(vcgeq_u8(v, vdupq_n_u8('[')), vcleq_u8(v, vdupq_n_u8('^')))));
+
+		if (vminvq_u8(safe) == 0)
+			return href_scan_scalar(src, i, i + 16);
+	}
+
+	return href_scan_scalar(src, i, size);
 }
+#endif
 
-static int
-rndr_triple_emphasis(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+/* href_scan • the kernel for this CPU */
+static inline size_t
+href_scan(const uint8_t *src, size_t i, size_t size)
 {
-	if (!text || !text->size) return 0;
-	SD_BUFPUTSL(ob, "<strong><em>");
-	sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</em></strong>");
-	return 1;
+	switch (simd_level()) {
+#ifdef SD_SIMD_X86
+	case SIMD_AVX2: return class_scan_avx2(&HREF_CLASS, src, i, size);
+	case SIMD_SSE2: return href_scan_sse2(src, i, size);
+#endif
+#ifdef SD_SIMD_NEON
+	case SIMD_NEON: return href_scan_neon(src, i, size);
+#endif
+	default: return href_scan_scalar(src, i, size);
+	}
 }
 
-static void
-rndr_hrule(struct sd_buf *ob, void *opaque)
+/* href_run • run_scan over href_scan */
+static size_t
+href_run(const void *arg, const uint8_t *src, size_t i, size_t size)
 {
-	struct html_renderopt *options = opaque;
-	if (ob->size) sd_bufputc(ob, '\n');
-	sd_bufputs(ob, USE_XHTML(options) ? "<hr/>\n" : "<hr>\n");
+	(void)arg;
+	return href_scan(src, i, size);
 }
 
-static int
-rndr_image(struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *alt, void *opaque)
+void
+houdini_escape_href(struct sd_buf *ob, const uint8_t *src, size_t size)
 {
-	struct html_renderopt *options = opaque;
-	if (!link || !link->size) return 0;
+	static const char hex_chars[] = "0123456789ABCDEF";
+	size_t i = 0, end;
+	uint8_t *out;
 
-	SD_BUFPUTSL(ob, "<img src=\"");
-	escape_href(ob, link->data, link->size);
-	SD_BUFPUTSL(ob, "\" alt=\"");
+	sd_bufgrow(ob, ESCAPE_GROW_FACTOR(size));
 
-	if (alt && alt->size)
-		escape_html(ob, alt->data, alt->size);
+	while (i < size) {
+		i = copy_run(ob, src, i, size, href_run, NULL);
 
-	if (title && title->size) {
-		SD_BUFPUTSL(ob, "\" title=\"");
-		escape_html(ob, title->data, title->size); }
+		/* escaping */
+		if (i >= size)
+			break;
 
-	sd_bufputs(ob, USE_XHTML(options) ? "\"/>" : "\">");
-	return 1;
-}
+		/* the whole run of unsafe bytes is written in place, after
+		 * making room once for the longest escape of each */
+		end = i + 1;
+		while (end < size && HREF_SAFE[src[end]] == 0)
+			end++;
 
-static int
-rndr_raw_html(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	struct html_renderopt *options = opaque;
+		if (sd_bufgrow(ob, ob->size + (end - i) * 6) < 0)
+			return;
 
-	/* HTML_ESCAPE overrides SKIP_HTML, SKIP_STYLE, SKIP_LINKS and SKIP_IMAGES
-	* It doens't see if there are any valid tags, just escape all of them. */
-	if((options->flags & HTML_ESCAPE) != 0) {
-		escape_html(ob, text->data, text->size);
-		return 1;
-	}
+		out = ob->data + ob->size;
 
-	if ((options->flags & HTML_SKIP_HTML) != 0)
-		return 1;
+		for (; i < end; i++) {
+			switch (src[i]) {
+			/* amp appears all the time in URLs, but needs
+			 * HTML-entity escaping to be inside an href */
+			case '&':
+				memcpy(out, "&amp;", 5);
+				out += 5;
+				break;
 
-	if ((options->flags & HTML_SKIP_STYLE) != 0 &&
-		sdhtml_is_tag(text->data, text->size, "style"))
-		return 1;
+			/* the single quote is a valid URL character
+			 * according to the standard; it needs HTML
+			 * entity escaping too */
+			case '\'':
+				memcpy(out, "&#x27;", 6);
+				out += 6;
+				break;
 
-	if ((options->flags & HTML_SKIP_LINKS) != 0 &&
-		sdhtml_is_tag(text->data, text->size, "a"))
-		return 1;
+			/* the space can be escaped to %20 or a plus
+			 * sign. we're going with the generic escape
+			 * for now. the plus thing is more commonly seen
+			 * when building GET strings */
+#if 0
+			case ' ':
+				*out++ = '+';
+				break;
+#endif
 
-	if ((options->flags & HTML_SKIP_IMAGES) != 0 &&
-		sdhtml_is_tag(text->data, text->size, "img"))
-		return 1;
+			/* every other character goes with a %XX escaping */
+			default:
+				out[0] = '%';
+				out[1] = hex_chars[(src[i] >> 4) & 0xF];
+				out[2] = hex_chars[src[i] & 0xF];
+				out += 3;
+			}
+		}
 
-	sd_bufput(ob, text->data, text->size);
-	return 1;
+		ob->size = out - ob->data;
+	}
 }
 
-static void
-rndr_table(struct sd_buf *ob, const struct sd_buf *header, const struct sd_buf *body, void *opaque)
-{
-	if (ob->size) sd_bufputc(ob, '\n');
-	SD_BUFPUTSL(ob, "<table><thead>\n");
-	if (header)
-		sd_bufput(ob, header->data, header->size);
-	SD_BUFPUTSL(ob, "</thead><tbody>\n");
-	if (body)
-		sd_bufput(ob, body->data, body->size);
-	SD_BUFPUTSL(ob, "</tbody></table>\n");
-}
+//ENDREGION HOUDINI_HREF_E.C
 
-static void
-rndr_tablerow(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	SD_BUFPUTSL(ob, "<tr>\n");
-	if (text)
-		sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</tr>\n");
-}
+//REGION HOUDINI_HTML_U.C
 
-static void
-rndr_tablecell(struct sd_buf *ob, const struct sd_buf *text, int flags, void *opaque)
+/* houdini_unescape_html • decodes the entities sd_entity_decode knows */
+/*	an '&' that does not start one of them is copied as is */
+void
+houdini_unescape_html(struct sd_buf *ob, const uint8_t *src, size_t size)
 {
-	if (flags & MKD_TABLE_HEADER) {
-		SD_BUFPUTSL(ob, "<th");
-	} else {
-		SD_BUFPUTSL(ob, "<td");
-	}
+	static const uint8_t amp = '&';
+	uint8_t utf8[SD_ENTITY_MAX_UTF8];
+	size_t i = 0, end, len;
 
-	switch (flags & MKD_TABLE_ALIGNMASK) {
-	case MKD_TABLE_ALIGN_CENTER:
-		SD_BUFPUTSL(ob, " align=\"center\">");
-		break;
+	sd_bufgrow(ob, size);
 
-	case MKD_TABLE_ALIGN_L:
-		SD_BUFPUTSL(ob, " align=\"left\">");
-		break;
+	while (i < size) {
+		i = copy_run(ob, src, i, size, byte_run, &amp);
 
-	case MKD_TABLE_ALIGN_R:
-		SD_BUFPUTSL(ob, " align=\"right\">");
-		break;
+		if (i >= size)
+			break;
 
-	default:
-		SD_BUFPUTSL(ob, ">");
-	}
+		end = i + 1;
+		if (end < size && src[end] == '#')
+			end++;
 
-	if (text)
-		sd_bufput(ob, text->data, text->size);
+		while (end < size && end - i <= ENTITY_MAX_NAME && isalnum(src[end]))
+			end++;
 
-	if (flags & MKD_TABLE_HEADER) {
-		SD_BUFPUTSL(ob, "</th>\n");
-	} else {
-		SD_BUFPUTSL(ob, "</td>\n");
+		if (end < size && src[end] == ';' &&
+			(len = sd_entity_decode(utf8, src + i, end + 1 - i)) != 0) {
+			sd_bufput(ob, utf8, len);
+			i = end + 1;
+		} else {
+			sd_bufputc(ob, '&');
+			i++;
+		}
 	}
 }
 
-static int
-rndr_superscript(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
-{
-	if (!text || !text->size) return 0;
-	SD_BUFPUTSL(ob, "<sup>");
-	sd_bufput(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</sup>");
-	return 1;
-}
+//ENDREGION HOUDINI_HTML_U.C
 
-static void
-rndr_normal_text(struct sd_buf *ob, const struct sd_buf *text, void *opaque)
+//REGION HOUDINI_XML_E.C
+
+/* the html escapes, with &apos; and the forward slash left alone */
+static const char XML_ESCAPES[][8] = {
+	"",
+	"&quot;",
+	"&amp;",
+	"&apos;",
+	"/",
+	"&lt;",
+	"&gt;"
+};
+
+static const uint8_t XML_ESCAPE_SIZES[] = { 0, 6, 5, 6, 1, 4, 4 };
+
+void
+houdini_escape_xml(struct sd_buf *ob, const uint8_t *src, size_t size)
 {
-	if (text)
-		escape_html(ob, text->data, text->size);
+	escape_entities(ob, src, size, XML_ESCAPES, XML_ESCAPE_SIZES, 0);
 }
 
-static void
-toc_header(struct sd_buf *ob, const struct sd_buf *text, int level, void *opaque)
-{
-	struct html_renderopt *options = opaque;
+//ENDREGION HOUDINI_XML_E.C
 
-	/* set the level offset if this is the first header
-	 * we're parsing for the document */
-	if (options->toc_data.current_level == 0) {
-		options->toc_data.level_offset = level - 1;
-	}
-	level -= options->toc_data.level_offset;
+//REGION HOUDINI_URI_E.C
 
-	if (level > options->toc_data.current_level) {
-		while (level > options->toc_data.current_level) {
-			SD_BUFPUTSL(ob, "<ul>\n<li>\n");
-			options->toc_data.current_level++;
-		}
-	} else if (level < options->toc_data.current_level) {
-		SD_BUFPUTSL(ob, "</li>\n");
-		while (level < options->toc_data.current_level) {
-			SD_BUFPUTSL(ob, "</ul>\n</li>\n");
-			options->toc_data.current_level--;
-		}
-		SD_BUFPUTSL(ob,"<li>\n");
-	} else {
-		SD_BUFPUTSL(ob,"</li>\n<li>\n");
-	}
+/* the unreserved and reserved characters of RFC 3986, less '%' */
+static const char URI_SAFE[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 1, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
 
-	sd_bufprintf(ob, "<a href=\"#toc_%d\">", options->toc_data.header_count++);
-	if (text)
-		escape_html(ob, text->data, text->size);
-	SD_BUFPUTSL(ob, "</a>\n");
-}
+/* the unreserved characters only */
+static const char URL_SAFE[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
 
-static int
-toc_link(struct sd_buf *ob, const struct sd_buf *link, const struct sd_buf *title, const struct sd_buf *content, void *opaque)
-{
-	if (content && content->size)
-		sd_bufput(ob, content->data, content->size);
-	return 1;
-}
+static const struct byte_class URI_CLASS = {
+	URI_SAFE, 1, 1,
+	{ 0x47, 0x03, 0x07, 0x03, 0x03, 0x07, 0x03, 0x03,
+	  0x03, 0x03, 0x03, 0x83, 0xAB, 0x83, 0x2B, 0x83 }
+};
+
+static const struct byte_class URL_CLASS = {
+	URL_SAFE, 1, 1,
+	{ 0x57, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+	  0x07, 0x07, 0x0F, 0xAF, 0xAF, 0xAB, 0x2B, 0x8F }
+};
 
+/* escape_percent • %XX escaping of the bytes outside the class' table */
 static void
-toc_finalize(struct sd_buf *ob, void *opaque)
+escape_percent(struct sd_buf *ob, const uint8_t *src, size_t size,
+	const struct byte_class *cls, int space_plus)
 {
-	struct html_renderopt *options = opaque;
+	static const char hex_chars[] = "0123456789ABCDEF";
+	size_t i = 0, end;
+	uint8_t *out;
 
-	while (options->toc_data.current_level > 0) {
-		SD_BUFPUTSL(ob, "</li>\n</ul>\n");
-		options->toc_data.current_level--;
+	sd_bufgrow(ob, ESCAPE_GROW_FACTOR(size));
+
+	while (i < size) {
+		i = copy_run(ob, src, i, size, class_run, cls);
+
+		if (i >= size)
+			break;
+
+		/* the run of unsafe bytes is written in place, as in
+		 * houdini_escape_href */
+		end = i + 1;
+		while (end < size && cls->table[src[end]] == 0)
+			end++;
+
+		if (sd_bufgrow(ob, ob->size + (end - i) * 3) < 0)
+			return;
+
+		out = ob->data + ob->size;
+
+		for (; i < end; i++) {
+			if (src[i] == ' ' && space_plus) {
+				*out++ = '+';
+				continue;
+			}
+
+			out[0] = '%';
+			out[1] = hex_chars[(src[i] >> 4) & 0xF];
+			out[2] = hex_chars[src[i] & 0xF];
+			out += 3;
+		}
+
+		ob->size = out - ob->data;
 	}
 }
 
 void
-sdhtml_toc_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options)
+houdini_escape_uri(struct sd_buf *ob, const uint8_t *src, size_t size)
 {
-	static const struct sd_callbacks cb_default = {
-		NULL,
-		NULL,
-		NULL,
-		toc_header,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-
-		NULL,
-		rndr_codespan,
-		rndr_double_emphasis,
-		rndr_emphasis,
-		NULL,
-		NULL,
-		toc_link,
-		NULL,
-		rndr_triple_emphasis,
-		rndr_strikethrough,
-		rndr_superscript,
+	escape_percent(ob, src, size, &URI_CLASS, 0);
+}
 
-		NULL,
-		NULL,
+/* houdini_escape_url • escaping of a query component, ' ' goes as '+' */
+void
+houdini_escape_url(struct sd_buf *ob, const uint8_t *src, size_t size)
+{
+	escape_percent(ob, src, size, &URL_CLASS, 1);
+}
 
-		NULL,
-		toc_finalize,
-	};
+//ENDREGION HOUDINI_URI_E.C
 
-	memset(options, 0x0, sizeof(struct html_renderopt));
-	options->flags = HTML_TOC;
+//REGION HOUDINI_URI_U.C
 
-	memcpy(callbacks, &cb_default, sizeof(struct sd_callbacks));
+/* hex_value • value of a hex digit, or -1 */
+static inline int
+hex_value(uint8_t c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
 }
 
-void
-sdhtml_renderer(struct sd_callbacks *callbacks, struct html_renderopt *options, unsigned int render_flags)
+/* next_byte • index of the next c at or after i, size when there is none */
+static inline size_t
+next_byte(const uint8_t *src, size_t i, size_t size, int c)
 {
-	static const struct sd_callbacks cb_default = {
-		rndr_blockcode,
-		rndr_blockquote,
-		rndr_raw_block,
-		rndr_header,
-		rndr_hrule,
-		rndr_list,
-		rndr_listitem,
-		rndr_paragraph,
-		rndr_table,
-		rndr_tablerow,
-		rndr_tablecell,
+	const uint8_t *p = i < size ? (const uint8_t *)memchr(src + i, c, size - i) : NULL;
+	return p ? (size_t)(p - src) : size;
+}
 
-		rndr_autolink,
-		rndr_codespan,
-		rndr_double_emphasis,
-		rndr_emphasis,
-		rndr_image,
-		rndr_linebreak,
-		rndr_link,
-		rndr_raw_html,
-		rndr_triple_emphasis,
-		rndr_strikethrough,
-		rndr_superscript,
+/* percent_scan • the next '%' and '+' found, and whether to look for '+' */
+struct percent_scan {
+	size_t pct, plus;
+	int plus_space;
+};
 
-		NULL,
-		rndr_normal_text,
+/* percent_run • run_scan up to the next '%' or, with plus_space, '+' */
+/*	each is found with memchr and kept until the decoding passes it; a
+ *	search ends at the window, so a kept index that does not hold its
+ *	byte is looked for again */
+static size_t
+percent_run(const void *arg, const uint8_t *src, size_t i, size_t size)
+{
+	struct percent_scan *ps = (struct percent_scan *)arg;
 
-		NULL,
-		NULL,
-	};
+	if (ps->pct < i || (ps->pct < size && src[ps->pct] != '%'))
+		ps->pct = next_byte(src, i, size, '%');
+	if (ps->plus_space && (ps->plus < i || (ps->plus < size && src[ps->plus] != '+')))
+		ps->plus = next_byte(src, i, size, '+');
 
-	/* Prepare the options pointer */
-	memset(options, 0x0, sizeof(struct html_renderopt));
-	options->flags = render_flags;
+	return ps->pct < ps->plus ? ps->pct : ps->plus;
+}
 
-	/* Prepare the callbacks */
-	memcpy(callbacks, &cb_default, sizeof(struct sd_callbacks));
+/* unescape_percent • %XX decoding, and '+' as ' ' with plus_space */
+/*	a '%' without two hex digits is copied */
+static void
+unescape_percent(struct sd_buf *ob, const uint8_t *src, size_t size, int plus_space)
+{
+	struct percent_scan ps;
+	size_t i = 0;
+	int h, l;
 
-	if (render_flags & HTML_SKIP_IMAGES)
-		callbacks->image = NULL;
+	sd_bufgrow(ob, size);
 
-	if (render_flags & HTML_SKIP_LINKS) {
-		callbacks->link = NULL;
-		callbacks->autolink = NULL;
+	ps.pct = ps.plus = 0;
+	ps.plus_space = plus_space;
+	if (!plus_space)
+		ps.plus = (size_t)-1;
+
+	while (i < size) {
+		i = copy_run(ob, src, i, size, percent_run, &ps);
+
+		if (i >= size)
+			break;
+
+		if (plus_space && src[i] == '+') {
+			sd_bufputc(ob, ' ');
+			i++;
+		} else if (i + 2 < size &&
+			(h = hex_value(src[i + 1])) >= 0 && (l = hex_value(src[i + 2])) >= 0) {
+			sd_bufputc(ob, (h << 4) | l);
+			i += 3;
+		} else {
+			sd_bufputc(ob, '%');
+			i++;
+		}
 	}
+}
 
-	if (render_flags & HTML_SKIP_HTML || render_flags & HTML_ESCAPE)
-		callbacks->blockhtml = NULL;
+void
+houdini_unescape_uri(struct sd_buf *ob, const uint8_t *src, size_t size)
+{
+	unescape_percent(ob, src, size, 0);
 }
 
-//ENDREGION: HTML.C
+void
+houdini_unescape_url(struct sd_buf *ob, const uint8_t *src, size_t size)
+{
+	unescape_percent(ob, src, size, 1);
+}
 
-//REGION HOUDINI_HTML_E.C
+//ENDREGION HOUDINI_URI_U.C
 
-#define ESCAPE_GROW_FACTOR(x) (((x) * 12) / 10) /* this is very scientific, yes */
+//REGION HOUDINI_JS_E.C
 
-/**
- * According to the OWASP rules:
- *
- * & --> &amp;
- * < --> &lt;
- * > --> &gt;
- * " --> &quot;
- * ' --> &#x27;     &apos; is not recommended
- * / --> &#x2F;     forward slash is included as it helps end an HTML entity
- *
- */
-static const char HTML_ESCAPE_TABLE[] = {
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 1, 0, 0, 0, 2, 3, 0, 0, 0, 0, 0, 0, 0, 4, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 6, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
+/* the control characters, the quotes, the backslash and the slash */
+static const char JS_ESCAPE[] = {
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
-static const char *HTML_ESCAPES[] = {
-        "",
-        "&quot;",
-        "&amp;",
-        "&#39;",
-        "&#47;",
-        "&lt;",
-        "&gt;"
+static const struct byte_class JS_CLASS = {
+	JS_ESCAPE, 0, 0,
+	{ 0x03, 0x03, 0x07, 0x03, 0x03, 0x03, 0x03, 0x07,
+	  0x03, 0x03, 0x03, 0x03, 0x23, 0x03, 0x03, 0x07 }
 };
 
+/* houdini_escape_js • escaping for the inside of a quoted string */
+/*	the slash is only escaped after '<', where it could end a script */
 void
-houdini_escape_html0(struct sd_buf *ob, const uint8_t *src, size_t size, int secure)
+houdini_escape_js(struct sd_buf *ob, const uint8_t *src, size_t size)
 {
-	size_t i = 0, org, esc = 0;
+	static const char hex_chars[] = "0123456789ABCDEF";
+	size_t i = 0;
+	uint8_t *out;
 
 	sd_bufgrow(ob, ESCAPE_GROW_FACTOR(size));
 
-	while (i < size) {
-		org = i;
-		while (i < size && (esc = HTML_ESCAPE_TABLE[src[i]]) == 0)
+	while ((i = copy_run(ob, src, i, size, class_run, &JS_CLASS)) < size) {
+		if (src[i] == '/' && (i == 0 || src[i - 1] != '<')) {
+			sd_bufputc(ob, '/');
 			i++;
+			continue;
+		}
 
-		if (i > org)
-			sd_bufput(ob, src + org, i - org);
+		if (sd_bufgrow(ob, ob->size + 6) < 0)
+			return;
 
-		/* escaping */
-		if (i >= size)
+		out = ob->data + ob->size;
+		*out++ = '\\';
+
+		switch (src[i]) {
+		case '\n': *out++ = 'n'; break;
+		case '\r': *out++ = 'r'; break;
+		case '\t': *out++ = 't'; break;
+		case '\b': *out++ = 'b'; break;
+		case '\f': *out++ = 'f'; break;
+		case '"': case '\'': case '\\': case '/':
+			*out++ = src[i];
 			break;
 
-		/* The forward slash is only escaped in secure mode */
-		if (src[i] == '/' && !secure) {
-			sd_bufputc(ob, '/');
-		} else {
-			sd_bufputs(ob, HTML_ESCAPES[esc]);
+		/* the other control characters */
+		default:
+			memcpy(out, "u00", 3);
+			out[3] = hex_chars[src[i] >> 4];
+			out[4] = hex_chars[src[i] & 0xF];
+			out += 5;
 		}
 
+		ob->size = out - ob->data;
 		i++;
 	}
 }
 
-void
-houdini_escape_html(struct sd_buf *ob, const uint8_t *src, size_t size)
+//ENDREGION HOUDINI_JS_E.C
+
+//REGION HOUDINI_JS_U.C
+
+/* js_hex4 • value of the 4 hex digits of a unicode escape, or -1 */
+static long
+js_hex4(const uint8_t *data, size_t size)
 {
-	houdini_escape_html0(ob, src, size, 1);
-}
+	long cp = 0;
+	size_t i;
+	int digit;
 
-//ENDREGION HOUDINI_HTML_E.C
+	if (size < 4)
+		return -1;
 
-//REGION HOUDINI_HREF_E.C
+	for (i = 0; i < 4; ++i) {
+		if ((digit = hex_value(data[i])) < 0)
+			return -1;
+		cp = (cp << 4) | digit;
+	}
 
-static const char HREF_SAFE[] = {
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1, 
-	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-};
+	return cp;
+}
 
+/* houdini_unescape_js • decodes the escapes of a quoted string */
+/*	unicode escapes (and surrogate pairs) go out as UTF-8, a lone
+ *	surrogate as U+FFFD, and an escaped quote, backslash or slash
+ *	stands for itself; any other escape is copied as it is, backslash
+ *	included, like a unicode escape without its 4 hex digits */
 void
-houdini_escape_href(struct sd_buf *ob, const uint8_t *src, size_t size)
+houdini_unescape_js(struct sd_buf *ob, const uint8_t *src, size_t size)
 {
-	static const char hex_chars[] = "0123456789ABCDEF";
-	size_t  i = 0, org;
-	char hex_str[3];
+	static const uint8_t backslash = '\\';
+	uint8_t utf8[4];
+	size_t i = 0;
+	long cp, low;
 
-	sd_bufgrow(ob, ESCAPE_GROW_FACTOR(size));
-	hex_str[0] = '%';
+	sd_bufgrow(ob, size);
 
 	while (i < size) {
-		org = i;
-		while (i < size && HREF_SAFE[src[i]] != 0)
-			i++;
-
-		if (i > org)
-			sd_bufput(ob, src + org, i - org);
+		i = copy_run(ob, src, i, size, byte_run, &backslash);
 
-		/* escaping */
-		if (i >= size)
+		/* a trailing backslash is copied */
+		if (i + 1 >= size) {
+			if (i < size)
+				sd_bufputc(ob, '\\');
 			break;
+		}
 
-		switch (src[i]) {
-		/* amp appears all the time in URLs, but needs
-		 * HTML-entity escaping to be inside an href */
-		case '&': 
-			SD_BUFPUTSL(ob, "&amp;");
-			break;
+		switch (src[i + 1]) {
+		case 'n': sd_bufputc(ob, '\n'); break;
+		case 'r': sd_bufputc(ob, '\r'); break;
+		case 't': sd_bufputc(ob, '\t'); break;
+		case 'b': sd_bufputc(ob, '\b'); break;
+		case 'f': sd_bufputc(ob, '\f'); break;
 
-		/* the single quote is a valid URL character
-		 * according to the standard; it needs HTML
-		 * entity escaping too */
-		case '\'':
-			SD_BUFPUTSL(ob, "&#x27;");
+		case 'u':
+			if ((cp = js_hex4(src + i + 2, size - i - 2)) < 0) {
+				SD_BUFPUTSL(ob, "\\u");
+				break;
+			}
+
+			i += 4;
+
+			if (cp >= 0xD800 && cp <= 0xDBFF && i + 7 < size &&
+				src[i + 2] == '\\' && src[i + 3] == 'u' &&
+				(low = js_hex4(src + i + 4, size - i - 4)) >= 0xDC00 && low <= 0xDFFF) {
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				i += 6;
+			} else if (cp >= 0xD800 && cp <= 0xDFFF)
+				cp = 0xFFFD;
+
+			sd_bufput(ob, utf8, put_utf8(utf8, (uint32_t)cp));
 			break;
-		
-		/* the space can be escaped to %20 or a plus
-		 * sign. we're going with the generic escape
-		 * for now. the plus thing is more commonly seen
-		 * when building GET strings */
-#if 0
-		case ' ':
-			sd_bufputc(ob, '+');
+
+		case '"': case '\'': case '\\': case '/':
+			sd_bufputc(ob, src[i + 1]);
 			break;
-#endif
 
-		/* every other character goes with a %XX escaping */
 		default:
-			hex_str[1] = hex_chars[(src[i] >> 4) & 0xF];
-			hex_str[2] = hex_chars[src[i] & 0xF];
-			sd_bufput(ob, hex_str, 3);
+			sd_bufputc(ob, '\\');
+			sd_bufputc(ob, src[i + 1]);
 		}
 
-		i++;
+		i += 2;
 	}
 }
 
-//ENDREGION HOUDINI_HREF_E.C
+//ENDREGION HOUDINI_JS_U.C
 
 //REGION HTML_SMARTYPANTS.C
 
-struct smartypants_data {
-	int in_squote;
-	int in_dquote;
-};
-
 static size_t smartypants_cb__ltag(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
 static size_t smartypants_cb__dquote(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
 static size_t smartypants_cb__amp(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
@@ -4611,6 +9181,13 @@ static const uint8_t smartypants_cb_chars[] = {
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
+/* the bytes of smartypants_cb_chars, for class_scan */
+static const struct byte_class SMARTYPANTS_CLASS = {
+	(const char *)smartypants_cb_chars, 0, 0,
+	{ 0x40, 0x08, 0x04, 0x08, 0x00, 0x00, 0x04, 0x04,
+	  0x04, 0x00, 0x00, 0x00, 0x28, 0x04, 0x04, 0x00 }
+};
+
 static inline int
 word_boundary(uint8_t c)
 {
@@ -4646,7 +9223,7 @@ smartypants_cb__squote(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t
 		}
 
 		if ((t1 == 's' || t1 == 't' || t1 == 'm' || t1 == 'd') &&
-			(size == 3 || word_boundary(text[2]))) {
+			(size == 2 || word_boundary(text[2]))) {
 			SD_BUFPUTSL(ob, "&rsquo;");
 			return 0;
 		}
@@ -4657,17 +9234,20 @@ smartypants_cb__squote(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t
 			if (((t1 == 'r' && t2 == 'e') ||
 				(t1 == 'l' && t2 == 'l') ||
 				(t1 == 'v' && t2 == 'e')) &&
-				(size == 4 || word_boundary(text[3]))) {
+				(size == 3 || word_boundary(text[3]))) {
 				SD_BUFPUTSL(ob, "&rsquo;");
 				return 0;
 			}
 		}
 	}
 
-	if (smartypants_quotes(ob, previous_char, size > 0 ? text[1] : 0, 's', &smrt->in_squote))
+	if (smartypants_quotes(ob, previous_char, size > 1 ? text[1] : 0, 's', &smrt->in_squote))
 		return 0;
 
-	sd_bufputc(ob, text[0]);
+	if (smrt->escape)
+		SD_BUFPUTSL(ob, "&#39;");
+	else
+		sd_bufputc(ob, text[0]);
 	return 0;
 }
 
@@ -4755,6 +9335,9 @@ smartypants_cb__backtick(struct sd_buf *ob, struct smartypants_data *smrt, uint8
 			return 1;
 	}
 
+	/* the html pass has always dropped a lone backtick; text keeps it */
+	if (smrt->escape)
+		sd_bufputc(ob, text[0]);
 	return 0;
 }
 
@@ -4793,7 +9376,7 @@ smartypants_cb__number(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t
 static size_t
 smartypants_cb__dquote(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
-	if (!smartypants_quotes(ob, previous_char, size > 0 ? text[1] : 0, 'd', &smrt->in_dquote))
+	if (!smartypants_quotes(ob, previous_char, size > 1 ? text[1] : 0, 'd', &smrt->in_dquote))
 		SD_BUFPUTSL(ob, "&quot;");
 
 	return 0;
@@ -4802,39 +9385,36 @@ smartypants_cb__dquote(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t
 static size_t
 smartypants_cb__ltag(struct sd_buf *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
-	static const char *skip_tags[] = {
-	  "pre", "code", "var", "samp", "kbd", "math", "script", "style"
-	};
-	static const size_t skip_tags_count = 8;
-
-	size_t tag, i = 0;
+	/* the contents of these are copied as they are */
+	static const unsigned int skip_tags =
+		(1 << TAG_PRE) | (1 << TAG_CODE) | (1 << TAG_VAR) | (1 << TAG_SAMP) |
+		(1 << TAG_KBD) | (1 << TAG_MATH) | (1 << TAG_SCRIPT) | (1 << TAG_STYLE);
 
-	while (i < size && text[i] != '>')
-		i++;
+	size_t i = next_byte(text, 0, size, '>');
+	int kind, tag = html_tag_id(text, size, &kind);
 
-	for (tag = 0; tag < skip_tags_count; ++tag) {
-		if (sdhtml_is_tag(text, size, skip_tags[tag]) == HTML_TAG_OPEN)
-			break;
-	}
+	if (kind == HTML_TAG_OPEN && (skip_tags & (1 << tag)) != 0) {
+		int close;
 
-	if (tag < skip_tags_count) {
 		for (;;) {
-			while (i < size && text[i] != '<')
-				i++;
+			i = next_byte(text, i, size, '<');
 
 			if (i == size)
 				break;
 
-			if (sdhtml_is_tag(text + i, size - i, skip_tags[tag]) == HTML_TAG_CLOSE)
+			if (html_tag_id(text + i, size - i, &close) == tag && close == HTML_TAG_CLOSE)
 				break;
 
 			i++;
 		}
 
-		while (i < size && text[i] != '>')
-			i++;
+		i = next_byte(text, i, size, '>');
 	}
 
+	/* a tag left open at the end of the text is copied to the end */
+	if (i == size)
+		i--;
+
 	sd_bufput(ob, text, i + 1);
 	return i;
 }
@@ -4891,30 +9471,97 @@ static struct {
 };
 #endif
 
+/* smartypants_cb_text • smartypants_cb_chars for raw text */
+/*	'&', '<' and '>' are escaped (11), the backslash is plain text: the
+ *	parser has already taken the markdown escapes out, and '<' cannot
+ *	open a tag */
+static const uint8_t smartypants_cb_text[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 4, 0, 0, 0, 11, 3, 2, 0, 0, 0, 0, 1, 6, 0,
+	0, 7, 0, 7, 0, 0, 0, 0, 0, 0, 0, 0, 11, 0, 11, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const struct byte_class SMARTYPANTS_TEXT_CLASS = {
+	(const char *)smartypants_cb_text, 0, 0,
+	{ 0x40, 0x08, 0x04, 0x08, 0x00, 0x00, 0x04, 0x04,
+	  0x04, 0x00, 0x00, 0x00, 0x08, 0x04, 0x0C, 0x00 }
+};
+
+/* smartypants_text • smartypants over a run of text, escaped for html */
+/*	used by rndr_normal_text with HTML_SMARTYPANTS, in place of a pass
+ *	over the finished html; code spans and blocks never come through
+ *	here, so there are no tags to skip. The character before the run is
+ *	the last one written, as the html pass would see it */
+static void
+smartypants_text(struct sd_buf *ob, struct smartypants_data *smrt, const uint8_t *text, size_t size)
+{
+	size_t i;
+
+	smrt->escape = 1;
+
+	for (i = 0; i < size; ++i) {
+		size_t org;
+		uint8_t action;
+
+		org = i;
+		if (smartypants_cb_text[text[i]] == 0)
+			i = class_scan(&SMARTYPANTS_TEXT_CLASS, text, i, size);
+
+		if (i > org)
+			sd_bufput(ob, text + org, i - org);
+
+		if (i >= size)
+			break;
+
+		action = smartypants_cb_text[text[i]];
+		if (action == 11)
+			escape_html(ob, text + i, 1);
+		else
+			i += smartypants_cb_ptrs[(int)action](ob, smrt,
+				i ? text[i - 1] : (ob->size ? ob->data[ob->size - 1] : 0),
+				text + i, size - i);
+	}
+}
+
 void
 sdhtml_smartypants(struct sd_buf *ob, const uint8_t *text, size_t size)
 {
 	size_t i;
-	struct smartypants_data smrt = {0, 0};
+	struct smartypants_data smrt = {0, 0, 0};
 
 	if (!text)
 		return;
 
 	sd_bufgrow(ob, size);
 
+	/* the triggers are found a vector at a time, and the text
+	 * between them copied whole; back to back triggers (as in
+	 * tag-dense html) skip the scan */
 	for (i = 0; i < size; ++i) {
 		size_t org;
-		uint8_t action = 0;
 
 		org = i;
-		while (i < size && (action = smartypants_cb_chars[text[i]]) == 0)
-			i++;
+		if (smartypants_cb_chars[text[i]] == 0)
+			i = class_scan(&SMARTYPANTS_CLASS, text, i, size);
 
 		if (i > org)
 			sd_bufput(ob, text + org, i - org);
 
 		if (i < size) {
-			i += smartypants_cb_ptrs[(int)action]
+			i += smartypants_cb_ptrs[(int)smartypants_cb_chars[text[i]]]
 				(ob, &smrt, i ? text[i - 1] : 0, text + i, size - i);
 		}
 	}
@@ -4926,10 +9573,13 @@ sdhtml_smartypants(struct sd_buf *ob, const uint8_t *text, size_t size)
 
 #endif // SD_NO_HTML
 
+#define SD_SINGLE_HEADER
+#ifdef SD_IMPLEMENTATION
+#define SD_SINGLE_HEADER_IMPLEMENTATION
+#endif
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // SUNDOWN_SINGLE_HEADER
-
 /* vim: set filetype=c: */